@@ -683,6 +683,8 @@ namespace build2
     verbose_ (1),
     verbose_specified_ (false),
     stat_ (),
+    trace_file_ (),
+    trace_file_specified_ (false),
     dump_ (),
     dump_specified_ (false),
     progress_ (),
@@ -691,6 +693,7 @@ namespace build2
     jobs_specified_ (false),
     max_jobs_ (),
     max_jobs_specified_ (false),
+    jobserver_ (),
     queue_depth_ (4),
     queue_depth_specified_ (false),
     max_stack_ (),
@@ -698,6 +701,7 @@ namespace build2
     serial_stop_ (),
     dry_run_ (),
     match_only_ (),
+    no_test_cache_ (),
     structured_result_ (),
     mtime_check_ (),
     no_mtime_check_ (),
@@ -833,6 +837,13 @@ namespace build2
         this->stat_, a.stat_);
     }
 
+    if (a.trace_file_specified_)
+    {
+      ::build2::cl::parser< path>::merge (
+        this->trace_file_, a.trace_file_);
+      this->trace_file_specified_ = true;
+    }
+
     if (a.dump_specified_)
     {
       ::build2::cl::parser< std::set<string>>::merge (
@@ -866,6 +877,12 @@ namespace build2
       this->max_jobs_specified_ = true;
     }
 
+    if (a.jobserver_)
+    {
+      ::build2::cl::parser< bool>::merge (
+        this->jobserver_, a.jobserver_);
+    }
+
     if (a.queue_depth_specified_)
     {
       ::build2::cl::parser< size_t>::merge (
@@ -898,6 +915,12 @@ namespace build2
         this->match_only_, a.match_only_);
     }
 
+    if (a.no_test_cache_)
+    {
+      ::build2::cl::parser< bool>::merge (
+        this->no_test_cache_, a.no_test_cache_);
+    }
+
     if (a.structured_result_)
     {
       ::build2::cl::parser< bool>::merge (
@@ -1034,7 +1057,17 @@ namespace build2
        << "                      6. Even more detailed information." << ::std::endl;
 
     os << std::endl
-       << "\033[1m--stat\033[0m                Display build statistics." << ::std::endl;
+       << "\033[1m--stat\033[0m                Display build statistics, including the total and the" << ::std::endl
+       << "                      slowest recipe execution times as well as the process" << ::std::endl
+       << "                      spawn times recorded during this run (see also" << ::std::endl
+       << "                      \033[1m--structured-result\033[0m)." << ::std::endl;
+
+    os << std::endl
+       << "\033[1m--trace-file\033[0m \033[4mpath\033[0m     Write the build timeline to the specified file in the" << ::std::endl
+       << "                      Chrome Trace Event JSON format, which can be viewed with" << ::std::endl
+       << "                      \033[1mchrome://tracing\033[0m or Perfetto. The timeline includes the" << ::std::endl
+       << "                      loading of buildfiles, matching and executing of targets," << ::std::endl
+       << "                      child processes, scheduler waits, and phase switches." << ::std::endl;
 
     os << std::endl
        << "\033[1m--dump\033[0m \033[4mphase\033[0m          Dump the build system state after the specified phase." << ::std::endl
@@ -1065,6 +1098,17 @@ namespace build2
        << "                      architectures and 32x on 64-bit. See the build system" << ::std::endl
        << "                      scheduler implementation for details." << ::std::endl;
 
+    os << std::endl
+       << "\033[1m--jobserver\033[0m           Act as a GNU make jobserver for the child processes" << ::std::endl
+       << "                      (compilers, linkers, nested \033[1mmake\033[0m invocations, etc)" << ::std::endl
+       << "                      limiting their combined parallelism to the number of" << ::std::endl
+       << "                      active jobs. Note that if the build system itself is" << ::std::endl
+       << "                      executed under a jobserver (as advertised in the" << ::std::endl
+       << "                      \033[1mMAKEFLAGS\033[0m environment variable) and the number of jobs" << ::std::endl
+       << "                      is not specified explicitly with \033[1m--jobs|-j\033[0m, then it" << ::std::endl
+       << "                      acts as its client and this option is ignored. Currently" << ::std::endl
+       << "                      only supported on POSIX." << ::std::endl;
+
     os << std::endl
        << "\033[1m--queue-depth\033[0m|\033[1m-Q\033[0m \033[4mnum\033[0m  The queue depth as a multiplier over the number of active" << ::std::endl
        << "                      jobs. Normally we want a deeper queue if the jobs take" << ::std::endl
@@ -1109,6 +1153,13 @@ namespace build2
        << "\033[1m--match-only\033[0m          Match the rules but do not execute the operation. This" << ::std::endl
        << "                      mode is primarily useful for profiling." << ::std::endl;
 
+    os << std::endl
+       << "\033[1m--no-test-cache\033[0m       Run all the tests even if they have passed before and" << ::std::endl
+       << "                      nothing that they depend on has changed since. By" << ::std::endl
+       << "                      default such tests are skipped with the result of the" << ::std::endl
+       << "                      previous run being reused (see the \033[1mtest\033[0m module" << ::std::endl
+       << "                      documentation for details)." << ::std::endl;
+
     os << std::endl
        << "\033[1m--structured-result\033[0m   Write the result of execution in a structured form. In" << ::std::endl
        << "                      this mode, instead of printing to \033[1mSTDERR\033[0m diagnostics" << ::std::endl
@@ -1126,6 +1177,13 @@ namespace build2
        << "                      unchanged perform update(test) /tmp/dir{hello/}" << ::std::endl
        << "                      changed perform test /tmp/dir{hello/}" << ::std::endl
        << ::std::endl
+       << "                      If \033[1m--stat\033[0m is also specified, then \033[4mstate\033[0m is followed by" << ::std::endl
+       << "                      the wall and CPU times, in milliseconds, of executing the" << ::std::endl
+       << "                      target's recipe recorded during this run or \033[1m-\033[0m if there" << ::std::endl
+       << "                      is no such record. For example:" << ::std::endl
+       << ::std::endl
+       << "                      changed 1520 1480 perform update /tmp/exe{hello}" << ::std::endl
+       << ::std::endl
        << "                      Note that only the \033[1mperform\033[0m meta-operation supports the" << ::std::endl
        << "                      structured result output." << ::std::endl;
 
@@ -1229,6 +1287,9 @@ namespace build2
         &options::verbose_specified_ >;
       _cli_options_map_["--stat"] =
       &::build2::cl::thunk< options, bool, &options::stat_ >;
+      _cli_options_map_["--trace-file"] =
+      &::build2::cl::thunk< options, path, &options::trace_file_,
+        &options::trace_file_specified_ >;
       _cli_options_map_["--dump"] =
       &::build2::cl::thunk< options, std::set<string>, &options::dump_,
         &options::dump_specified_ >;
@@ -1248,6 +1309,8 @@ namespace build2
       _cli_options_map_["-J"] =
       &::build2::cl::thunk< options, size_t, &options::max_jobs_,
         &options::max_jobs_specified_ >;
+      _cli_options_map_["--jobserver"] =
+      &::build2::cl::thunk< options, bool, &options::jobserver_ >;
       _cli_options_map_["--queue-depth"] =
       &::build2::cl::thunk< options, size_t, &options::queue_depth_,
         &options::queue_depth_specified_ >;
@@ -1267,6 +1330,8 @@ namespace build2
       &::build2::cl::thunk< options, bool, &options::dry_run_ >;
       _cli_options_map_["--match-only"] =
       &::build2::cl::thunk< options, bool, &options::match_only_ >;
+      _cli_options_map_["--no-test-cache"] =
+      &::build2::cl::thunk< options, bool, &options::no_test_cache_ >;
       _cli_options_map_["--structured-result"] =
       &::build2::cl::thunk< options, bool, &options::structured_result_ >;
       _cli_options_map_["--mtime-check"] =
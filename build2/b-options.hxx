@@ -480,6 +480,12 @@ namespace build2
     const bool&
     stat () const;
 
+    const path&
+    trace_file () const;
+
+    bool
+    trace_file_specified () const;
+
     const std::set<string>&
     dump () const;
 
@@ -504,6 +510,9 @@ namespace build2
     bool
     max_jobs_specified () const;
 
+    const bool&
+    jobserver () const;
+
     const size_t&
     queue_depth () const;
 
@@ -525,6 +534,9 @@ namespace build2
     const bool&
     match_only () const;
 
+    const bool&
+    no_test_cache () const;
+
     const bool&
     structured_result () const;
 
@@ -613,6 +625,8 @@ namespace build2
     uint16_t verbose_;
     bool verbose_specified_;
     bool stat_;
+    path trace_file_;
+    bool trace_file_specified_;
     std::set<string> dump_;
     bool dump_specified_;
     bool progress_;
@@ -621,6 +635,7 @@ namespace build2
     bool jobs_specified_;
     size_t max_jobs_;
     bool max_jobs_specified_;
+    bool jobserver_;
     size_t queue_depth_;
     bool queue_depth_specified_;
     size_t max_stack_;
@@ -628,6 +643,7 @@ namespace build2
     bool serial_stop_;
     bool dry_run_;
     bool match_only_;
+    bool no_test_cache_;
     bool structured_result_;
     bool mtime_check_;
     bool no_mtime_check_;
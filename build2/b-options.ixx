@@ -314,6 +314,18 @@ namespace build2
     return this->stat_;
   }
 
+  inline const path& options::
+  trace_file () const
+  {
+    return this->trace_file_;
+  }
+
+  inline bool options::
+  trace_file_specified () const
+  {
+    return this->trace_file_specified_;
+  }
+
   inline const std::set<string>& options::
   dump () const
   {
@@ -362,6 +374,12 @@ namespace build2
     return this->max_jobs_specified_;
   }
 
+  inline const bool& options::
+  jobserver () const
+  {
+    return this->jobserver_;
+  }
+
   inline const size_t& options::
   queue_depth () const
   {
@@ -404,6 +422,12 @@ namespace build2
     return this->match_only_;
   }
 
+  inline const bool& options::
+  no_test_cache () const
+  {
+    return this->no_test_cache_;
+  }
+
   inline const bool& options::
   structured_result () const
   {
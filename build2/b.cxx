@@ -32,11 +32,14 @@
 #include <libbuild2/module.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/history.hxx>
 #include <libbuild2/variable.hxx>
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/buildspec.hxx>
+#include <libbuild2/jobserver.hxx>
 #include <libbuild2/operation.hxx>
 #include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/prerequisite.hxx>
 
@@ -79,10 +82,12 @@ namespace build2
   class result_printer
   {
   public:
-    result_printer (const action_targets& tgs): tgs_ (tgs) {}
+    result_printer (action a, const action_targets& tgs)
+        : a_ (a), tgs_ (tgs) {}
     ~result_printer ();
 
   private:
+    action a_;
     const action_targets& tgs_;
   };
 
@@ -108,8 +113,26 @@ namespace build2
         const target& t (at.as<target> ());
         context& ctx (t.ctx);
 
-        cout << at.state
-             << ' ' << ctx.current_mif->name
+        cout << at.state;
+
+        // With --stat also print the recipe execution times.
+        //
+        if (ops.stat ())
+        {
+          if (optional<execution_history::entry> e =
+                ctx.history.recorded (a_, t))
+          {
+            using chrono::milliseconds;
+            using chrono::duration_cast;
+
+            cout << ' ' << duration_cast<milliseconds> (e->wall).count ()
+                 << ' ' << duration_cast<milliseconds> (e->cpu).count ();
+          }
+          else
+            cout << " - -";
+        }
+
+        cout << ' ' << ctx.current_mif->name
              << ' ' << ctx.current_inner_oif->name;
 
         if (ctx.current_outer_oif != nullptr)
@@ -225,6 +248,20 @@ main (int argc, char* argv[])
 
   scheduler sched;
 
+  // Recipe execution statistics accumulated from all the build contexts
+  // (see --stat).
+  //
+  execution_history::statistics hstat;
+
+  // Build timeline (see --trace-file).
+  //
+  unique_ptr<trace_file> tfile;
+
+  // Jobserver, if any (see --jobserver). Must outlive the scheduler's use
+  // of it (see sched.shutdown() below).
+  //
+  unique_ptr<jobserver> jserver;
+
   // Parse the command line.
   //
   try
@@ -596,8 +633,53 @@ main (int argc, char* argv[])
                     ? optional<size_t> (ops.max_stack () * 1024)
                     : nullopt));
 
+    // Connect to the jobserver if we are running under one (unless the
+    // number of jobs was specified explicitly, similar to make) or become
+    // one if requested.
+    //
+    if (!ops.jobs_specified () && !ops.serial_stop ())
+      jserver = jobserver::connect ();
+
+    if (jserver == nullptr && ops.jobserver ())
+    {
+      try
+      {
+        jserver = jobserver::create (jobs);
+      }
+      catch (const system_error& e)
+      {
+        fail << "unable to create jobserver: " << e;
+      }
+    }
+
+    if (jserver != nullptr)
+    {
+      l5 ([&]{trace << (jserver->server () ? "serving" : "using")
+                    << " jobserver";});
+
+      sched.use_jobserver (*jserver);
+    }
+
     global_mutexes mutexes (sched.shard_size ());
 
+    // Start recording the build timeline, if requested.
+    //
+    if (ops.trace_file_specified ())
+    {
+      const path& f (ops.trace_file ());
+
+      try
+      {
+        tfile.reset (new trace_file (f));
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to open " << f << ": " << e;
+      }
+
+      trace_sink = tfile.get ();
+    }
+
     // Trace some overall environment information.
     //
     if (verb >= 5)
@@ -616,8 +698,11 @@ main (int argc, char* argv[])
     // below).
     //
     unique_ptr<context> ctx;
-    auto new_context = [&ctx, &sched, &mutexes, &cmd_vars]
+    auto new_context = [&ctx, &sched, &mutexes, &cmd_vars, &hstat]
     {
+      if (ctx != nullptr)
+        hstat += ctx->history.stat ();
+
       ctx = nullptr; // Free first.
       ctx.reset (new context (sched,
                               mutexes,
@@ -625,10 +710,21 @@ main (int argc, char* argv[])
                               ops.dry_run (),
                               !ops.serial_stop () /* keep_going */,
                               cmd_vars));
+
+      ctx->test_cache = !ops.no_test_cache ();
     };
 
     new_context ();
 
+    // Collect the statistics of the last context, including on failure.
+    //
+    auto hstat_guard (
+      make_guard ([&ctx, &hstat] ()
+                  {
+                    if (ctx != nullptr)
+                      hstat += ctx->history.stat ();
+                  }));
+
     // Parse the buildspec.
     //
     buildspec bspec;
@@ -1517,7 +1613,7 @@ main (int argc, char* argv[])
           action a (mid, pre_oid, oid);
 
           {
-            result_printer p (tgs);
+            result_printer p (a, tgs);
             uint16_t diag (ops.structured_result () ? 0 : 1);
 
             if (mif->match != nullptr)
@@ -1544,7 +1640,7 @@ main (int argc, char* argv[])
         action a (mid, oid, oif->outer_id);
 
         {
-          result_printer p (tgs);
+          result_printer p (a, tgs);
           uint16_t diag (ops.structured_result () ? 0 : 2);
 
           if (mif->match != nullptr)
@@ -1572,7 +1668,7 @@ main (int argc, char* argv[])
           action a (mid, post_oid, oid);
 
           {
-            result_printer p (tgs);
+            result_printer p (a, tgs);
             uint16_t diag (ops.structured_result () ? 0 : 1);
 
             if (mif->match != nullptr)
@@ -1628,6 +1724,24 @@ main (int argc, char* argv[])
   //
   assert (st.task_queue_remain == 0);
 
+  // Write the build timeline. Note that it is written even in case of a
+  // failure since that's when it is often most interesting.
+  //
+  if (tfile != nullptr)
+  {
+    trace_sink = nullptr;
+
+    try
+    {
+      tfile->close ();
+    }
+    catch (const io_error& e)
+    {
+      error << "unable to write " << ops.trace_file () << ": " << e;
+      r = 1;
+    }
+  }
+
   if (ops.stat ())
   {
     text << '\n'
@@ -1642,6 +1756,50 @@ main (int argc, char* argv[])
          << '\n'
          << "  wait_queue_slots       " << st.wait_queue_slots      << '\n'
          << "  wait_queue_collisions  " << st.wait_queue_collisions << '\n';
+
+    // Print the time in seconds with the millisecond precision.
+    //
+    auto secs = [] (duration d)
+    {
+      size_t ms (static_cast<size_t> (
+                   chrono::duration_cast<chrono::milliseconds> (d).count ()));
+
+      string r (to_string (ms / 1000));
+      r += '.';
+      r += to_string (ms % 1000 + 1000).substr (1);
+      r += 's';
+      return r;
+    };
+
+    text << '\n'
+         << "  recipe_count           " << hstat.count       << '\n'
+         << "  recipe_wall_time       " << secs (hstat.wall) << '\n'
+         << "  recipe_cpu_time        " << secs (hstat.cpu)  << '\n';
+
+    // Process spawn latency is normally well below a millisecond so print
+    // the maximum in microseconds.
+    //
+    {
+      process_statistics ps (process_stat ());
+
+      text << '\n'
+           << "  process_spawn_count    " << ps.count       << '\n'
+           << "  process_spawn_time     " << secs (ps.time) << '\n'
+           << "  process_spawn_max      "
+           << chrono::duration_cast<chrono::microseconds> (
+                ps.max).count () << "us" << '\n';
+    }
+
+    if (!hstat.slowest.empty ())
+    {
+      diag_record dr (text);
+      dr << '\n'
+         << "slowest recipes (wall, cpu):" << '\n';
+
+      for (const auto& p: hstat.slowest)
+        dr << "\n  " << secs (p.second.wall) << ' ' << secs (p.second.cpu)
+           << ' ' << p.first;
+    }
   }
 
   return r;
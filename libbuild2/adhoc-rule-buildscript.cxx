@@ -93,7 +93,31 @@ namespace build2
       os << ind; script::dump (os, *script.diag_line, true /* newline */);
     }
 
-    script::dump (os, ind, script.lines);
+    // Dump the lines interleaving them with the parallel blocks.
+    //
+    {
+      using lines = build::script::lines;
+
+      const lines& ls (script.lines);
+      size_t i (0);
+
+      for (const pair<size_t, size_t>& b: script.parallel_blocks)
+      {
+        script::dump (os, ind, lines (ls.begin () + i, ls.begin () + b.first));
+
+        os << ind << "parallel" << endl;
+        ind += "  ";
+        script::dump (os, ind, lines (ls.begin () + b.first,
+                                      ls.begin () + b.second));
+        ind.resize (ind.size () - 2);
+        os << ind << "end" << endl;
+
+        i = b.second;
+      }
+
+      script::dump (os, ind, lines (ls.begin () + i, ls.end ()));
+    }
+
     ind.resize (ind.size () - 2);
     os << ind << string (braces, '}');
   }
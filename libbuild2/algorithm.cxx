@@ -3,13 +3,17 @@
 
 #include <libbuild2/algorithm.hxx>
 
+#include <sstream>
+
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/rule.hxx>
 #include <libbuild2/file.hxx> // import()
 #include <libbuild2/search.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/history.hxx>
 #include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/prerequisite.hxx>
 
@@ -246,6 +250,7 @@ namespace build2
       // First lock for this operation.
       //
       s.rule = nullptr;
+      s.weight = 0;
       s.dependents.store (0, memory_order_release);
 
       offset = target::offset_touched;
@@ -533,6 +538,122 @@ namespace build2
     return r.second.get ().apply (a, t, me);
   }
 
+  // Return the target's weight if we have observed it as matched for this
+  // action and 0 otherwise (the weight of any other target may still be in
+  // the process of being calculated). Note that the task count is a
+  // synchronization point.
+  //
+  static inline size_t
+  matched_weight (action a, const target& t)
+  {
+    context& ctx (t.ctx);
+
+    const target::opstate& s (t[a]);
+    size_t c (s.task_count.load (memory_order_acquire));
+
+    return c == ctx.count_applied () || c == ctx.count_executed ()
+      ? s.weight
+      : 0;
+  }
+
+  size_t
+  prerequisite_weight (action a, const target& t)
+  {
+    size_t r (0);
+    for (const prerequisite_target& p: t.prerequisite_targets[a])
+    {
+      if (const target* pt = p.target)
+      {
+        size_t w (matched_weight (a, *pt));
+        if (w > r)
+          r = w;
+      }
+    }
+
+    return r;
+  }
+
+  // Return true if the target's recipe for this action is neither noop nor
+  // group action, that is, executing it actually costs something.
+  //
+  static inline bool
+  costly_recipe (action a, const target& t)
+  {
+    const target::opstate& s (t[a]);
+
+    if (s.state == target_state::unchanged) // Noop (see set_recipe()).
+      return false;
+
+    recipe_function* const* f (s.recipe.target<recipe_function*> ());
+    return f == nullptr || *f != &group_action;
+  }
+
+  // Return the target's recipe execution time estimated from the execution
+  // history (see execution_history for details) in milliseconds or 0 if
+  // unknown.
+  //
+  static inline size_t
+  execute_estimate (action a, const target& t)
+  {
+    return static_cast<size_t> (
+      chrono::duration_cast<chrono::milliseconds> (
+        t.ctx.history.estimate (a, t)).count ());
+  }
+
+  // Calculate the target's critical path weight (see
+  // target::opstate::weight) as the highest weight among its prerequisites
+  // plus its own recipe execution time estimate (see execute_estimate()).
+  // Note that we count at least one millisecond for any costly recipe so
+  // that with no history the weight is the length of the longest
+  // prerequisite chain.
+  //
+  static size_t
+  calculate_weight (action a, const target& t, size_t estimate)
+  {
+    size_t r (prerequisite_weight (a, t));
+
+    // An outer operation normally executes the inner recipe as part of its
+    // own and the group action (see group_action()) -- the group's recipe.
+    //
+    if (a.outer ())
+      r = max (r, matched_weight (a.inner_action (), t));
+
+    if (costly_recipe (a, t))
+      r += estimate != 0 ? estimate : 1;
+    else if (t[a].state != target_state::unchanged) // Group action.
+    {
+      if (t.group != nullptr)
+        r = max (r, matched_weight (a, *t.group));
+    }
+
+    return r;
+  }
+
+  // Set the timeline span name and arguments for the action on the target
+  // (see trace_file).
+  //
+  static void
+  trace_target (string& n, string& as, action a, const target& t)
+  {
+    {
+      ostringstream os;
+      os << t;
+      n = os.str ();
+    }
+
+    const operation_table& ot (t.ctx.operation_table);
+
+    string o (ot[a.operation ()]);
+    if (a.outer ())
+    {
+      o += '(';
+      o += ot[a.outer_operation ()];
+      o += ')';
+    }
+
+    trace_file::arg (as, "operation", o);
+  }
+
   // If step is true then perform only one step of the match/apply sequence.
   //
   // If try_match is true, then indicate whether there is a rule match with
@@ -587,6 +708,12 @@ namespace build2
       return r; // Group state.
     }
 
+    trace_span ts ("match",
+                   [a, &t] (string& n, string& as)
+                   {
+                     trace_target (n, as, a, t);
+                   });
+
     try
     {
       // Continue from where the target has been left off.
@@ -639,7 +766,24 @@ namespace build2
         {
           // Apply.
           //
+          ts.arg ("rule", s.rule->first);
+
           set_recipe (l, apply_impl (a, t, *s.rule));
+
+          // Calculate the critical path weight unless the rule has already
+          // done so and account for the estimated execution time of the
+          // target (see context::target_estimate).
+          //
+          {
+            size_t e (costly_recipe (a, t) ? execute_estimate (a, t) : 0);
+
+            if (s.weight == 0)
+              s.weight = calculate_weight (a, t, e);
+
+            if (e != 0 && a.inner ())
+              t.ctx.target_estimate.fetch_add (e, memory_order_relaxed);
+          }
+
           l.offset = target::offset_applied;
           break;
         }
@@ -1645,6 +1789,24 @@ namespace build2
     assert (s.task_count.load (memory_order_consume) == t.ctx.count_busy ()
             && s.state == target_state::unknown);
 
+    // Note that the estimate is only accounted for targets matched with a
+    // rule (see match_impl()) and must be looked up before recording the
+    // new entry below.
+    //
+    bool costly (costly_recipe (a, t));
+    size_t estimate (costly && a.inner () && s.rule != nullptr
+                     ? execute_estimate (a, t)
+                     : 0);
+
+    trace_span tsp ("execute",
+                    [a, &t, &s] (string& n, string& as)
+                    {
+                      trace_target (n, as, a, t);
+
+                      if (s.rule != nullptr)
+                        trace_file::arg (as, "rule", s.rule->first);
+                    });
+
     target_state ts;
     try
     {
@@ -1665,7 +1827,23 @@ namespace build2
           backlink_clean_pre (a, t, *blm);
       }
 
-      ts = execute_recipe (a, t, s.recipe);
+      // Measure the times the recipe took by itself (that is, excluding the
+      // time spent waiting for or executing prerequisites) and record them
+      // in the execution history if the target has actually changed (the
+      // time it takes to determine that a target is up to date is not a
+      // good estimate of the time it takes to update it).
+      //
+      {
+        scheduler::task_timer tt;
+
+        ts = execute_recipe (a, t, s.recipe);
+
+        if (ts == target_state::changed && !ctx.dry_run && costly)
+        {
+          scheduler::task_timer::times e (tt.elapsed ());
+          ctx.history.record (a, t, {e.wall, e.cpu});
+        }
+      }
 
       if (blm)
       {
@@ -1681,13 +1859,17 @@ namespace build2
       ts = s.state = target_state::failed;
     }
 
-    // Decrement the target count (see set_recipe() for details).
+    // Decrement the target count (see set_recipe() for details) and the
+    // estimate (see match_impl()).
     //
     if (a.inner ())
     {
       recipe_function** f (s.recipe.target<recipe_function*> ());
       if (f == nullptr || *f != &group_action)
         ctx.target_count.fetch_sub (1, memory_order_relaxed);
+
+      if (estimate != 0)
+        ctx.target_estimate.fetch_sub (estimate, memory_order_relaxed);
     }
 
     // Decrement the task count (to count_executed) and wake up any threads
@@ -1865,6 +2047,58 @@ namespace build2
       pt.target = nullptr;
   }
 
+  static inline size_t
+  execute_weight (action a, const target* t)
+  {
+    return t != nullptr ? (*t)[a].weight : 0;
+  }
+
+  // Return the order in which to start the asynchronous execution of the
+  // [b, e) range of targets: heavier first (see target::opstate::weight)
+  // and in the declaration order otherwise. Since helper threads dequeue
+  // tasks in the order they were queued (see scheduler for details), this
+  // gives the longest dependency chains a head start rather than having
+  // them hold up the end of the build.
+  //
+  // Return empty if the declaration order should be used as is, which is
+  // the case when executing serially (there is nobody to give a head start
+  // to) or if there is nothing to reorder.
+  //
+  using execute_order = small_vector<size_t, 16>;
+
+  template <typename T>
+  static execute_order
+  weight_order (context& ctx, action a, const T ts[], size_t b, size_t e)
+  {
+    execute_order r;
+
+    if (ctx.sched.serial () || b == e)
+      return r;
+
+    size_t i (b);
+    for (size_t w (execute_weight (a, ts[i])); i != e; ++i)
+    {
+      if (execute_weight (a, ts[i]) != w)
+        break;
+    }
+
+    if (i == e)
+      return r;
+
+    r.reserve (e - b);
+    for (i = b; i != e; ++i)
+      r.push_back (i);
+
+    stable_sort (r.begin (), r.end (),
+                 [a, ts] (size_t x, size_t y)
+                 {
+                   return (execute_weight (a, ts[x]) >
+                           execute_weight (a, ts[y]));
+                 });
+
+    return r;
+  }
+
   template <typename T>
   target_state
   straight_execute_members (context& ctx, action a, atomic_count& tc,
@@ -1875,14 +2109,16 @@ namespace build2
     size_t busy (ctx.count_busy ());
     size_t exec (ctx.count_executed ());
 
-    // Start asynchronous execution of prerequisites.
+    // Start asynchronous execution of prerequisites, heavier first.
     //
     wait_guard wg (ctx, busy, tc);
 
     n += p;
-    for (size_t i (p); i != n; ++i)
+    execute_order o (weight_order (ctx, a, ts, p, n));
+
+    for (size_t j (p); j != n; ++j)
     {
-      const target*& mt (ts[i]);
+      const target*& mt (ts[o.empty () ? j : o[j - p]]);
 
       if (mt == nullptr) // Skipped.
         continue;
@@ -2017,9 +2253,11 @@ namespace build2
 
     wait_guard wg (ctx, busy, t[a].task_count);
 
-    for (size_t i (0); i != n; ++i)
+    execute_order o (weight_order (ctx, a, pts.data (), 0, n));
+
+    for (size_t j (0); j != n; ++j)
     {
-      const target*& pt (pts[i]);
+      const target*& pt (pts[o.empty () ? j : o[j]]);
 
       if (pt == nullptr) // Skipped.
         continue;
@@ -454,6 +454,16 @@ namespace build2
   LIBBUILD2_SYMEXPORT const fsdir*
   inject_fsdir (action, target&, bool parent = true);
 
+  // Return the highest critical path weight (see target::opstate::weight)
+  // among the target's prerequisite targets that have been matched for this
+  // action. Normally only called by a rule that wishes to calculate the
+  // target's weight itself at the end of its apply(), for example:
+  //
+  // t[a].weight = prerequisite_weight (a, t) + cost;
+  //
+  LIBBUILD2_SYMEXPORT size_t
+  prerequisite_weight (action, const target&);
+
   // Execute the action on target, assuming a rule has been matched and the
   // recipe for this action has been set. This is the synchrounous executor
   // implementation (but may still return target_state::busy if the target
@@ -393,6 +393,14 @@ namespace build2
             else if (find_stem (s, s_p, s_n, "wasm-ld" ) != string::npos)
               id = "wasm-lld";
           }
+          // Mold prints a line in the form "mold X.Y.Z (... compatible with
+          // GNU ld)" so it must come before the binutils checks.
+          //
+          else if (l.compare (0, 5, "mold ") == 0)
+          {
+            ver = parse_version (l, 5);
+            id = "gnu-mold";
+          }
           // Binutils ld.bfd --version output has a line that starts with "GNU
           // ld " while ld.gold -- "GNU gold". Again, fortify it against
           // embedded toolchain customizations by search for "GNU " in the
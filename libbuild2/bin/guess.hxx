@@ -56,6 +56,7 @@ namespace build2
     // gnu          GNU binutils ld.bfd
     // gnu-gold     GNU binutils ld.gold
     // gnu-lld      LLVM ld.lld (and older lld)
+    // gnu-mold     mold
     // ld64         Apple's new linker
     // ld64-lld     LLVM ld64.lld
     // cctools      Apple's old/classic linker
@@ -88,6 +88,17 @@ namespace build2
       vp.insert<string>    ("config.bin.exe.prefix");
       vp.insert<string>    ("config.bin.exe.suffix");
 
+      // Programs for the separate debug information steps (see the cc
+      // module for details).
+      //
+      vp.insert<path>      ("config.bin.objcopy");
+      vp.insert<path>      ("config.bin.dwp");
+
+      // Linker kind to link with via the compiler driver (see the bin.ld
+      // module for details).
+      //
+      vp.insert<string>    ("config.bin.ld.kind");
+
       vp.insert<string>    ("bin.lib");
 
       vp.insert<strings>   ("bin.exe.lib");
@@ -392,6 +403,39 @@ namespace build2
           }
         }
 
+        // config.bin.objcopy
+        // config.bin.dwp
+        //
+        // Similar to config.bin.ranlib, these should be explicitly specified
+        // by the user in order for us to use them. If specified, then the
+        // link rule splits the debug information off executables and shared
+        // libraries with objcopy and packages the split DWARF .dwo files
+        // with dwp.
+        //
+        auto search = [&rs, &new_cfg] (const char* cv, const char* v)
+          -> const process_path*
+        {
+          const path* p (
+            cast_null<path> (
+              lookup_config (new_cfg,
+                             rs,
+                             cv,
+                             nullptr,
+                             config::save_default_commented)));
+
+          if (p == nullptr)
+            return nullptr;
+
+          value& pv (rs.assign<process_path> (v));
+          pv = run_search (*p, true /* init */);
+          return &pv.as<process_path> ();
+        };
+
+        const process_path* objcopy (
+          search ("config.bin.objcopy", "bin.objcopy.path"));
+        const process_path* dwp (
+          search ("config.bin.dwp", "bin.dwp.path"));
+
         // If this is a configuration with new values, then print the report
         // at verbosity level 2 and up (-v).
         //
@@ -405,6 +449,14 @@ namespace build2
           if (auto l = rs["bin.pattern"])
             dr << '\n'
                << "  pattern    " << cast<string> (l);
+
+          if (objcopy != nullptr)
+            dr << '\n'
+               << "  objcopy    " << *objcopy;
+
+          if (dwp != nullptr)
+            dr << '\n'
+               << "  dwp        " << *dwp;
         }
       }
 
@@ -453,6 +505,11 @@ namespace build2
           rs.insert_target_type<hbmia> ();
           rs.insert_target_type<hbmis> ();
 
+          rs.insert_target_type<pch>  ();
+          rs.insert_target_type<pche> ();
+          rs.insert_target_type<pcha> ();
+          rs.insert_target_type<pchs> ();
+
           rs.insert_target_type<libul> ();
           rs.insert_target_type<libue> ();
           rs.insert_target_type<libua> ();
@@ -467,6 +524,18 @@ namespace build2
           // when building for Windows).
           //
           rs.insert_target_type<def> ();
+
+          // Register the separate debug information target types: split
+          // DWARF object (.dwo), DWARF package (.dwp), and debug information
+          // file (.debug). They are only used as ad hoc members managed by
+          // the cc rules and are not installed by default.
+          //
+          if (tclass != "windows" && tclass != "macos")
+          {
+            rs.derive_target_type<file> ("dwo");
+            rs.derive_target_type<file> ("dwp");
+            rs.derive_target_type<file> ("debug");
+          }
         }
 
         // Note: libu*{} members are not installable.
@@ -531,6 +600,9 @@ namespace build2
         r.insert<hbmi> (perform_update_id, "bin.hbmi", fail_);
         r.insert<hbmi> (perform_clean_id,  "bin.hbmi", fail_);
 
+        r.insert<pch> (perform_update_id, "bin.pch", fail_);
+        r.insert<pch> (perform_clean_id,  "bin.pch", fail_);
+
         r.insert<libul> (perform_update_id, "bin.libul", fail_);
         r.insert<libul> (perform_clean_id,  "bin.libul", fail_);
 
@@ -766,12 +838,51 @@ namespace build2
 
         bool new_cfg (false); // Any new configuration values?
 
+        // config.bin.ld.kind
+        //
+        // If specified, then instead of the linker that the compiler driver
+        // uses by default, link with the linker of this kind (passed to the
+        // driver by path, see the cc link rule for details). This is only
+        // supported for ELF targets.
+        //
+        const string* kind (
+          cast_null<string> (
+            lookup_config (new_cfg,
+                           rs,
+                           "config.bin.ld.kind",
+                           nullptr,
+                           config::save_default_commented)));
+
+        const char* kind_id (nullptr);
+        if (kind != nullptr)
+        {
+          const string& k (*kind);
+
+          kind_id = (k == "bfd"  ? "gnu"      :
+                     k == "gold" ? "gnu-gold" :
+                     k == "lld"  ? "gnu-lld"  :
+                     k == "mold" ? "gnu-mold" : nullptr);
+
+          if (kind_id == nullptr)
+            fail << "invalid config.bin.ld.kind value '" << k << "'" <<
+              info << "expected bfd, gold, lld, or mold";
+
+          const string& tc (cast<string> (rs["bin.target.class"]));
+
+          if (tc == "windows" || tc == "macos")
+            fail << "config.bin.ld.kind is not supported for target "
+                 << cast<target_triplet> (rs["bin.target"]);
+        }
+
         // config.bin.ld
         //
-        // Use the target to decide on the default ld name.
+        // Use the target (or the linker kind) to decide on the default ld
+        // name. Note that we don't apply the pattern to the linker kind-based
+        // names since such linkers are normally not toolchain-specific.
         //
         const string& tsys (cast<string> (rs["bin.target.system"]));
-        const char* ld_d (tsys == "win32-msvc" ? "link" : "ld");
+        string ld_d (kind != nullptr      ? "ld." + *kind :
+                     tsys == "win32-msvc" ? "link"        : "ld");
 
         // This can be either a pattern or search path(s).
         //
@@ -782,11 +893,21 @@ namespace build2
             lookup_config (new_cfg,
                            rs,
                            "config.bin.ld",
-                           path (apply_pattern (ld_d, pat.pattern)),
+                           path (kind != nullptr
+                                 ? ld_d
+                                 : apply_pattern (ld_d.c_str (), pat.pattern)),
                            config::save_default_commented)));
 
         ld_info ldi (guess_ld (ld, pat.paths));
 
+        // Make sure the linker is of the specified kind since this is what
+        // we will ask the compiler driver to use.
+        //
+        if (kind_id != nullptr && ldi.id != kind_id)
+          fail << "linker " << ld << " is not " << *kind <<
+            info << "linker id is " << ldi.id <<
+            info << "use config.bin.ld to specify the " << *kind << " linker";
+
         // If this is a configuration with new values, then print the report
         // at verbosity level 2 and up (-v).
         //
@@ -798,6 +919,9 @@ namespace build2
             dr << "bin.ld " << project (rs) << '@' << rs << '\n'
                << "  ld         " << ldi.path << '\n'
                << "  id         " << ldi.id << '\n';
+
+            if (kind != nullptr)
+              dr << "  kind       " << *kind << '\n';
           }
 
           if (ldi.version)
@@ -823,6 +947,9 @@ namespace build2
         rs.assign<string>       ("bin.ld.signature") = move (ldi.signature);
         rs.assign<string>       ("bin.ld.checksum")  = move (ldi.checksum);
 
+        if (kind != nullptr)
+          rs.assign<string> ("bin.ld.kind") = *kind;
+
         if (ldi.version)
         {
           semantic_version& v (*ldi.version);
@@ -50,6 +50,19 @@ namespace build2
       false
     };
 
+    const target_type pchx::static_type
+    {
+      "pchx",
+      &file::static_type,
+      nullptr,
+      nullptr,
+      nullptr,
+      nullptr,
+      nullptr,
+      &target_search,
+      false
+    };
+
     const target_type libx::static_type
     {
       "libx",
@@ -83,7 +96,7 @@ namespace build2
     // running serial. For the members it is also safe to set the group during
     // creation.
 
-    // obj*{}, lib*{}, and [h]bmi*{} member factory.
+    // obj*{}, lib*{}, [h]bmi*{}, and pch*{} member factory.
     //
     template <typename M, typename G>
     static target*
@@ -215,6 +228,19 @@ namespace build2
       false
     };
 
+    const target_type pche::static_type
+    {
+      "pche",
+      &pchx::static_type,
+      &m_factory<pche, pch>,
+      nullptr, /* fixed_extension */
+      &target_extension_var<nullptr>,
+      &target_pattern_var<nullptr>,
+      nullptr,
+      &target_search, // Note: not _file(); don't look for an existing file.
+      false
+    };
+
     const target_type libue::static_type
     {
       "libue",
@@ -228,6 +254,19 @@ namespace build2
       false
     };
 
+    const target_type pcha::static_type
+    {
+      "pcha",
+      &pchx::static_type,
+      &m_factory<pcha, pch>,
+      nullptr, /* fixed_extension */
+      &target_extension_var<nullptr>,
+      &target_pattern_var<nullptr>,
+      nullptr,
+      &target_search, // Note: not _file(); don't look for an existing file.
+      false
+    };
+
     const target_type libua::static_type
     {
       "libua",
@@ -241,6 +280,19 @@ namespace build2
       false
     };
 
+    const target_type pchs::static_type
+    {
+      "pchs",
+      &pchx::static_type,
+      &m_factory<pchs, pch>,
+      nullptr, /* fixed_extension */
+      &target_extension_var<nullptr>,
+      &target_pattern_var<nullptr>,
+      nullptr,
+      &target_search, // Note: not _file(); don't look for an existing file.
+      false
+    };
+
     const target_type libus::static_type
     {
       "libus",
@@ -254,7 +306,7 @@ namespace build2
       false
     };
 
-    // obj{}, [h]bmi{}, and libu{} group factory.
+    // obj{}, [h]bmi{}, pch{}, and libu{} group factory.
     //
     template <typename G, typename E, typename A, typename S>
     static target*
@@ -321,6 +373,19 @@ namespace build2
       false
     };
 
+    const target_type pch::static_type
+    {
+      "pch",
+      &target::static_type,
+      &g_factory<pch, pche, pcha, pchs>,
+      nullptr,
+      nullptr,
+      nullptr,
+      nullptr,
+      &target_search,
+      false
+    };
+
     // The same as g_factory() but without E.
     //
     static target*
@@ -197,6 +197,73 @@ namespace build2
       virtual const target_type& dynamic_type () const {return static_type;}
     };
 
+    // Precompiled header (PCH).
+    //
+    // The pch{} group is similar to obj{} in that the compilation options
+    // (and thus the resulting file) depend on the object type that it is
+    // used for. Specified as a prerequisite of lib{}/exe{} (or obj{}), it is
+    // compiled from its header prerequisite once and then used by every
+    // translation unit that the library/executable is built from, for
+    // example:
+    //
+    // lib{foo}: {hxx cxx}{** -pch} pch{pch}
+    // pch{pch}: hxx{pch}
+    //
+    // Note that the header is force-included into each such translation
+    // unit so it need not (but may) be #include'd explicitly. The PCH file
+    // format is compiler-specific and there is no object file.
+    //
+    // Common base of all pchX{} precompiled header files.
+    //
+    class LIBBUILD2_BIN_SYMEXPORT pchx: public file
+    {
+    public:
+      using file::file;
+
+    public:
+      static const target_type static_type;
+    };
+
+    class LIBBUILD2_BIN_SYMEXPORT pche: public pchx
+    {
+    public:
+      using pchx::pchx;
+
+    public:
+      static const target_type static_type;
+      virtual const target_type& dynamic_type () const {return static_type;}
+    };
+
+    class LIBBUILD2_BIN_SYMEXPORT pcha: public pchx
+    {
+    public:
+      using pchx::pchx;
+
+    public:
+      static const target_type static_type;
+      virtual const target_type& dynamic_type () const {return static_type;}
+    };
+
+    class LIBBUILD2_BIN_SYMEXPORT pchs: public pchx
+    {
+    public:
+      using pchx::pchx;
+
+    public:
+      static const target_type static_type;
+      virtual const target_type& dynamic_type () const {return static_type;}
+    };
+
+    class LIBBUILD2_BIN_SYMEXPORT pch: public target
+    {
+    public:
+      using target::target;
+
+    public:
+      static const target_type static_type;
+      virtual const target_type& dynamic_type () const {return static_type;}
+    };
+
 
     // Common base for lib{} and libul{} groups.
     //
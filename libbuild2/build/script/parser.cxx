@@ -3,9 +3,11 @@
 
 #include <libbuild2/build/script/parser.hxx>
 
-#include <libbutl/builtin.mxx>
-
+#include <libbuild2/context.hxx> // sched, keep_going
 #include <libbuild2/algorithm.hxx>
+#include <libbuild2/filesystem.hxx>
+
+#include <libbuild2/script/builtin.hxx>
 
 #include <libbuild2/build/script/lexer.hxx>
 #include <libbuild2/build/script/runner.hxx>
@@ -157,6 +159,25 @@ namespace build2
         line_type lt (
           pre_parse_line_start (t, tt, lexer_mode::second_token));
 
+        // Handle the parallel block start, which is the unquoted 'parallel'
+        // word alone on the line. Note that the line itself is not saved.
+        //
+        if (lt == line_type::cmd                &&
+            tt == type::word                    &&
+            t.qtype == quote_type::unquoted     &&
+            t.value == "parallel"               &&
+            peek (lexer_mode::second_token) == type::newline)
+        {
+          if (level_ != 0)
+            fail (t) << "'parallel' inside flow control construct";
+
+          next (t, tt); // Newline.
+          replay_data (); // Stop saving.
+
+          pre_parse_parallel (t, tt);
+          return;
+        }
+
         line ln;
 
         // Indicates that the parsed line should by default be appended to the
@@ -302,6 +323,62 @@ namespace build2
         }
       }
 
+      void parser::
+      pre_parse_parallel (token& t, type& tt)
+      {
+        // enter: newline after 'parallel'
+        // leave: newline after 'end'
+
+        // Parse lines until we see closing 'end'. The lines in the parallel
+        // block are executed concurrently and so we only allow commands
+        // (variable assignments, flow control constructs, and special
+        // builtins would depend on the execution order).
+        //
+        size_t b (script_->lines.size ());
+
+        ++level_;
+
+        for (;;)
+        {
+          tt = peek (lexer_mode::first_token);
+
+          const token& p (peeked ());
+          const location ll (get_location (p));
+
+          if (tt == type::eos)
+            fail (ll) << "expected closing 'end'";
+
+          if (tt == type::word                &&
+              p.qtype == quote_type::unquoted &&
+              p.value == "end")
+          {
+            next (t, tt); // 'end'
+            next (t, tt);
+
+            if (tt != type::newline)
+              fail (t) << "expected newline instead of " << t;
+
+            break;
+          }
+
+          size_t i (script_->lines.size ());
+
+          pre_parse_line (t, tt);
+          assert (tt == type::newline);
+
+          if (script_->lines.size () != i + 1 ||
+              script_->lines[i].type != line_type::cmd)
+            fail (ll) << "only command lines allowed in parallel block";
+        }
+
+        --level_;
+
+        size_t e (script_->lines.size ());
+
+        if (b != e)
+          script_->parallel_blocks.emplace_back (b, e);
+      }
+
       command_expr parser::
       parse_command_line (token& t, type& tt)
       {
@@ -729,7 +806,7 @@ namespace build2
 
           // Try to interpret the name as a builtin.
           //
-          const builtin_info* bi (builtins.find (v));
+          const builtin_info* bi (build2::script::find_builtin (v));
 
           if (bi != nullptr)
           {
@@ -827,7 +904,7 @@ namespace build2
           command_expr ce (
             parse_command_line (t, static_cast<token_type&> (tt)));
 
-          runner_->run (*environment_, ce, li, ll);
+          runner_->run (*environment_, ce, li, ll, nullptr /* err */);
         };
 
         auto exec_if = [this] (token& t, build2::script::token_type& tt,
@@ -844,14 +921,219 @@ namespace build2
 
         size_t li (1);
 
-        exec_lines (s.lines.begin (), s.lines.end (),
-                    exec_set, exec_cmd, exec_if,
-                    li,
-                    &environment_->var_pool);
+        const lines& ls (s.lines);
+
+        // Determine if the script contains a single command (and,
+        // potentially, variable assignments). Note that we cannot leave it
+        // to exec_lines() since the parallel blocks split the script into
+        // multiple lines ranges.
+        //
+        bool single (false);
+        for (const line& l: ls)
+        {
+          if (l.type != line_type::var)
+          {
+            if (single || l.type != line_type::cmd)
+            {
+              single = false;
+              break;
+            }
+
+            single = true;
+          }
+        }
+
+        // Execute the lines interleaving them with the parallel blocks, if
+        // any. Note that exec_lines() returns false if the script is exited.
+        //
+        lines::const_iterator i (ls.begin ());
+
+        for (const pair<size_t, size_t>& b: s.parallel_blocks)
+        {
+          if (!exec_lines (i, ls.begin () + b.first,
+                           exec_set, exec_cmd, exec_if,
+                           li,
+                           &environment_->var_pool,
+                           single))
+          {
+            i = ls.end ();
+            break;
+          }
+
+          i = ls.begin () + b.second;
+          exec_parallel (ls.begin () + b.first, i, li, single);
+        }
+
+        if (i != ls.end ())
+          exec_lines (i, ls.end (),
+                      exec_set, exec_cmd, exec_if,
+                      li,
+                      &environment_->var_pool,
+                      single);
 
         runner_->leave (*environment_, s.end_loc);
       }
 
+      void parser::
+      exec_parallel (lines::const_iterator b,
+                     lines::const_iterator e,
+                     size_t& li,
+                     bool single)
+      {
+        // Parse (and thus expand) the command lines serially and in order
+        // and start their asynchronous execution. Then wait for all of them
+        // to complete and fail if any of them has failed. Note that the
+        // commands are executed by the scheduler and so are subject to the
+        // overall parallelism limit (-j).
+        //
+        // Since the commands share the environment, we make sure that the
+        // temporary directory is created beforehand rather than on demand by
+        // one of them. We also don't allow the set and exit builtins since
+        // their effect would depend on the execution order.
+        //
+        // To prevent the commands output from interleaving, we redirect
+        // their stderr (which is also where stdout goes by default) to a
+        // file in the temporary directory, unless redirected explicitly, and
+        // buffer the runner diagnostics. Once all the commands complete, we
+        // issue all this in the command lines order (for each command line
+        // its output first, followed by the diagnostics).
+        //
+        environment& env (*environment_);
+
+        if (env.temp_dir.path.empty ())
+          env.create_temp_dir ();
+
+        struct parallel_command
+        {
+          command_expr expr;
+          size_t       index;
+          location     loc;
+          path         err;  // Buffered stderr.
+          string       diag; // Buffered diagnostics.
+          bool         failed;
+        };
+
+        vector<parallel_command> cs;
+        cs.reserve (e - b); // Make sure there are no reallocations.
+
+        atomic_count task_count (0);
+        wait_guard wg (ctx, task_count);
+
+        for (lines::const_iterator i (b); i != e; ++i)
+        {
+          assert (i->type == line_type::cmd && path_ == nullptr);
+
+          // Copy the tokens and start playing.
+          //
+          replay_data (replay_tokens (i->tokens));
+
+          token t;
+          type tt;
+          next (t, tt);
+
+          const location ll (get_location (t));
+
+          command_expr ce (parse_command_line (t, tt));
+
+          replay_stop ();
+
+          for (const expr_term& et: ce)
+          {
+            for (const build2::script::command& c: et.pipe)
+            {
+              const process_path& p (c.program);
+
+              if (p.initial == nullptr &&
+                  (p.recall.string () == "set" ||
+                   p.recall.string () == "exit"))
+                fail (ll) << "'" << p.recall << "' builtin call inside "
+                          << "parallel block";
+            }
+          }
+
+          cs.push_back (
+            parallel_command {
+              move (ce),
+              single ? 0 : li,
+              ll,
+              env.temp_dir.path / path ("stderr-parallel-" + to_string (li)),
+              string (),
+              false});
+          ++li;
+
+          parallel_command& pc (cs.back ());
+
+          if (!ctx.sched.async (task_count,
+                                [] (const diag_frame* ds,
+                                    runner& r,
+                                    environment& env,
+                                    parallel_command& pc)
+                                {
+                                  diag_frame::stack_guard dsg (ds);
+                                  diag_buffer_guard dbg (pc.diag);
+
+                                  redirect er (redirect_type::file);
+                                  er.file.path = pc.err;
+                                  er.file.mode =
+                                    build2::script::redirect_fmode::append;
+
+                                  try
+                                  {
+                                    r.run (env,
+                                           pc.expr, pc.index, pc.loc,
+                                           &er);
+                                  }
+                                  catch (const failed&)
+                                  {
+                                    pc.failed = true;
+                                  }
+                                },
+                                diag_frame::stack (),
+                                ref (*runner_),
+                                ref (env),
+                                ref (pc)))
+          {
+            // Executed synchronously. If failed and we were not asked to
+            // keep going, bail out.
+            //
+            if (pc.failed && !ctx.keep_going)
+              break;
+          }
+        }
+
+        wg.wait ();
+
+        bool r (true);
+
+        for (const parallel_command& pc: cs)
+        {
+          string s;
+
+          if (exists (pc.err))
+          try
+          {
+            ifdstream is (pc.err);
+            s = is.read_text ();
+            is.close ();
+          }
+          catch (const io_error& e)
+          {
+            fail (pc.loc) << "unable to read " << pc.err << ": " << e;
+          }
+
+          s += pc.diag;
+
+          if (!s.empty ())
+            diag_stream_lock () << s;
+
+          if (pc.failed)
+            r = false;
+        }
+
+        if (!r)
+          throw failed ();
+      }
+
       names parser::
       execute_special (const scope& rs, const scope& bs,
                        environment& e,
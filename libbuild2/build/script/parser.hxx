@@ -57,6 +57,9 @@ namespace build2
         void
         pre_parse_if_else (token&, token_type&);
 
+        void
+        pre_parse_parallel (token&, token_type&);
+
         command_expr
         parse_command_line (token&, token_type&);
 
@@ -81,6 +84,12 @@ namespace build2
         void
         exec_script ();
 
+        void
+        exec_parallel (lines::const_iterator begin,
+                       lines::const_iterator end,
+                       size_t& li,
+                       bool single);
+
         // Helpers.
         //
       public:
@@ -184,13 +193,15 @@ namespace build2
         //
         line* save_line_;
 
-        // The if-else nesting level (and in the future for other flow
-        // control constructs).
+        // The if-else and parallel blocks nesting level (and in the future
+        // for other flow control constructs).
         //
         // Maintained during pre-parsing and is incremented when the cmd_if or
         // cmd_ifn lines are encountered, which in particular means that it is
         // already incremented by the time the if-condition expression is
         // pre-parsed. Decremented when the cmd_end line is encountered.
+        // Similarly, incremented and decremented at the parallel block
+        // boundaries.
         //
         size_t level_ = 0;
 
@@ -35,7 +35,8 @@ namespace build2
         run (environment&,
              const command_expr& e,
              size_t i,
-             const location&) override
+             const location&,
+             const redirect*) override
         {
           cout << e;
 
@@ -97,7 +97,8 @@ namespace build2
       run (environment& env,
            const command_expr& expr,
            size_t li,
-           const location& ll)
+           const location& ll,
+           const redirect* err)
       {
         if (verb >= 3)
           text << ":  " << expr;
@@ -115,7 +116,7 @@ namespace build2
                               (p.recall.string () == "set" ||
                                p.recall.string () == "exit");
                      }) != expr.end ())
-          build2::script::run (env, expr, li, ll);
+          build2::script::run (env, expr, li, ll, err);
         else if (verb >= 2)
           text << expr;
       }
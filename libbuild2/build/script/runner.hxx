@@ -32,11 +32,16 @@ namespace build2
         // Location is the start position of this command line in the script.
         // It can be used in diagnostics.
         //
+        // If the stderr redirect is not NULL, then it is used as the default
+        // one instead of the environment's (see build2::script::run() for
+        // details).
+        //
         virtual void
         run (environment&,
              const command_expr&,
              size_t index,
-             const location&) = 0;
+             const location&,
+             const redirect* err) = 0;
 
         virtual bool
         run_if (environment&,
@@ -66,7 +71,8 @@ namespace build2
         run (environment&,
              const command_expr&,
              size_t,
-             const location&) override;
+             const location&,
+             const redirect*) override;
 
         virtual bool
         run_if (environment&,
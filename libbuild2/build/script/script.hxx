@@ -45,6 +45,12 @@ namespace build2
         //
         lines_type lines;
 
+        // Parallel blocks as the [begin, end) ranges of the lines indexes in
+        // the script order. Note that the parallel and end lines themselves
+        // are not saved (see the script parser for details).
+        //
+        vector<pair<size_t, size_t>> parallel_blocks;
+
         // Referenced ordinary (non-special) variables.
         //
         // Used for the script semantics change tracking. The variable list is
@@ -21,70 +21,91 @@ namespace build2
   {
     using namespace bin;
 
-    // Recursively process prerequisite libraries of the specified library. If
-    // proc_impl returns false, then only process interface (*.export.libs),
-    // otherwise -- interface and implementation (prerequisite and from
-    // *.libs, unless overriden with *.export.imp_libs).
-    //
-    // Note that here we assume that an interface library is also always an
-    // implementation (since we don't use *.export.libs for static linking).
-    // We currently have this restriction to make sure the target in
-    // *.export.libs is up-to-date (which will happen automatically if it is
-    // listed as a prerequisite of this library).
-    //
-    // Storing a reference to library path in proc_lib is legal (it comes
-    // either from the target's path or from one of the *.libs variables
-    // neither of which should change on this run).
-    //
-    // Note that the order of processing is:
+    // Determine if an absolute path is to a system library. Note that we
+    // assume both paths to be normalized.
     //
-    // 1. options (x.* then cc.* to be consistent with poptions/loptions)
-    // 2. lib itself (if self is true)
-    // 3. dependency libs (prerequisite_targets, left to right, depth-first)
-    // 4. dependency libs (*.libs variables).
-    //
-    // The first argument to proc_lib is a pointer to the last element of an
-    // array that contains the current library dependency chain all the way to
-    // the library passed to process_libraries(). The first element of this
-    // array is NULL.
+    static bool
+    sys_library (const dir_paths& sysd, const string& p)
+    {
+      size_t pn (p.size ());
+
+      for (const dir_path& d: sysd)
+      {
+        const string& ds (d.string ()); // Can be "/", otherwise no slash.
+        size_t dn (ds.size ());
+
+        if (pn > dn &&
+            p.compare (0, dn, ds) == 0 &&
+            (path::traits_type::is_separator (ds[dn - 1]) ||
+             path::traits_type::is_separator (p[dn])))
+          return true;
+      }
+
+      return false;
+    }
+
+    bool common::library_key::
+    operator< (const library_key& y) const
+    {
+      return tie (inner, outer, lib, impl, bs, sysd, ot, lo) <
+        tie (y.inner, y.outer, y.lib, y.impl, y.bs, y.sysd, y.ot, y.lo);
+    }
+
+    auto common::
+    library_graph_key (action a,
+                       const scope& bs,
+                       linfo li,
+                       const dir_paths& sysd,
+                       const file& l,
+                       bool impl,
+                       const string*& t) const -> library_key
+    {
+      // See what type of library this is (C, C++, etc). Note: lookup
+      // starting from rule-specific variables (target should already be
+      // matched).
+      //
+      t = cast_null<string> (l.state[a][c_type]);
+
+      return t == nullptr || *t == "cc"
+        ? library_key {a.inner_id, a.outer_id, &l, impl,
+                       &bs, &sysd, li.type, li.order}
+        : library_key {a.inner_id, a.outer_id, &l, impl,
+                       nullptr, nullptr, otype::e, lorder::a};
+    }
+
+    // Calculate (or return the cached) library node. See process_libraries()
+    // for the semantics.
     //
-    void common::
-    process_libraries (
-      action a,
-      const scope& top_bs,
-      linfo top_li,
-      const dir_paths& top_sysd,
-      const file& l,
-      bool la,
-      lflags lf,
-      const function<bool (const file&,
-                           bool la)>& proc_impl, // Implementation?
-      const function<void (const file* const*,   // Can be NULL.
-                           const string& path,   // Library path.
-                           lflags,               // Link flags.
-                           bool sys)>& proc_lib, // True if system library.
-      const function<void (const file&,
-                           const string& type,   // cc.type
-                           bool com,             // cc. or x.
-                           bool exp)>& proc_opt, // *.export.
-      bool self /*= false*/,                     // Call proc_lib on l?
-      small_vector<const file*, 16>* chain) const
+    auto common::
+    library_graph (action a,
+                   const scope& top_bs,
+                   linfo top_li,
+                   const dir_paths& top_sysd,
+                   const file& l,
+                   bool impl) const -> const library_node&
     {
-      small_vector<const file*, 16> chain_storage;
-      if (chain == nullptr)
+      const string* t;
+      library_key k (
+        library_graph_key (a, top_bs, top_li, top_sysd, l, impl, t));
+
       {
-        chain = &chain_storage;
-        chain->push_back (nullptr);
+        mlock ml (library_mutex_);
+
+        auto i (library_nodes_.find (k));
+        if (i != library_nodes_.end ())
+          return i->second;
       }
 
-      // See what type of library this is (C, C++, etc). Use it do decide
-      // which x.libs variable name to use. If it's unknown, then we only
-      // look into prerequisites. Note: lookup starting from rule-specific
-      // variables (target should already be matched).
+      // Note that we calculate the node without holding the lock (resolving
+      // the libraries may involve loading the pkg-config files, etc). This
+      // means another thread may end up calculating the same node in which
+      // case we keep the first one.
       //
-      const string* t (cast_null<string> (l.state[a][c_type]));
+      library_node n {t, false, false, &top_bs, top_li, &top_sysd, {}};
 
-      bool impl (proc_impl && proc_impl (l, la));
+      // Use the library type to decide which x.libs variable name to use.
+      // If it's unknown, then we only look into prerequisites.
+      //
       bool cc (false), same (false);
 
       auto& vp (top_bs.ctx.var_pool);
@@ -114,92 +135,8 @@ namespace build2
                        ? (impl ? x_export_imp_libs : x_export_libs)
                        : vp[*t + (impl ? ".export.imp_libs" : ".export.libs")]];
 
-        // Process options first.
-        //
-        if (proc_opt)
-        {
-          // If all we know is it's a C-common library, then in both cases we
-          // only look for cc.export.*.
-          //
-          if (cc)
-            proc_opt (l, *t, true, true);
-          else
-          {
-            if (impl)
-            {
-              // Interface and implementation: as discussed above, we can have
-              // two situations: overriden export or default export.
-              //
-              if (c_e_libs.defined () || x_e_libs.defined ())
-              {
-                // NOTE: should this not be from l.vars rather than l? Or
-                // perhaps we can assume non-common values will be set on
-                // libs{}/liba{}.
-                //
-                // Note: options come from *.export.* variables.
-                //
-                proc_opt (l, *t, false, true);
-                proc_opt (l, *t, true, true);
-              }
-              else
-              {
-                // For default export we use the same options as were used to
-                // build the library.
-                //
-                proc_opt (l, *t, false, false);
-                proc_opt (l, *t, true, false);
-              }
-            }
-            else
-            {
-              // Interface: only add *.export.* (interface dependencies).
-              //
-              proc_opt (l, *t, false, true);
-              proc_opt (l, *t, true, true);
-            }
-          }
-        }
-      }
-
-      // Determine if an absolute path is to a system library. Note that
-      // we assume both paths to be normalized.
-      //
-      auto sys = [] (const dir_paths& sysd, const string& p) -> bool
-      {
-        size_t pn (p.size ());
-
-        for (const dir_path& d: sysd)
-        {
-          const string& ds (d.string ()); // Can be "/", otherwise no slash.
-          size_t dn (ds.size ());
-
-          if (pn > dn &&
-              p.compare (0, dn, ds) == 0 &&
-              (path::traits_type::is_separator (ds[dn - 1]) ||
-               path::traits_type::is_separator (p[dn])))
-            return true;
-        }
-
-        return false;
-      };
-
-      // Next process the library itself if requested.
-      //
-      if (self && proc_lib)
-      {
-        chain->push_back (&l);
-
-        // Note that while normally the path is assigned, in case of an import
-        // stub the path to the DLL may not be known and so the path will be
-        // empty (but proc_lib() will use the import stub).
-        //
-        const path& p (l.path ());
-
-        bool s (t != nullptr // If cc library (matched or imported).
-                ? cast_false<bool> (l.vars[c_system])
-                : !p.empty () && sys (top_sysd, p.string ()));
-
-        proc_lib (&chain->back (), p.string (), lf, s);
+        n.exp = c_e_libs.defined () || x_e_libs.defined ();
+        n.system = cast_false<bool> (l.vars[c_system]);
       }
 
       const scope& bs (t == nullptr || cc ? top_bs : l.base_scope ());
@@ -232,7 +169,7 @@ namespace build2
       // not using explicit export. Otherwise, interface dependencies come
       // from the lib{}:*.export.imp_libs below.
       //
-      if (impl && !c_e_libs.defined () && !x_e_libs.defined ())
+      if (impl && !n.exp)
       {
         for (const prerequisite_target& pt: l.prerequisite_targets[a])
         {
@@ -252,15 +189,14 @@ namespace build2
             if (sysd == nullptr) find_sysd ();
             if (!li) find_linfo ();
 
-            process_libraries (a, bs, *li, *sysd,
-                               *f, la, pt.data,
-                               proc_impl, proc_lib, proc_opt, true, chain);
+            n.deps.push_back (
+              library_dependency {f, la, pt.data, false, string (), false});
           }
         }
       }
 
-      // Process libraries (recursively) from *.export.*libs (of type names)
-      // handling import, etc.
+      // Process libraries from *.export.*libs (of type names) handling
+      // import, etc.
       //
       // If it is not a C-common library, then it probably doesn't have any of
       // the *.libs.
@@ -271,7 +207,7 @@ namespace build2
 
         // Determine if a "simple path" is a system library.
         //
-        auto sys_simple = [&sysd, &sys, &find_sysd] (const string& p) -> bool
+        auto sys_simple = [&sysd, &find_sysd] (const string& p) -> bool
         {
           bool s (!path::traits_type::absolute (p));
 
@@ -279,17 +215,16 @@ namespace build2
           {
             if (sysd == nullptr) find_sysd ();
 
-            s = sys (*sysd, p);
+            s = sys_library (*sysd, p);
           }
 
           return s;
         };
 
-        auto proc_int = [&l,
-                         &proc_impl, &proc_lib, &proc_opt, chain,
+        auto proc_int = [&n,
                          &sysd, &usrd,
                          &find_sysd, &find_linfo, &sys_simple,
-                         &bs, a, &li, impl, this] (const lookup& lu)
+                         &bs, a, &li, this] (const lookup& lu)
         {
           const vector<name>* ns (cast_null<vector<name>> (lu));
           if (ns == nullptr || ns->empty ())
@@ -297,17 +232,18 @@ namespace build2
 
           for (auto i (ns->begin ()), e (ns->end ()); i != e; ++i)
           {
-            const name& n (*i);
+            const name& nm (*i);
 
-            if (n.simple ())
+            if (nm.simple ())
             {
               // This is something like -lpthread or shell32.lib so should be
               // a valid path. But it can also be an absolute library path
               // (e.g., something that may come from our .static/shared.pc
               // files).
               //
-              if (proc_lib)
-                proc_lib (nullptr, n.value, 0, sys_simple (n.value));
+              n.deps.push_back (
+                library_dependency {
+                  nullptr, false, 0, false, nm.value, sys_simple (nm.value)});
             }
             else
             {
@@ -319,61 +255,44 @@ namespace build2
               const file& t (
                 resolve_library (a,
                                  bs,
-                                 n,
-                                 (n.pair ? (++i)->dir : dir_path ()),
+                                 nm,
+                                 (nm.pair ? (++i)->dir : dir_path ()),
                                  *li,
                                  *sysd, usrd));
 
-              if (proc_lib)
-              {
-                // This can happen if the target is mentioned in *.export.libs
-                // (i.e., it is an interface dependency) but not in the
-                // library's prerequisites (i.e., it is not an implementation
-                // dependency).
-                //
-                // Note that we used to just check for path being assigned but
-                // on Windows import-installed DLLs may legally have empty
-                // paths.
-                //
-                if (t.mtime () == timestamp_unknown)
-                  fail   << (impl ? "implementation" : "interface")
-                         << " dependency " << t << " is out of date" <<
-                    info << "mentioned in *.export." << (impl ? "imp_" : "")
-                         << "libs of target " << l <<
-                    info << "is it a prerequisite of " << l << "?";
-              }
-
-              // Process it recursively.
-              //
               // @@ Where can we get the link flags? Should we try to find
               //    them in the library's prerequisites? What about installed
               //    stuff?
               //
-              process_libraries (a, bs, *li, *sysd,
-                                 t, t.is_a<liba> () || t.is_a<libux> (), 0,
-                                 proc_impl, proc_lib, proc_opt, true, chain);
+              n.deps.push_back (
+                library_dependency {
+                  &t, t.is_a<liba> () || t.is_a<libux> (), 0, true,
+                  string (), false});
             }
           }
         };
 
         // Process libraries from *.libs (of type strings).
         //
-        auto proc_imp = [&proc_lib, &sys_simple] (const lookup& lu)
+        auto proc_imp = [&n, &sys_simple] (const lookup& lu)
         {
           const strings* ns (cast_null<strings> (lu));
           if (ns == nullptr || ns->empty ())
             return;
 
-          for (const string& n: *ns)
+          for (const string& s: *ns)
           {
             // This is something like -lpthread or shell32.lib so should be a
             // valid path.
             //
-            proc_lib (nullptr, n, 0, sys_simple (n));
+            n.deps.push_back (
+              library_dependency {
+                nullptr, false, 0, false, s, sys_simple (s)});
           }
         };
 
-        // Note: the same structure as when processing options above.
+        // Note: the same structure as when processing options in
+        // process_libraries().
         //
         // If all we know is it's a C-common library, then in both cases we
         // only look for cc.export.*libs.
@@ -389,7 +308,7 @@ namespace build2
             // Interface and implementation: as discussed above, we can have
             // two situations: overriden export or default export.
             //
-            if (c_e_libs.defined () || x_e_libs.defined ())
+            if (n.exp)
             {
               if (c_e_libs) proc_int (c_e_libs);
               if (x_e_libs) proc_int (x_e_libs);
@@ -400,11 +319,8 @@ namespace build2
               // to build the library. Since libraries in (non-export) *.libs
               // are not targets, we don't need to recurse.
               //
-              if (proc_lib)
-              {
-                proc_imp (l[c_libs]);
-                proc_imp (l[same ? x_libs : vp[*t + ".libs"]]);
-              }
+              proc_imp (l[c_libs]);
+              proc_imp (l[same ? x_libs : vp[*t + ".libs"]]);
             }
           }
           else
@@ -417,12 +333,217 @@ namespace build2
         }
       }
 
+      n.bs = &bs;
+      if (li)   n.li = *li;
+      if (sysd) n.sysd = sysd;
+
+      mlock ml (library_mutex_);
+      return library_nodes_.emplace (move (k), move (n)).first->second;
+    }
+
+    // Recursively process prerequisite libraries of the specified library. If
+    // proc_impl returns false, then only process interface (*.export.libs),
+    // otherwise -- interface and implementation (prerequisite and from
+    // *.libs, unless overriden with *.export.imp_libs).
+    //
+    // Note that here we assume that an interface library is also always an
+    // implementation (since we don't use *.export.libs for static linking).
+    // We currently have this restriction to make sure the target in
+    // *.export.libs is up-to-date (which will happen automatically if it is
+    // listed as a prerequisite of this library).
+    //
+    // Storing a reference to library path in proc_lib is legal (it comes
+    // either from the target's path or from one of the *.libs variables
+    // neither of which should change on this run).
+    //
+    // Note that the order of processing is:
+    //
+    // 1. options (x.* then cc.* to be consistent with poptions/loptions)
+    // 2. lib itself (if self is true)
+    // 3. dependency libs (prerequisite_targets, left to right, depth-first)
+    // 4. dependency libs (*.libs variables).
+    //
+    // The first argument to proc_lib is a pointer to the last element of an
+    // array that contains the current library dependency chain all the way to
+    // the library passed to process_libraries(). The first element of this
+    // array is NULL.
+    //
+    // The dependencies of each library are only looked up once and are then
+    // cached (see library_graph() for details).
+    //
+    void common::
+    process_libraries (
+      action a,
+      const scope& top_bs,
+      linfo top_li,
+      const dir_paths& top_sysd,
+      const file& l,
+      bool la,
+      lflags lf,
+      const function<bool (const file&,
+                           bool la)>& proc_impl, // Implementation?
+      const function<void (const file* const*,   // Can be NULL.
+                           const string& path,   // Library path.
+                           lflags,               // Link flags.
+                           bool sys)>& proc_lib, // True if system library.
+      const function<void (const file&,
+                           const string& type,   // cc.type
+                           bool com,             // cc. or x.
+                           bool exp)>& proc_opt, // *.export.
+      bool self /*= false*/,                     // Call proc_lib on l?
+      small_vector<const file*, 16>* chain) const
+    {
+      small_vector<const file*, 16> chain_storage;
+      if (chain == nullptr)
+      {
+        chain = &chain_storage;
+        chain->push_back (nullptr);
+      }
+
+      bool impl (proc_impl && proc_impl (l, la));
+
+      const library_node& n (
+        library_graph (a, top_bs, top_li, top_sysd, l, impl));
+
+      const string* t (n.type);
+
+      // Process options first.
+      //
+      if (proc_opt && t != nullptr)
+      {
+        // If all we know is it's a C-common library, then in both cases we
+        // only look for cc.export.*.
+        //
+        if (*t == "cc")
+          proc_opt (l, *t, true, true);
+        else
+        {
+          // For interface as well as for interface and implementation with
+          // overriden export the options come from *.export.* variables. For
+          // default export we use the same options as were used to build the
+          // library.
+          //
+          // NOTE: should this not be from l.vars rather than l? Or perhaps we
+          // can assume non-common values will be set on libs{}/liba{}.
+          //
+          bool exp (!impl || n.exp);
+
+          proc_opt (l, *t, false, exp);
+          proc_opt (l, *t, true, exp);
+        }
+      }
+
+      // Next process the library itself if requested.
+      //
+      if (self && proc_lib)
+      {
+        chain->push_back (&l);
+
+        // Note that while normally the path is assigned, in case of an import
+        // stub the path to the DLL may not be known and so the path will be
+        // empty (but proc_lib() will use the import stub).
+        //
+        const path& p (l.path ());
+
+        bool s (t != nullptr // If cc library (matched or imported).
+                ? n.system
+                : !p.empty () && sys_library (top_sysd, p.string ()));
+
+        proc_lib (&chain->back (), p.string (), lf, s);
+      }
+
+      // Then the dependencies, recursively.
+      //
+      for (const library_dependency& d: n.deps)
+      {
+        if (d.lib == nullptr)
+        {
+          if (proc_lib)
+            proc_lib (nullptr, d.path, 0, d.sys);
+
+          continue;
+        }
+
+        if (d.check && proc_lib)
+        {
+          // This can happen if the target is mentioned in *.export.libs
+          // (i.e., it is an interface dependency) but not in the library's
+          // prerequisites (i.e., it is not an implementation dependency).
+          //
+          // Note that we used to just check for path being assigned but on
+          // Windows import-installed DLLs may legally have empty paths.
+          //
+          if (d.lib->mtime () == timestamp_unknown)
+            fail   << (impl ? "implementation" : "interface")
+                   << " dependency " << *d.lib << " is out of date" <<
+              info << "mentioned in *.export." << (impl ? "imp_" : "")
+                   << "libs of target " << l <<
+              info << "is it a prerequisite of " << l << "?";
+        }
+
+        process_libraries (a, *n.bs, n.li, *n.sysd,
+                           *d.lib, d.la, d.flags,
+                           proc_impl, proc_lib, proc_opt, true, chain);
+      }
+
       // Remove this library from the chain.
       //
       if (self && proc_lib)
         chain->pop_back ();
     }
 
+    auto common::
+    lib_poptions (action a,
+                  const scope& bs,
+                  linfo li,
+                  const file& l,
+                  bool la) const -> const library_poptions&
+    {
+      // See through utility libraries.
+      //
+      auto imp = [] (const file& l, bool la) {return la && l.is_a<libux> ();};
+
+      const string* t;
+      library_key k (
+        library_graph_key (a, bs, li, sys_lib_dirs, l, imp (l, la), t));
+
+      {
+        mlock ml (library_mutex_);
+
+        auto i (library_poptions_.find (k));
+        if (i != library_poptions_.end ())
+          return i->second;
+      }
+
+      library_poptions r;
+
+      auto opt = [&r, this] (
+        const file& l, const string& t, bool com, bool exp)
+      {
+        // Note that in our model *.export.poptions are always "interface",
+        // even if set on liba{}/libs{}, unlike loptions.
+        //
+        if (!exp) // Ignore libux.
+          return;
+
+        const variable& var (
+          com
+          ? c_export_poptions
+          : (t == x
+             ? x_export_poptions
+             : l.ctx.var_pool[t + ".export.poptions"]));
+
+        r.push_back (library_poption {&l, &var, cast_null<strings> (l[var])});
+      };
+
+      process_libraries (a, bs, li, sys_lib_dirs,
+                         l, la, 0, // Hack: lflags unused.
+                         imp, nullptr, opt);
+
+      mlock ml (library_mutex_);
+      return library_poptions_.emplace (move (k), move (r)).first->second;
+    }
+
     // The name can be an absolute or relative target name (for example,
     // /tmp/libfoo/lib{foo} or ../libfoo/lib{foo}) or a project-qualified
     // relative target name (e.g., libfoo%lib{foo}).
@@ -614,6 +735,11 @@ namespace build2
       {
         context& ctx (p.scope->ctx);
 
+        // Note that we first check the (cached) directory listing and only
+        // get the modification time if the file is there.
+        //
+        directory_cache& dc (ctx.dir_cache);
+
         timestamp mt;
 
         // libs
@@ -626,7 +752,7 @@ namespace build2
         {
           f = d;
           f /= sn;
-          mt = mtime (f);
+          mt = dc.exists (d, sn) ? mtime (f) : timestamp_nonexistent;
 
           if (mt != timestamp_nonexistent)
           {
@@ -677,7 +803,7 @@ namespace build2
             //
             se = string ("dll");
             f = f.base (); // Remove .a from .dll.a.
-            mt = mtime (f);
+            mt = dc.exists (f) ? mtime (f) : timestamp_nonexistent;
 
             if (mt != timestamp_nonexistent)
             {
@@ -696,7 +822,7 @@ namespace build2
           f = d;
           f /= an;
 
-          if ((mt = mtime (f)) != timestamp_nonexistent)
+          if (dc.exists (d, an) && (mt = mtime (f)) != timestamp_nonexistent)
           {
             // Enter the target. Note that because the search paths are
             // normalized, the result is automatically normalized as well.
@@ -734,7 +860,7 @@ namespace build2
             // is no binfull variant.
             //
             pair<path, path> r (
-              pkgconfig_search (d, p.proj, name, na && ns /* common */));
+              pkgconfig_search (ctx, d, p.proj, name, na && ns /* common */));
 
             if (na && !r.first.empty ())
             {
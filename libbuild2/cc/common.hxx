@@ -4,6 +4,8 @@
 #ifndef LIBBUILD2_CC_COMMON_HXX
 #define LIBBUILD2_CC_COMMON_HXX
 
+#include <map>
+
 #include <libbuild2/types.hxx>
 #include <libbuild2/utility.hxx>
 
@@ -271,6 +273,27 @@ namespace build2
         bool = false,
         small_vector<const file*, 16>* = nullptr) const;
 
+      // Interface preprocessor options closure of a library: the values of
+      // the *.export.poptions variables of the library and its interface
+      // dependencies (seeing through utility libraries) in the order they
+      // would be appended (see compile_rule::append_lib_options()). The
+      // value is NULL if the variable is not set.
+      //
+      // The closure is calculated once per library, action, and link info
+      // and is cached. Note that the library should already be matched.
+      //
+      struct library_poption
+      {
+        const file*     lib;
+        const variable* var;
+        const strings*  value;
+      };
+
+      using library_poptions = vector<library_poption>;
+
+      const library_poptions&
+      lib_poptions (action, const scope&, linfo, const file&, bool la) const;
+
       const target*
       search_library (action a,
                       const dir_paths& sysd,
@@ -354,10 +377,13 @@ namespace build2
       using pkgconfig_callback = function<bool (dir_path&& d)>;
 
       bool
-      pkgconfig_derive (const dir_path&, const pkgconfig_callback&) const;
+      pkgconfig_derive (context&,
+                        const dir_path&,
+                        const pkgconfig_callback&) const;
 
       pair<path, path>
-      pkgconfig_search (const dir_path&,
+      pkgconfig_search (context&,
+                        const dir_path&,
                         const optional<project_name>&,
                         const string&,
                         bool) const;
@@ -378,6 +404,86 @@ namespace build2
                       const dir_path&,
                       const dir_paths&,
                       const dir_paths&) const;
+
+    private:
+      // Memoized library dependency graph.
+      //
+      // With deep library stacks the same libraries are processed by
+      // process_libraries() over and over again (once per object file and
+      // then again per link). So we cache the result of the variable
+      // lookups, import resolution, etc., for each library (the node) and
+      // only replay the callbacks on subsequent calls.
+      //
+      // A node is identified by the action, the library, and whether the
+      // implementation is processed. For imported and C-common libraries the
+      // dependencies are resolved in the context of the library's user so
+      // its base scope, system library directories, and link info are part
+      // of the key as well.
+      //
+      // Note that we assume the library's variables and prerequisite targets
+      // do not change once it has been matched, which is already relied
+      // upon by process_libraries().
+      //
+      struct library_dependency
+      {
+        const file* lib;   // NULL if a library path (-lfoo, foo.lib, etc).
+        bool        la;
+        lflags      flags;
+        bool        check; // Check is up to date (from *.export.*libs).
+        string      path;  // Library path if lib is NULL.
+        bool        sys;   // System library if lib is NULL.
+      };
+
+      struct library_node
+      {
+        const string* type;   // cc.type or NULL if unknown.
+        bool          exp;    // *.export.*libs override the default export.
+        bool          system; // cc.system (only if type is not NULL).
+
+        // Context for processing the dependencies.
+        //
+        const scope*     bs;
+        linfo            li;
+        const dir_paths* sysd;
+
+        vector<library_dependency> deps;
+      };
+
+      struct library_key
+      {
+        action_id        inner;
+        action_id        outer;
+        const file*      lib;
+        bool             impl;
+        const scope*     bs;   // NULL unless imported or C-common.
+        const dir_paths* sysd; // Ditto.
+        otype            ot;   // Ditto.
+        lorder           lo;   // Ditto.
+
+        bool
+        operator< (const library_key&) const;
+      };
+
+      const library_node&
+      library_graph (action,
+                     const scope&,
+                     linfo,
+                     const dir_paths&,
+                     const file&,
+                     bool impl) const;
+
+      library_key
+      library_graph_key (action,
+                         const scope&,
+                         linfo,
+                         const dir_paths&,
+                         const file&,
+                         bool impl,
+                         const string*&) const;
+
+      mutable mutex library_mutex_;
+      mutable std::map<library_key, library_node> library_nodes_;
+      mutable std::map<library_key, library_poptions> library_poptions_;
     };
   }
 }
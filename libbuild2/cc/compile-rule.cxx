@@ -164,6 +164,7 @@ namespace build2
 
       unit_type type;
       preprocessed pp = preprocessed::none;
+      bool pch = false;                     // Target is precompiled header.
       bool deferred_failure = false;        // Failure deferred to compilation.
       bool symexport = false;               // Target uses __symexport.
       bool touch = false;                   // Target needs to be touched.
@@ -173,8 +174,70 @@ namespace build2
       path dd;                              // Dependency database path.
       size_t headers = 0;                   // Number of imported header units.
       module_positions modules = {0, 0, 0}; // Positions of imported modules.
+      const file* pch_target = nullptr;     // Precompiled header to use.
+      const file* pch_header = nullptr;     // Its header.
     };
 
+    // Return the compile option for the link-time optimization mode or NULL
+    // if none is necessary. Note that GCC has no notion of ThinLTO (its
+    // default partitioned mode is similar) and neither does MSVC where it is
+    // a link-time choice.
+    //
+    static const char*
+    lto_option (lto_mode m, compiler_type ct)
+    {
+      if (m == lto_mode::none)
+        return nullptr;
+
+      switch (ct)
+      {
+      case compiler_type::gcc:   return "-flto";
+      case compiler_type::clang: return (m == lto_mode::thin
+                                         ? "-flto=thin"
+                                         : "-flto");
+      case compiler_type::msvc:  return "/GL";
+      case compiler_type::icc:   return "-ipo";
+      }
+
+      return nullptr;
+    }
+
+    // Look up the preprocessor options variable (*.poptions) for the target.
+    //
+    // A precompiled header must be compiled with the same preprocessor
+    // options as its users. So for pch*{} we look up the type/pattern-
+    // specific values as for the object file of the same type, for example:
+    //
+    // obja{*}: cxx.poptions += -DLIBFOO_STATIC_BUILD
+    //
+    // The library *.export.poptions are taken care of by the link rule which
+    // adds its library prerequisites to the pch*{} target.
+    //
+    static lookup
+    lookup_poptions (const target& t, const variable& var)
+    {
+      if (!t.is_a<pchx> ())
+        return t[var];
+
+      pair<lookup, size_t> r (t.lookup_original (var, true /* target_only */));
+
+      if (!r.first)
+      {
+        const target_type& ott (
+          compile_types (compile_type (t, unit_type::non_modular)).obj);
+
+        auto p (t.base_scope ().lookup_original (var,
+                                                 &ott, &t.name,
+                                                 &obj::static_type, &t.name));
+        r.first = move (p.first);
+        r.second = r.first ? 2 + p.second : p.second;
+      }
+
+      return var.overrides == nullptr
+        ? r.first
+        : t.base_scope ().lookup_override (var, move (r), true).first;
+    }
+
     compile_rule::
     compile_rule (data&& d)
         : common (move (d)),
@@ -261,8 +324,8 @@ namespace build2
               o1 = "-x";
               switch (x_lang)
               {
-              case lang::c:   o2 = "c";   break;
-              case lang::cxx: o2 = "c++"; break;
+              case lang::c:   o2 = md.pch ? "c-header"   : "c";   break;
+              case lang::cxx: o2 = md.pch ? "c++-header" : "c++"; break;
               }
               break;
             }
@@ -337,12 +400,17 @@ namespace build2
                     t.is_a<bmix> ()  ? unit_type::module_iface  :
                     unit_type::non_modular);
 
-      // Link-up to our group (this is the obj/bmi{} target group protocol
+      // Precompiled header is a non-modular unit compiled from a header.
+      //
+      bool ph (t.is_a<pchx> () != nullptr);
+
+      // Link-up to our group (this is the obj/bmi/pch{} target group protocol
       // which means this can be done whether we match or not).
       //
       if (t.group == nullptr)
         t.group = &search (t,
-                           (ut == unit_type::module_header ? hbmi::static_type:
+                           (ph                             ? pch::static_type :
+                            ut == unit_type::module_header ? hbmi::static_type:
                             ut == unit_type::module_iface  ? bmi::static_type :
                             obj::static_type),
                            t.dir, t.out, t.name);
@@ -359,14 +427,20 @@ namespace build2
           continue;
 
         // For a header unit we check the "real header" plus the C header.
+        // For a precompiled header we only check our headers (which include
+        // the C header for C) so that there is no ambiguity between the C
+        // and C++ rules.
         //
-        if (ut == unit_type::module_header ? p.is_a (**x_hdr) || p.is_a<h> () :
+        if (ph                             ? x_header (p, false)              :
+            ut == unit_type::module_header ? p.is_a (**x_hdr) || p.is_a<h> () :
             ut == unit_type::module_iface  ? p.is_a (*x_mod)                  :
             p.is_a (x_src))
         {
           // Save in the target's auxiliary storage.
           //
-          t.data (match_data (ut, p));
+          match_data md (ut, p);
+          md.pch = ph;
+          t.data (move (md));
           return true;
         }
       }
@@ -386,34 +460,6 @@ namespace build2
                         const target& t,
                         linfo li) const
     {
-      // See through utility libraries.
-      //
-      auto imp = [] (const file& l, bool la) {return la && l.is_a<libux> ();};
-
-      auto opt = [&args, this] (
-        const file& l, const string& t, bool com, bool exp)
-      {
-        // Note that in our model *.export.poptions are always "interface",
-        // even if set on liba{}/libs{}, unlike loptions.
-        //
-        if (!exp) // Ignore libux.
-          return;
-
-        const variable& var (
-          com
-          ? c_export_poptions
-          : (t == x
-             ? x_export_poptions
-             : l.ctx.var_pool[t + ".export.poptions"]));
-
-        append_options (args, l, var);
-      };
-
-      // In case we don't have the "small function object" optimization.
-      //
-      const function<bool (const file&, bool)> impf (imp);
-      const function<void (const file&, const string&, bool, bool)> optf (opt);
-
       for (prerequisite_member p: group_prerequisite_members (a, t))
       {
         if (include (a, t, p) != include_type::normal) // Excluded/ad hoc.
@@ -432,9 +478,15 @@ namespace build2
                 pt->is_a<libs> ()))
             continue;
 
-          process_libraries (a, bs, li, sys_lib_dirs,
-                             pt->as<file> (), la, 0, // Hack: lflags unused.
-                             impf, nullptr, optf);
+          // Note that the closure is cached so this is cheap even if the
+          // library is used by many object files.
+          //
+          for (const library_poption& o:
+                 lib_poptions (a, bs, li, pt->as<file> (), la))
+          {
+            if (o.value != nullptr)
+              append_options (args, *o.value);
+          }
         }
       }
     }
@@ -449,29 +501,8 @@ namespace build2
                          target& t,
                          linfo li) const
     {
-      auto imp = [] (const file& l, bool la) {return la && l.is_a<libux> ();};
-
-      auto opt = [&m, this] (
-        const file& l, const string& t, bool com, bool exp)
-      {
-        if (!exp)
-          return;
-
-        const variable& var (
-          com
-          ? c_export_poptions
-          : (t == x
-             ? x_export_poptions
-             : l.ctx.var_pool[t + ".export.poptions"]));
-
-        append_prefixes (m, l, var);
-      };
-
       // The same logic as in append_lib_options().
       //
-      const function<bool (const file&, bool)> impf (imp);
-      const function<void (const file&, const string&, bool, bool)> optf (opt);
-
       for (prerequisite_member p: group_prerequisite_members (a, t))
       {
         if (include (a, t, p) != include_type::normal) // Excluded/ad hoc.
@@ -488,9 +519,12 @@ namespace build2
                 pt->is_a<libs> ()))
             continue;
 
-          process_libraries (a, bs, li, sys_lib_dirs,
-                             pt->as<file> (), la, 0, // Hack: lflags unused.
-                             impf, nullptr, optf);
+          for (const library_poption& o:
+                 lib_poptions (a, bs, li, pt->as<file> (), la))
+          {
+            if (o.value != nullptr)
+              append_prefixes (m, *o.lib, *o.var);
+          }
         }
       }
     }
@@ -563,7 +597,7 @@ namespace build2
     {
       tracer trace (x, "compile_rule::apply");
 
-      file& t (xt.as<file> ()); // Either obj*{} or bmi*{}.
+      file& t (xt.as<file> ()); // Either obj*{}, bmi*{}, or pch*{}.
 
       match_data& md (t.data<match_data> ());
 
@@ -583,7 +617,7 @@ namespace build2
 
       // Derive file name from target name.
       //
-      string e; // Primary target extension (module or object).
+      string e; // Primary target extension (module, object, or PCH).
       {
         const char* o ("o"); // Object extension (.o or .obj).
 
@@ -625,26 +659,40 @@ namespace build2
           }
         }
 
+        // Note that for GCC the precompiled header file name is the name
+        // of the header that we force-include (see perform_update()) plus
+        // the .gch extension. We give this header the .pch extension so that
+        // it doesn't collide with, say, exe{} of the same name.
+        //
         switch (ctype)
         {
         case compiler_type::gcc:
           {
-            e += (ut != unit_type::non_modular ? "gcm" : o);
+            e += (md.pch                        ? "pch.gch" :
+                  ut != unit_type::non_modular ? "gcm" : o);
             break;
           }
         case compiler_type::clang:
           {
-            e += (ut != unit_type::non_modular ? "pcm" : o);
+            e += (md.pch                        ? "pch" :
+                  ut != unit_type::non_modular ? "pcm" : o);
             break;
           }
         case compiler_type::msvc:
           {
-            e += (ut != unit_type::non_modular ? "ifc" : o);
+            e += (md.pch                        ? "pch" :
+                  ut != unit_type::non_modular ? "ifc" : o);
             break;
           }
         case compiler_type::icc:
           {
             assert (ut == unit_type::non_modular);
+
+            if (md.pch)
+              fail << "precompiled headers are not supported for " << x_lang
+                   << " compiler " << ctype <<
+                info << "required by " << t;
+
             e += o;
           }
         }
@@ -668,6 +716,30 @@ namespace build2
 
       const path& tp (t.derive_path (e.c_str ()));
 
+      // If compiling with split DWARF (-gsplit-dwarf), then the compiler
+      // writes the bulk of the debug information into the .dwo file next to
+      // the object file (with the last extension replaced). Add it as an ad
+      // hoc member so that it is cleaned up, can be packaged by the link
+      // rule, etc.
+      //
+      if (ut == unit_type::non_modular && !md.pch &&
+          (ctype == compiler_type::gcc || ctype == compiler_type::clang) &&
+          tclass != "windows" && tclass != "macos")
+      {
+        if (find_option ("-gsplit-dwarf", cmode)         ||
+            find_option ("-gsplit-dwarf", t, c_coptions) ||
+            find_option ("-gsplit-dwarf", t, x_coptions))
+        {
+          if (const target_type* tt = bs.find_target_type ("dwo"))
+          {
+            file& dwo (add_adhoc_member<file> (t, *tt, e.c_str ()));
+
+            if (dwo.path ().empty ())
+              dwo.derive_path (tp.base (), "dwo");
+          }
+        }
+      }
+
       // Inject dependency on the output directory.
       //
       const fsdir* dir (inject_fsdir (a, t));
@@ -689,6 +761,7 @@ namespace build2
       target_state src_ts1 (target_state::unknown), src_ts2 (src_ts1);
 
       size_t src_i (~0);          // Index of src target.
+      optional<size_t> pch_i;     // Index of pch target, if any.
       size_t start (pts.size ()); // Index of the first to be added.
       for (prerequisite_member p: group_prerequisite_members (a, t))
       {
@@ -743,6 +816,29 @@ namespace build2
         {
           continue;
         }
+        //
+        // A precompiled header is only used when compiling a non-modular
+        // translation unit (and there can only be one). If this is the pch{}
+        // group, then pick the appropriate member.
+        //
+        else if (pi == include_type::normal &&
+                 (p.is_a<pch> () || p.is_a (tts.pch)))
+        {
+          if (md.pch || ut != unit_type::non_modular)
+            continue;
+
+          if (pch_i)
+            fail << "multiple precompiled headers for target " << t <<
+              info << "first is " << *pts[*pch_i].target <<
+              info << "second is " << p;
+
+          pt = &search (t, tts.pch, p.key ());
+
+          if (a.operation () == clean_id && !pt->dir.sub (rs.out_path ()))
+            continue;
+
+          pch_i = pts.size ();
+        }
         else
         {
           pt = &p.search (t);
@@ -796,6 +892,30 @@ namespace build2
           src_ts2 = mr.second;
       }
 
+      // If we are using a precompiled header, then also get its header
+      // which we force-include (see perform_update() for details). We find
+      // it the same way as match() does and since the precompiled header
+      // has been matched, so has the header.
+      //
+      if (pch_i && pts[*pch_i] != nullptr)
+      {
+        const file& p (pts[*pch_i]->as<file> ());
+
+        for (prerequisite_member pm: reverse_group_prerequisite_members (a, p))
+        {
+          if (include (a, p, pm) == include_type::normal &&
+              x_header (pm, false))
+          {
+            md.pch_target = &p;
+            md.pch_header = &pm.search (p).as<file> ();
+            break;
+          }
+        }
+
+        if (md.pch_header == nullptr)
+          fail << "no " << x_lang << " header for precompiled header " << p;
+      }
+
       // Inject additional prerequisites. We only do it when performing update
       // since chances are we will have to update some of our prerequisites in
       // the process (auto-generated source code, header units).
@@ -883,14 +1003,19 @@ namespace build2
 
           if (md.pp != preprocessed::all)
           {
-            append_options (cs, t, x_poptions);
-            append_options (cs, t, c_poptions);
+            append_options (cs, lookup_poptions (t, x_poptions));
+            append_options (cs, lookup_poptions (t, c_poptions));
 
             // Hash *.export.poptions from prerequisite libraries.
             //
             append_lib_options (bs, cs, a, t, li);
           }
 
+          // Note: before coptions so that it can be overridden.
+          //
+          if (const char* o = lto_option (lto_type (t), ctype))
+            cs.append (o);
+
           append_options (cs, t, c_coptions);
           append_options (cs, t, x_coptions);
 
@@ -907,6 +1032,15 @@ namespace build2
           if (md.pp != preprocessed::all)
             append_sys_inc_options (cs); // Extra system header dirs (last).
 
+          // The precompiled header we use and its header (which we
+          // force-include).
+          //
+          if (md.pch_target != nullptr)
+          {
+            cs.append (md.pch_target->path ().string ());
+            cs.append (md.pch_header->path ().string ());
+          }
+
           if (dd.expect (cs.string ()) != nullptr)
             l4 ([&]{trace << "options mismatch forcing update of " << t;});
         }
@@ -982,9 +1116,13 @@ namespace build2
         // hoc/out-of-band compiler input file that is passed via the command
         // line. So, to be safe, we make sure everything is up to date.
         //
+        // Note that the precompiled header is not needed for extracting
+        // dependencies (we force-include its header instead) so we leave it
+        // to be updated in parallel during execute.
+        //
         for (const target* pt: pts)
         {
-          if (pt == nullptr || pt == dir)
+          if (pt == nullptr || pt == dir || pt == md.pch_target)
             continue;
 
           u = update (trace, a, *pt, u ? timestamp_unknown : mt) || u;
@@ -1060,9 +1198,11 @@ namespace build2
               }
               //
               // Don't clear the update flag if it was forced or the checksum
-              // should not be relied upon.
+              // should not be relied upon. The latter is also the case for a
+              // precompiled header since Clang verifies that the headers it
+              // was compiled from have not been modified since.
               //
-              else if (first && !p.second.empty ())
+              else if (first && !p.second.empty () && !md.pch)
               {
                 // Clear the update flag and set the touch flag. Unless there
                 // is no (usable) object file, of course. See also the md.mt
@@ -1170,6 +1310,16 @@ namespace build2
           }
         }
 
+        // The whole point of a precompiled header is not to re-process its
+        // header so compile the original source if we are using one. We
+        // also compile the precompiled header itself from the original
+        // header so that it refers to the real header files (which, for
+        // example, makes #pragma once work in the translation units that
+        // also #include it explicitly).
+        //
+        if (md.pch || md.pch_target != nullptr)
+          psrc.second = false;
+
         // If anything got updated, then we didn't rely on the cache. However,
         // the cached data could actually have been valid and the compiler run
         // in extract_headers() as well as the code above merely validated it.
@@ -1296,7 +1446,7 @@ namespace build2
       const dir_path& out_base (t.dir);
       const dir_path& out_root (rs->out_path ());
 
-      if (auto l = t[var])
+      if (auto l = lookup_poptions (t, var))
       {
         const auto& v (cast<strings> (l));
 
@@ -2901,8 +3051,8 @@ namespace build2
           if (reprocess)
             args.push_back ("-D__build2_preprocess");
 
-          append_options (args, t, x_poptions);
-          append_options (args, t, c_poptions);
+          append_options (args, lookup_poptions (t, x_poptions));
+          append_options (args, lookup_poptions (t, c_poptions));
 
           // Add *.export.poptions from prerequisite libraries.
           //
@@ -3057,6 +3207,17 @@ namespace build2
           append_options (args, t, c_coptions, werror);
           append_options (args, t, x_coptions, werror);
 
+          // If we are using a precompiled header, then force-include its
+          // header (see perform_update() for details). This way we get its
+          // header dependencies as our own which is exactly what we want.
+          //
+          if (md.pch_header != nullptr)
+          {
+            args.push_back (
+              cclass == compiler_class::msvc ? "/FI" : "-include");
+            args.push_back (md.pch_header->path ().string ().c_str ());
+          }
+
           switch (cclass)
           {
           case compiler_class::msvc:
@@ -3594,7 +3755,7 @@ namespace build2
                 // For VC with /P the dependency info and diagnostics all go
                 // to stderr so redirect it to stdout.
                 //
-                pr = process (
+                pr = process_spawn (
                   cpath,
                   args.data (),
                   0,
@@ -3605,13 +3766,13 @@ namespace build2
               }
               else // Dependency info goes to a temporary file.
               {
-                pr = process (cpath,
-                              args.data (),
-                              mod_mapper ? -1 : 0,
-                              mod_mapper ? -1 : 2, // Send stdout to stderr.
-                              gen ? 2 : sense_diag ? -1 : -2,
-                              nullptr, // CWD
-                              env.empty () ? nullptr : env.data ());
+                pr = process_spawn (cpath,
+                                    args.data (),
+                                    mod_mapper ? -1 : 0,
+                                    mod_mapper ? -1 : 2, // Stdout to stderr.
+                                    gen ? 2 : sense_diag ? -1 : -2,
+                                    nullptr, // CWD
+                                    env.empty () ? nullptr : env.data ());
 
                 // Monitor for module mapper requests and/or diagnostics. If
                 // diagnostics is detected, mark the preprocessed output as
@@ -4287,8 +4448,8 @@ namespace build2
           if (reprocess)
             args.push_back ("-D__build2_preprocess");
 
-          append_options (args, t, x_poptions);
-          append_options (args, t, c_poptions);
+          append_options (args, lookup_poptions (t, x_poptions));
+          append_options (args, lookup_poptions (t, c_poptions));
 
           append_lib_options (t.base_scope (), args, a, t, li);
 
@@ -4423,11 +4584,11 @@ namespace build2
             // We don't want to see warnings multiple times so ignore all
             // diagnostics.
             //
-            pr = process (cpath,
-                          args.data (),
-                          0, -1, -2,
-                          nullptr, // CWD
-                          env.empty () ? nullptr : env.data ());
+            pr = process_spawn (cpath,
+                                args.data (),
+                                0, -1, -2,
+                                nullptr, // CWD
+                                env.empty () ? nullptr : env.data ());
           }
 
           // Use binary mode to obtain consistent positions.
@@ -5328,27 +5489,7 @@ namespace build2
       // cc.config module and that is within our amalgmantion seems like a
       // good place.
       //
-      const scope* as (&rs);
-      {
-        const scope* ws (as->weak_scope ());
-        if (as != ws)
-        {
-          const scope* s (as);
-          do
-          {
-            s = s->parent_scope ()->root_scope ();
-
-            // Use cc.core.vars as a proxy for {c,cxx}.config (a bit smelly).
-            //
-            // This is also the module that registers the scope operation
-            // callback that cleans up the subproject.
-            //
-            if (cast_false<bool> ((*s)["cc.core.vars.loaded"]))
-              as = s;
-
-          } while (s != ws);
-        }
-      }
+      const scope* as (&outer_root (rs));
 
       // We build modules in a subproject (since there might be no full
       // language support loaded in the amalgamation, only *.config). So the
@@ -5827,7 +5968,7 @@ namespace build2
 
       // While all our prerequisites are already up-to-date, we still have to
       // execute them to keep the dependency counts straight. Actually, no, we
-      // may also have to update the modules.
+      // may also have to update the modules and the precompiled header.
       //
       // Note that this also takes care of forcing update on any ad hoc
       // prerequisite change.
@@ -5837,9 +5978,12 @@ namespace build2
           md.src.type (),
           a, t,
           md.mt,
-          [s = md.modules.start] (const target&, size_t i)
+          [s = md.modules.start, p = md.pch_target] (const target& pt,
+                                                     size_t i)
           {
-            return s != 0 && i >= s; // Only compare timestamps for modules.
+            // Only compare timestamps for modules and precompiled header.
+            //
+            return (s != 0 && i >= s) || &pt == p;
           },
           md.modules.copied)); // See search_modules() for details.
 
@@ -5884,12 +6028,28 @@ namespace build2
       // If we are building a module interface, then the target is bmi*{} and
       // its ad hoc member is obj*{}. For header units there is no obj*{}.
       //
+      // If we are building a precompiled header with MSVC, then it also
+      // produces an object file which we don't need (see below).
+      //
+      bool msvc_pch (md.pch && cclass == compiler_class::msvc);
+
       path relm;
       path relo (ut == unit_type::module_header
                  ? path ()
                  : relative (ut == unit_type::module_iface
                              ? find_adhoc_member<file> (t, tts.obj)->path ()
-                             : tp));
+                             : msvc_pch ? tp + ".obj" : tp));
+
+      // MSVC can only produce a precompiled header as part of compiling a
+      // source file so we compile a stub that only force-includes the
+      // header (written below).
+      //
+      path stub;
+      if (msvc_pch)
+      {
+        stub = tp + (x_lang == lang::c ? ".c" : ".cpp");
+        sp = &stub;
+      }
 
       // Build the command line.
       //
@@ -5900,8 +6060,8 @@ namespace build2
         // contrast to the "last value wins" semantics that we assume for
         // coptions).
         //
-        append_options (args, t, x_poptions);
-        append_options (args, t, c_poptions);
+        append_options (args, lookup_poptions (t, x_poptions));
+        append_options (args, lookup_poptions (t, c_poptions));
 
         // Add *.export.poptions from prerequisite libraries.
         //
@@ -5911,10 +6071,15 @@ namespace build2
           append_symexport_options (args, t);
       }
 
+      if (const char* o = lto_option (lto_type (t), ctype))
+        args.push_back (o);
+
       append_options (args, t, c_coptions);
       append_options (args, t, x_coptions);
 
       string out, out1;                    // Output options storage.
+      string pch1, pch2;                   // Precompiled header options.
+      path pch_inc;                        // Precompiled header include.
       small_vector<string, 2> header_args; // Header unit options storage.
       small_vector<string, 2> module_args; // Module options storage.
 
@@ -5974,6 +6139,48 @@ namespace build2
 
         msvc_sanitize_cl (args);
 
+        // Precompiled header options.
+        //
+        // We create the precompiled header at the end of the force-included
+        // header (/Yc) and use it in place of the same force-included header
+        // (/Yu). We also disable the reference symbol (/Yl-) that would
+        // otherwise require linking the object file produced together with
+        // the precompiled header.
+        //
+        // The per-object file .pdb that we use for /Zi and /ZI (see below)
+        // is incompatible with precompiled headers. So in this case we fail
+        // for the precompiled header itself and only force-include the
+        // header for its users (who may have their own options).
+        //
+        if (md.pch || md.pch_target != nullptr)
+        {
+          bool zi (find_options ({"/Zi", "/ZI"}, args));
+
+          if (md.pch && zi)
+            fail << "unable to compile precompiled header " << t << " with "
+                 << "/Zi or /ZI" <<
+              info << "use /Z7 instead";
+
+          const path& h (md.pch ? s.path () : md.pch_header->path ());
+
+          if (!zi)
+          {
+            pch1 = md.pch ? "/Yc" : "/Yu";
+            pch1 += h.string ();
+            args.push_back (pch1.c_str ());
+
+            pch2 = "/Fp";
+            pch2 += (md.pch ? tp : md.pch_target->path ()).string ();
+            args.push_back (pch2.c_str ());
+
+            if (md.pch)
+              args.push_back ("/Yl-");
+          }
+
+          args.push_back ("/FI");
+          args.push_back (h.string ().c_str ());
+        }
+
         append_header_options (env, args, header_args, a, t, md, md.dd);
         append_module_options (env, args, module_args, a, t, md, md.dd);
 
@@ -6126,6 +6333,41 @@ namespace build2
         if (md.pp != preprocessed::all)
           append_sys_inc_options (args); // Extra system header dirs (last).
 
+        // Precompiled header options.
+        //
+        // When (force-)including a header GCC first looks for the .gch file
+        // next to it and falls back to the header itself if the precompiled
+        // header cannot be used (for example, because of incompatible
+        // options). So we force-include a header that we generate next to
+        // the precompiled header and which includes the real header (see
+        // below). Clang, on the other hand, can use the precompiled header
+        // directly.
+        //
+        if (md.pch_target != nullptr)
+        {
+          switch (ctype)
+          {
+          case compiler_type::gcc:
+            {
+              pch_inc = md.pch_target->path ().base ();
+
+              args.push_back ("-Winvalid-pch");
+              args.push_back ("-include");
+              args.push_back (pch_inc.string ().c_str ());
+              break;
+            }
+          case compiler_type::clang:
+            {
+              args.push_back ("-include-pch");
+              args.push_back (md.pch_target->path ().string ().c_str ());
+              break;
+            }
+          case compiler_type::msvc:
+          case compiler_type::icc:
+            assert (false);
+          }
+        }
+
         append_header_options (env, args, header_args, a, t, md, md.dd);
         append_module_options (env, args, module_args, a, t, md, md.dd);
 
@@ -6176,7 +6418,12 @@ namespace build2
         {
           args.push_back ("-o");
           args.push_back (relo.string ().c_str ());
-          args.push_back ("-c");
+
+          // Compiling a header (-x c/c++-header) produces the precompiled
+          // header.
+          //
+          if (!md.pch)
+            args.push_back ("-c");
         }
 
         lang_n = append_lang_options (args, md);
@@ -6295,6 +6542,46 @@ namespace build2
       if (verb >= 3)
         print_process (args);
 
+      // Write the auxiliary precompiled header files: the MSVC stub source
+      // and the GCC header that is included by its users (see above).
+      //
+      if (md.pch && !ctx.dry_run)
+      {
+        path f;
+        string c;
+
+        switch (ctype)
+        {
+        case compiler_type::gcc:
+          {
+            f = tp.base ();
+            c = "#include \"" + s.path ().string () + '"';
+            break;
+          }
+        case compiler_type::msvc:
+          {
+            f = stub;
+            c = "/* Precompiled header stub. */";
+            break;
+          }
+        case compiler_type::clang:
+        case compiler_type::icc:
+          break;
+        }
+
+        if (!f.empty ())
+        try
+        {
+          ofdstream os (f);
+          os << c << endl;
+          os.close ();
+        }
+        catch (const io_error& e)
+        {
+          fail << "unable to write " << f << ": " << e;
+        }
+      }
+
       // @@ DRYRUN: Currently we discard the (partially) preprocessed file on
       // dry-run which is a waste. Even if we keep the file around (like we do
       // for the error case; see above), we currently have no support for
@@ -6319,11 +6606,11 @@ namespace build2
           //
           bool filter (ctype == compiler_type::msvc);
 
-          process pr (cpath,
-                      args.data (),
-                      0, (filter ? -1 : 2), 2,
-                      nullptr, // CWD
-                      env.empty () ? nullptr : env.data ());
+          process pr (process_spawn (cpath,
+                                     args.data (),
+                                     0, (filter ? -1 : 2), 2,
+                                     nullptr, // CWD
+                                     env.empty () ? nullptr : env.data ()));
 
           if (filter)
           {
@@ -6395,11 +6682,11 @@ namespace build2
 
           try
           {
-            process pr (cpath,
-                        args.data (),
-                        0, 2, 2,
-                        nullptr, // CWD
-                        env.empty () ? nullptr : env.data ());
+            process pr (process_spawn (cpath,
+                                       args.data (),
+                                       0, 2, 2,
+                                       nullptr, // CWD
+                                       env.empty () ? nullptr : env.data ()));
 
             run_finish (args, pr);
           }
@@ -6446,6 +6733,30 @@ namespace build2
       case compiler_type::icc:   extras = {".d"};                        break;
       }
 
+      // For a precompiled header also clean the auxiliary files (see
+      // perform_update() for details).
+      //
+      if (t.is_a<pchx> ())
+      {
+        switch (ctype)
+        {
+        case compiler_type::gcc:
+          {
+            extras.push_back ("-"); // Included header.
+            break;
+          }
+        case compiler_type::msvc:
+          {
+            extras.push_back (".obj");
+            extras.push_back (x_lang == lang::c ? ".c" : ".cpp"); // Stub.
+            break;
+          }
+        case compiler_type::clang:
+        case compiler_type::icc:
+          break;
+        }
+      }
+
       return perform_clean_extra (a, t, extras);
     }
   }
@@ -0,0 +1,406 @@
+// file      : libbuild2/cc/elf-interface.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <map>
+
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/cc/link-rule.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  namespace cc
+  {
+    // ELF constants that we need (see elf.h).
+    //
+    static const uint32_t sht_dynamic (6);
+    static const uint32_t sht_dynsym (11);
+    static const uint32_t sht_gnu_verdef (0x6ffffffd);
+    static const uint32_t sht_gnu_versym (0x6fffffff);
+
+    static const uint64_t dt_null (0);
+    static const uint64_t dt_needed (1);
+    static const uint64_t dt_soname (14);
+
+    static const unsigned char stt_object (1);
+    static const unsigned char stt_tls (6);
+
+    static const unsigned char stb_global (1);
+    static const unsigned char stb_weak (2);
+    static const unsigned char stb_gnu_unique (10);
+
+    static const unsigned char stv_default (0);
+    static const unsigned char stv_protected (3);
+
+    // Return the NULL-terminated string at the specified offset in the string
+    // table.
+    //
+    static string
+    strtab_string (const string& t, uint64_t o)
+    {
+      if (o >= t.size ())
+        throw invalid_argument ("invalid ELF string table offset");
+
+      return string (t.c_str () + o);
+    }
+
+    namespace
+    {
+      // A minimal ELF reader that only understands what we need to extract
+      // the dynamic symbol table and the dynamic section.
+      //
+      class elf_reader
+      {
+      public:
+        elf_reader (ifdstream& is): is_ (is) {}
+
+        // Read the identification and the file header returning false if
+        // this is not an ELF file.
+        //
+        bool
+        header ();
+
+        struct section
+        {
+          uint32_t type;
+          uint64_t offset;
+          uint64_t size;
+          uint32_t link;
+          uint64_t entsize;
+        };
+
+        vector<section> sections;
+
+        // Read the section contents.
+        //
+        string
+        read (const section&);
+
+        // Read an unsigned integer of the specified size (in bytes) from the
+        // buffer at the specified position.
+        //
+        uint64_t
+        get (const string& b, size_t p, size_t n) const;
+
+        bool b64 = false; // ELFCLASS64.
+
+      private:
+        ifdstream& is_;
+        bool le_ = true;  // ELFDATA2LSB.
+      };
+
+      bool elf_reader::
+      header ()
+      {
+        string h (64, '\0');
+        is_.read (&h[0], 16);
+
+        if (h[0] != '\x7f' || h[1] != 'E' || h[2] != 'L' || h[3] != 'F')
+          return false;
+
+        switch (h[4]) // EI_CLASS
+        {
+        case 1: b64 = false; break;
+        case 2: b64 = true;  break;
+        default: return false;
+        }
+
+        switch (h[5]) // EI_DATA
+        {
+        case 1: le_ = true;  break;
+        case 2: le_ = false; break;
+        default: return false;
+        }
+
+        is_.read (&h[16], b64 ? 64 - 16 : 52 - 16);
+
+        uint64_t shoff     (b64 ? get (h, 0x28, 8) : get (h, 0x20, 4));
+        size_t   shentsize (get (h, b64 ? 0x3a : 0x2e, 2));
+        size_t   shnum     (get (h, b64 ? 0x3c : 0x30, 2));
+
+        if (shoff == 0 || shentsize < (b64 ? 0x40 : 0x28))
+          return false;
+
+        string s (shentsize * shnum, '\0');
+        is_.seekg (static_cast<streamoff> (shoff));
+        is_.read (&s[0], static_cast<streamsize> (s.size ()));
+
+        sections.reserve (shnum);
+        for (size_t i (0); i != shnum; ++i)
+        {
+          size_t p (i * shentsize);
+
+          if (b64)
+            sections.push_back (
+              section {static_cast<uint32_t> (get (s, p + 0x04, 4)),
+                       get (s, p + 0x18, 8),
+                       get (s, p + 0x20, 8),
+                       static_cast<uint32_t> (get (s, p + 0x28, 4)),
+                       get (s, p + 0x38, 8)});
+          else
+            sections.push_back (
+              section {static_cast<uint32_t> (get (s, p + 0x04, 4)),
+                       get (s, p + 0x10, 4),
+                       get (s, p + 0x14, 4),
+                       static_cast<uint32_t> (get (s, p + 0x18, 4)),
+                       get (s, p + 0x24, 4)});
+        }
+
+        return true;
+      }
+
+      string elf_reader::
+      read (const section& s)
+      {
+        string r (static_cast<size_t> (s.size), '\0');
+
+        if (!r.empty ())
+        {
+          is_.seekg (static_cast<streamoff> (s.offset));
+          is_.read (&r[0], static_cast<streamsize> (r.size ()));
+        }
+
+        return r;
+      }
+
+      uint64_t elf_reader::
+      get (const string& b, size_t p, size_t n) const
+      {
+        if (p + n > b.size ())
+          throw invalid_argument ("truncated ELF data");
+
+        uint64_t r (0);
+        for (size_t i (0); i != n; ++i)
+        {
+          size_t j (le_ ? p + i : p + n - 1 - i);
+          r |= static_cast<uint64_t> (static_cast<unsigned char> (b[j])) <<
+            (i * 8);
+        }
+        return r;
+      }
+    }
+
+    optional<string> link_rule::
+    elf_interface_checksum (const path& f) const
+    {
+      tracer trace (x, "link_rule::elf_interface_checksum");
+
+      // What constitutes the interface of a shared library as far as the
+      // linking of its dependents is concerned: its SONAME and DT_NEEDED
+      // entries as well as the names, types, and bindings of the symbols it
+      // exports (defined symbols with global, weak, or unique binding and
+      // default or protected visibility). For data symbols we also include
+      // their sizes since they are baked into the dependents (think copy
+      // relocations).
+      //
+      // We also include the symbol versioning information, if any: the
+      // version definitions (names and their parents) as well as the version
+      // of each exported symbol. A dependent records the version of each
+      // symbol it is bound to and so moving a symbol to a different version
+      // requires relinking (otherwise it will fail to load).
+      //
+      // Note that the order of the entries is not significant so we sort
+      // them before hashing.
+      //
+      try
+      {
+        ifdstream is (f, fdopen_mode::binary);
+        elf_reader r (is);
+
+        if (!r.header ())
+        {
+          l4 ([&]{trace << f << " is not an ELF file";});
+          return nullopt;
+        }
+
+        strings es;
+
+        // Symbol versions (.gnu.version) with one entry per dynamic symbol
+        // and the version definition names (.gnu.version_d) by index.
+        //
+        string versym;
+        std::map<uint64_t, string> verdef;
+
+        for (const elf_reader::section& s: r.sections)
+        {
+          if (s.type == sht_gnu_versym)
+            versym = r.read (s);
+          else if (s.type == sht_gnu_verdef)
+          {
+            if (s.link >= r.sections.size ())
+              return nullopt;
+
+            string d (r.read (s));
+            string t (r.read (r.sections[s.link]));
+
+            // Elf_Verdef (20 bytes) followed by its Elf_Verdaux entries (8
+            // bytes each), the first of which is the version name and the
+            // rest -- the parents. The layout is the same for both classes.
+            //
+            for (size_t p (0); p + 20 <= d.size (); )
+            {
+              uint64_t ndx  (r.get (d, p + 0x04, 2));
+              uint64_t cnt  (r.get (d, p + 0x06, 2));
+              uint64_t aux  (r.get (d, p + 0x0c, 4));
+              uint64_t next (r.get (d, p + 0x10, 4));
+
+              string e ("verdef");
+              string v;
+
+              for (size_t a (p + aux), i (0); i != cnt; ++i)
+              {
+                string vn (strtab_string (t, r.get (d, a, 4)));
+
+                e += ' ';
+                e += vn;
+
+                if (i == 0)
+                  v = move (vn);
+
+                uint64_t an (r.get (d, a + 0x04, 4));
+                if (an == 0)
+                  break;
+
+                a += an;
+              }
+
+              es.push_back (move (e));
+              verdef[ndx] = move (v);
+
+              if (next == 0)
+                break;
+
+              p += next;
+            }
+          }
+        }
+
+        for (const elf_reader::section& s: r.sections)
+        {
+          if (s.type != sht_dynsym && s.type != sht_dynamic)
+            continue;
+
+          if (s.link >= r.sections.size ())
+            return nullopt;
+
+          string d (r.read (s));
+          string t (r.read (r.sections[s.link]));
+
+          if (s.type == sht_dynamic)
+          {
+            size_t n (r.b64 ? 16 : 8);
+
+            for (size_t p (0); p + n <= d.size (); p += n)
+            {
+              uint64_t tag (r.get (d, p, n / 2));
+
+              if (tag == dt_null)
+                break;
+
+              if (tag == dt_needed || tag == dt_soname)
+              {
+                uint64_t v (r.get (d, p + n / 2, n / 2));
+
+                es.push_back ((tag == dt_soname ? "soname " : "needed ") +
+                              strtab_string (t, v));
+              }
+            }
+          }
+          else
+          {
+            size_t n (s.entsize != 0 ? static_cast<size_t> (s.entsize)
+                      : r.b64 ? 24 : 16);
+
+            for (size_t p (0), i (0); p + n <= d.size (); p += n, ++i)
+            {
+              uint64_t name, size;
+              unsigned char info, other;
+              uint64_t shndx;
+
+              if (r.b64)
+              {
+                name  = r.get (d, p,        4);
+                info  = static_cast<unsigned char> (r.get (d, p + 0x04, 1));
+                other = static_cast<unsigned char> (r.get (d, p + 0x05, 1));
+                shndx = r.get (d, p + 0x06, 2);
+                size  = r.get (d, p + 0x10, 8);
+              }
+              else
+              {
+                name  = r.get (d, p,        4);
+                size  = r.get (d, p + 0x08, 4);
+                info  = static_cast<unsigned char> (r.get (d, p + 0x0c, 1));
+                other = static_cast<unsigned char> (r.get (d, p + 0x0d, 1));
+                shndx = r.get (d, p + 0x0e, 2);
+              }
+
+              unsigned char bind (info >> 4), type (info & 0x0f);
+              unsigned char vis (other & 0x03);
+
+              if (shndx == 0 /* SHN_UNDEF */                                 ||
+                  (bind != stb_global && bind != stb_weak &&
+                   bind != stb_gnu_unique)                                   ||
+                  (vis != stv_default && vis != stv_protected))
+                continue;
+
+              string e ("symbol ");
+              e += strtab_string (t, name);
+              e += ' ';
+              e += to_string (static_cast<unsigned int> (type));
+              e += ' ';
+              e += to_string (static_cast<unsigned int> (bind));
+
+              if (type == stt_object || type == stt_tls)
+              {
+                e += ' ';
+                e += to_string (size);
+              }
+
+              // Add the version, if any, in the name@VERSION form for
+              // hidden (non-default) versions and name@@VERSION otherwise.
+              // Note that indexes 0 and 1 are local and global (that is,
+              // unversioned).
+              //
+              if (!versym.empty ())
+              {
+                uint64_t v (r.get (versym, i * 2, 2));
+                uint64_t x (v & 0x7fff);
+
+                if (x > 1)
+                {
+                  auto j (verdef.find (x));
+
+                  e += (v & 0x8000) != 0 ? " @" : " @@";
+                  e += j != verdef.end () ? j->second : to_string (x);
+                }
+              }
+
+              es.push_back (move (e));
+            }
+          }
+        }
+
+        sort (es.begin (), es.end ());
+
+        sha256 cs;
+        for (const string& e: es)
+          cs.append (e);
+
+        return cs.string ();
+      }
+      catch (const invalid_argument& e)
+      {
+        l4 ([&]{trace << "unable to parse " << f << ": " << e;});
+      }
+      catch (const io_error& e)
+      {
+        l4 ([&]{trace << "unable to read " << f << ": " << e;});
+      }
+
+      return nullopt;
+    }
+  }
+}
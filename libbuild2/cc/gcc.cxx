@@ -122,13 +122,13 @@ namespace build2
 
         // Open pipe to stderr, redirect stdin and stdout to /dev/null.
         //
-        process pr (xc,
-                    args.data (),
-                    -2,     /* stdin */
-                    -2,     /* stdout */
-                    -1,     /* stderr */
-                    nullptr /* cwd */,
-                    env.vars);
+        process pr (process_spawn (xc,
+                                   args.data (),
+                                   -2,     /* stdin */
+                                   -2,     /* stdout */
+                                   -1,     /* stderr */
+                                   nullptr /* cwd */,
+                                   env.vars));
 
         try
         {
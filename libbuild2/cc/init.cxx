@@ -20,7 +20,8 @@ namespace build2
 {
   namespace cc
   {
-    // Scope operation callback that cleans up module sidebuilds.
+    // Scope operation callback that cleans up module sidebuilds and the LTO
+    // cache.
     //
     static target_state
     clean_module_sidebuilds (action, const scope& rs, const dir&)
@@ -29,42 +30,47 @@ namespace build2
 
       const dir_path& out_root (rs.out_path ());
 
+      target_state r (target_state::unchanged);
+
       dir_path d (out_root /
                   rs.root_extra->build_dir /
                   module_build_modules_dir);
 
-      if (exists (d))
+      if (exists (d) && rmdir_r (ctx, d))
+      {
+        // Clean up cc/build/ if it became empty.
+        //
+        d = out_root / rs.root_extra->build_dir / module_build_dir;
+        if (empty (d))
+          rmdir (ctx, d, 2);
+
+        r = target_state::changed;
+      }
+
+      d = out_root / rs.root_extra->build_dir / module_lto_cache_dir;
+
+      if (exists (d) && rmdir_r (ctx, d))
+        r = target_state::changed;
+
+      if (r == target_state::changed)
       {
-        if (rmdir_r (ctx, d))
+        // Clean up cc/ if it became empty.
+        //
+        d = out_root / rs.root_extra->build_dir / module_dir;
+        if (empty (d))
         {
-          // Clean up cc/build/ if it became empty.
+          rmdir (ctx, d, 2);
+
+          // And build/ if it also became empty (e.g., in case of a build
+          // with a transient configuration).
           //
-          d = out_root / rs.root_extra->build_dir / module_build_dir;
+          d = out_root / rs.root_extra->build_dir;
           if (empty (d))
-          {
             rmdir (ctx, d, 2);
-
-            // Clean up cc/ if it became empty.
-            //
-            d = out_root / rs.root_extra->build_dir / module_dir;
-            if (empty (d))
-            {
-              rmdir (ctx, d, 2);
-
-              // And build/ if it also became empty (e.g., in case of a build
-              // with a transient configuration).
-              //
-              d = out_root / rs.root_extra->build_dir;
-              if (empty (d))
-                rmdir (ctx, d, 2);
-            }
-          }
-
-          return target_state::changed;
         }
       }
 
-      return target_state::unchanged;
+      return r;
     }
 
     bool
@@ -151,6 +157,12 @@ namespace build2
       vp.insert<bool> ("config.cc.reprocess");
       vp.insert<bool> ("cc.reprocess");
 
+      // Link-time optimization mode: none, full, or thin (ThinLTO where
+      // supported). Can also be set on the target.
+      //
+      vp.insert<string> ("config.cc.lto");
+      vp.insert<string> ("cc.lto");
+
       // Register scope operation callback.
       //
       // It feels natural to clean up sidebuilds as a post operation but that
@@ -290,6 +302,19 @@ namespace build2
       if (lookup l = lookup_config (rs, "config.cc.reprocess"))
         rs.assign ("cc.reprocess") = *l;
 
+      // config.cc.lto
+      //
+      if (lookup l = lookup_config (rs, "config.cc.lto"))
+      {
+        const string& v (cast<string> (l));
+
+        if (v != "none" && v != "full" && v != "thin")
+          fail (loc) << "invalid config.cc.lto value '" << v << "'" <<
+            info << "expected none, full, or thin";
+
+        rs.assign ("cc.lto") = *l;
+      }
+
       // Load the bin.config module.
       //
       if (!cast_false<bool> (rs["bin.config.loaded"]))
@@ -339,7 +364,10 @@ namespace build2
 
       load_module (rs, rs, "bin.ar.config", loc);
 
-      if (tsys == "win32-msvc")
+      // Note that we also need bin.ld.config if the linker kind is specified
+      // (see config.bin.ld.kind for details).
+      //
+      if (tsys == "win32-msvc" || rs["config.bin.ld.kind"])
         load_module (rs, rs, "bin.ld.config", loc);
 
       if (tsys == "mingw32")
@@ -376,9 +404,10 @@ namespace build2
       load_module (rs, rs, "bin.ar", loc);
 
       // For this target we link things directly with link.exe so load the
-      // bin.ld module.
+      // bin.ld module. We also load it if the linker kind is specified (in
+      // which case we still link via the compiler driver).
       //
-      if (tsys == "win32-msvc")
+      if (tsys == "win32-msvc" || rs["bin.ld.kind"])
         load_module (rs, rs, "bin.ld", loc);
 
       // If our target is MinGW, then we will need the resource compiler
@@ -70,6 +70,11 @@ namespace build2
           return pt;
       }
 
+      // Precompiled headers are only useful for building.
+      //
+      if (p.is_a<pch> () || p.is_a<pchx> ())
+        return nullptr;
+
       // The rest of the tests only succeed if the base filter() succeeds.
       //
       const target* pt (file_rule::filter (a, t, p));
@@ -307,6 +312,9 @@ namespace build2
           return pt;
       }
 
+      if (p.is_a<pch> () || p.is_a<pchx> ())
+        return nullptr;
+
       const target* pt (install::file_rule::instance.filter (a, t, p));
       if (pt == nullptr)
         return pt;
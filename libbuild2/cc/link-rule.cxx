@@ -4,8 +4,13 @@
 #include <libbuild2/cc/link-rule.hxx>
 
 #include <map>
+#include <set>
 #include <cstdlib>  // exit()
-#include <cstring>  // strlen()
+#include <cstring>  // strlen(), strpbrk()
+
+#ifndef _WIN32
+#  include <unistd.h> // sysconf()
+#endif
 
 #include <libbutl/filesystem.mxx> // file_exists(), path_search()
 
@@ -38,7 +43,7 @@ namespace build2
     link_rule::
     link_rule (data&& d)
         : common (move (d)),
-          rule_id (string (x) += ".link 2")
+          rule_id (string (x) += ".link 5")
     {
       static_assert (sizeof (match_data) <= target::data_size,
                      "insufficient space");
@@ -807,11 +812,12 @@ namespace build2
         }
         else
         {
-          // If this is the obj{} or bmi{} target group, then pick the
-          // appropriate member.
+          // If this is the obj{}, bmi{}, or pch{} target group, then pick
+          // the appropriate member.
           //
           if      (p.is_a<obj> ()) pt = &search (t, tts.obj, p.key ());
           else if (p.is_a<bmi> ()) pt = &search (t, tts.bmi, p.key ());
+          else if (p.is_a<pch> ()) pt = &search (t, tts.pch, p.key ());
           //
           // Windows module definition (.def). For other platforms (and for
           // static libraries) treat it as an ordinary prerequisite.
@@ -827,7 +833,7 @@ namespace build2
           //
           else
           {
-            if (!p.is_a<objx> () && !p.is_a<bmix> ())
+            if (!p.is_a<objx> () && !p.is_a<bmix> () && !p.is_a<pchx> ())
             {
               // @@ Temporary hack until we get the default outer operation
               // for update. This allows operations like test and install to
@@ -1021,6 +1027,38 @@ namespace build2
             }
           }
 
+          // Add the separate debug information files if the corresponding
+          // programs are configured (see perform_update() for details).
+          //
+          // The DWARF package (.dwp) only makes sense if we are compiling
+          // with split DWARF. Note that the coptions are passed to the linker
+          // driver so that's where we look for -gsplit-dwarf.
+          //
+          if (!binless && !lt.utility && ot != otype::a &&
+              tclass != "windows" && tclass != "macos")
+          {
+            if (rs["bin.dwp.path"] &&
+                (find_option ("-gsplit-dwarf", cmode)         ||
+                 find_option ("-gsplit-dwarf", t, c_coptions) ||
+                 find_option ("-gsplit-dwarf", t, x_coptions)))
+            {
+              file& dwp (
+                add_adhoc_member<file> (t, *bs.find_target_type ("dwp"), e));
+
+              if (dwp.path ().empty ())
+                dwp.derive_path (t.path (), "dwp");
+            }
+
+            if (rs["bin.objcopy.path"])
+            {
+              file& dbg (
+                add_adhoc_member<file> (t, *bs.find_target_type ("debug"), e));
+
+              if (dbg.path ().empty ())
+                dbg.derive_path (t.path (), "debug");
+            }
+          }
+
           // Add pkg-config's .pc file.
           //
           // Note that we do it regardless of whether we are installing or not
@@ -1139,6 +1177,35 @@ namespace build2
 
           // Note that if this is a library not to be cleaned, we keep it
           // marked for completion (see the next phase).
+
+          // A precompiled header must be compiled with the same library
+          // *.export.poptions as the translation units that use it. So,
+          // similar to the synthesized obj*{} dependency below, add our
+          // lib*{} prerequisites to the pch*{} member (its header is the
+          // group's prerequisite). If someone beat us to it, then we assume
+          // the libraries are the same (use separate pch{} targets
+          // otherwise). See also lookup_poptions() in the compile rule.
+          //
+          if (pt->is_a<pchx> ())
+          {
+            prerequisites ps;
+
+            size_t j (start);
+            for (prerequisite_member p: group_prerequisite_members (a, t))
+            {
+              const target* pt (pts[j++]);
+
+              if (pt == nullptr)
+                continue;
+
+              if (p.is_a<libx> () ||
+                  p.is_a<liba> () || p.is_a<libs> () || p.is_a<libux> ())
+                ps.push_back (p.as_prerequisite ());
+            }
+
+            if (!ps.empty ())
+              pt->prerequisites (move (ps));
+          }
         }
         else if (m == 1 || m == 2) // Source/module chain.
         {
@@ -1177,9 +1244,9 @@ namespace build2
           {
             prerequisites ps {p.as_prerequisite ()}; // Source.
 
-            // Add our lib*{} (see the export.* machinery for details) and
-            // bmi*{} (both original and chained; see module search logic)
-            // prerequisites.
+            // Add our lib*{} (see the export.* machinery for details),
+            // bmi*{} (both original and chained; see module search logic),
+            // and pch*{} (precompiled header) prerequisites.
             //
             // Note that we don't resolve lib{} to liba{}/libs{} here
             // instead leaving it to whomever (e.g., the compile rule) will
@@ -1209,7 +1276,8 @@ namespace build2
               //
               if (p.is_a<libx> () ||
                   p.is_a<liba> () || p.is_a<libs> () || p.is_a<libux> () ||
-                  p.is_a<bmi> ()  || p.is_a (tts.bmi))
+                  p.is_a<bmi> ()  || p.is_a (tts.bmi) ||
+                  p.is_a<pch> ()  || p.is_a (tts.pch))
               {
                 ps.push_back (p.as_prerequisite ());
               }
@@ -1287,12 +1355,13 @@ namespace build2
               }
 
               // Ignore some known target types (fsdir, headers, libraries,
-              // modules).
+              // modules, precompiled headers).
               //
               if (p1.is_a<fsdir> ()                                         ||
                   p1.is_a<libx>  ()                                         ||
                   p1.is_a<liba> () || p1.is_a<libs> () || p1.is_a<libux> () ||
                   p1.is_a<bmi>  () || p1.is_a<bmix> ()                      ||
+                  p1.is_a<pch>  () || p1.is_a<pchx> ()                      ||
                   (p.is_a (mod ? *x_mod : x_src) && x_header (p1))          ||
                   (p.is_a<c> () && p1.is_a<h> ()))
                 continue;
@@ -1656,7 +1725,8 @@ namespace build2
     append_libraries (sha256& cs,
                       bool& update, timestamp mt,
                       const file& l, bool la, lflags lf,
-                      const scope& bs, action a, linfo li) const
+                      const scope& bs, action a, linfo li,
+                      interface_libs* il) const
     {
       struct data
       {
@@ -1665,7 +1735,8 @@ namespace build2
         bool&           update;
         timestamp       mt;
         linfo           li;
-      } d {cs, bs.root_scope ()->out_path (), update, mt, li};
+        interface_libs* il;
+      } d {cs, bs.root_scope ()->out_path (), update, mt, li, il};
 
       auto imp = [] (const file&, bool la)
       {
@@ -1710,9 +1781,17 @@ namespace build2
           if (l->mtime () == timestamp_unreal) // Binless.
             return;
 
-          // Check if this library renders us out of date.
+          // Check if this library renders us out of date. For a shared
+          // library, if requested, defer this decision to the interface
+          // check.
           //
-          d.update = d.update || l->newer (d.mt);
+          if (d.il != nullptr && !lu && l->is_a<libs> ())
+          {
+            d.il->libs.push_back (l);
+            d.il->newer = d.il->newer || l->newer (d.mt);
+          }
+          else
+            d.update = d.update || l->newer (d.mt);
 
           // On Windows a shared library is a DLL with the import library as
           // an ad hoc group member. MinGW though can link directly to DLLs
@@ -1903,6 +1982,20 @@ namespace build2
     void
     msvc_filter_link (ifdstream&, const file&, otype);
 
+    // Return the command line length limit of the host platform. On POSIX
+    // the limit also includes the environment so we only use half of it.
+    //
+    static size_t
+    command_line_limit ()
+    {
+#ifdef _WIN32
+      return 32766; // 32768 - "Unicode terminating null character".
+#else
+      long n (sysconf (_SC_ARG_MAX));
+      return n > 0 ? static_cast<size_t> (n) / 2 : 65536;
+#endif
+    }
+
     // Translate target CPU to the link.exe/lib.exe /MACHINE option.
     //
     const char*
@@ -2130,13 +2223,15 @@ namespace build2
 
               try
               {
-                process pr (rc,
-                            args,
-                            -1      /* stdin  */,
-                            1       /* stdout */,
-                            2       /* stderr */,
-                            nullptr /* cwd    */,
-                            env_ptrs.empty () ? nullptr : env_ptrs.data ());
+                process pr (
+                  process_spawn (
+                    rc,
+                    args,
+                    -1      /* stdin  */,
+                    1       /* stdout */,
+                    2       /* stderr */,
+                    nullptr /* cwd    */,
+                    env_ptrs.empty () ? nullptr : env_ptrs.data ()));
 
                 try
                 {
@@ -2224,6 +2319,54 @@ namespace build2
 
         if (dd.expect (cs) != nullptr)
           l4 ([&]{trace << "linker mismatch forcing update of " << t;});
+
+        // If the linker kind is specified, then we also track the linker
+        // itself. Note that this keeps it out of the compiler checksum so
+        // switching linkers only causes relinking.
+        //
+        if (tsys != "win32-msvc")
+        {
+          string lk;
+          if (const string* k = cast_null<string> (rs["bin.ld.kind"]))
+          {
+            lk = *k;
+            lk += ' ';
+            lk += cast<string> (rs["bin.ld.checksum"]);
+          }
+
+          if (dd.expect (lk) != nullptr)
+            l4 ([&]{trace << "linker kind mismatch forcing update of " << t;});
+        }
+      }
+
+      // Then the separate debug information programs, if any (see apply()).
+      // Note that the steps are only performed as part of linking so this
+      // is what makes sure they are re-done if the programs change.
+      //
+      const file* dwp (nullptr);
+      const file* dbg (nullptr);
+
+      if (!lt.static_library ())
+      {
+        sha256 cs;
+
+        if (const target_type* tt = bs.find_target_type ("dwp"))
+        {
+          if ((dwp = find_adhoc_member<file> (t, *tt)) != nullptr)
+            cs.append (
+              cast<process_path> (rs["bin.dwp.path"]).effect_string ());
+        }
+
+        if (const target_type* tt = bs.find_target_type ("debug"))
+        {
+          if ((dbg = find_adhoc_member<file> (t, *tt)) != nullptr)
+            cs.append (
+              cast<process_path> (rs["bin.objcopy.path"]).effect_string ());
+        }
+
+        if (dd.expect (cs.string ()) != nullptr)
+          l4 ([&]{trace << "debug information mismatch forcing update of "
+                        << t;});
       }
 
       // Hash and compare any changes to the environment.
@@ -2250,9 +2393,45 @@ namespace build2
 
       // Stored args.
       //
-      string arg1, arg2;
+      string arg1, arg2, fuse_ld, fuse_ld_dir;
       strings sargs1;
 
+      // Link-time optimization (see also the compile rule).
+      //
+      // For ThinLTO (and GCC's incremental LTO) we also point the linker to
+      // the per-configuration cache directory so that the unchanged modules
+      // are not re-optimized on relink. LLVM prunes the cache according to
+      // the policy which we limit to a gigabyte of entries that were used
+      // within the last week.
+      //
+      // The linker kind, if specified (see config.bin.ld.kind).
+      //
+      const string* ld_kind (lt.static_library ()
+                             ? nullptr
+                             : cast_null<string> (rs["bin.ld.kind"]));
+
+      lto_mode lto (lto_type (t));
+      bool lld (false);      // Linking with lld (ELF).
+      dir_path lto_cache;    // Empty if not used.
+      strings lto_args;
+
+      const char* lto_policy ("cache_size_bytes=1g:prune_after=168h");
+
+      if (lto != lto_mode::none && !lt.static_library ())
+      {
+        lld = ((ld_kind != nullptr && *ld_kind == "lld") ||
+               find_option ("-fuse-ld=lld", cmode)         ||
+               find_option ("-fuse-ld=lld", t, c_coptions) ||
+               find_option ("-fuse-ld=lld", t, x_coptions) ||
+               find_option ("-fuse-ld=lld", t, c_loptions) ||
+               find_option ("-fuse-ld=lld", t, x_loptions));
+
+        if (lto == lto_mode::thin)
+          lto_cache = (outer_root (rs).out_path () /
+                       rs.root_extra->build_dir /
+                       module_lto_cache_dir);
+      }
+
       // Shallow-copy over stored args to args. Note that this must only be
       // done once we are finished appending to stored args because of
       // potential reallocations.
@@ -2277,6 +2456,11 @@ namespace build2
           //
           args.push_back (msvc_machine (cast<string> (rs[x_target_cpu])));
 
+          // Objects compiled with /GL should be archived with /LTCG.
+          //
+          if (lto != lto_mode::none && ctype == compiler_type::msvc)
+            args.push_back ("/LTCG");
+
           // For utility libraries use thin archives if possible.
           //
           // LLVM's lib replacement had the /LLVMLIBTHIN option at least from
@@ -2330,6 +2514,29 @@ namespace build2
             }
           }
 
+          // Create the archive in the deterministic mode (zero timestamps,
+          // uids, etc) if possible. Besides making the result reproducible,
+          // this is what allows us to update the archive incrementally (see
+          // perform_update() for details).
+          //
+          // The D modifier is supported by GNU ar since binutils 2.20 and by
+          // LLVM ar (where it is also the default).
+          //
+          {
+            const string& id (cast<string> (rs["bin.ar.id"]));
+
+            if (id == "gnu")
+            {
+              auto mj (cast<uint64_t> (rs["bin.ar.version.major"]));
+              auto mi (cast<uint64_t> (rs["bin.ar.version.minor"]));
+
+              if (mj > 2 || (mj == 2 && mi >= 20))
+                arg1 += 'D';
+            }
+            else if (id == "llvm")
+              arg1 += 'D';
+          }
+
           args.push_back (arg1.c_str ());
         }
 
@@ -2342,6 +2549,121 @@ namespace build2
         //
         bool ldc (tsys != "win32-msvc");
 
+        // Ask the compiler driver to use the linker of the specified kind.
+        // Note: before coptions/loptions so that it can be overridden.
+        //
+        // Passing just -fuse-ld=<kind> would make the driver search for the
+        // linker itself and it could end up with a different binary than the
+        // one we have probed (and checksum). So for Clang we pass the linker
+        // path directly (--ld-path is only recognized since Clang 12 but
+        // earlier versions accept a path in -fuse-ld). For GCC we prefix the
+        // program search path with the linker's directory so that ld.<kind>
+        // is found there first (verified during module init).
+        //
+        if (ldc && ld_kind != nullptr)
+        {
+          const process_path& ld (cast<process_path> (rs["bin.ld.path"]));
+
+          if (ctype == compiler_type::clang)
+          {
+            fuse_ld = (cmaj >= 12 ? "--ld-path=" : "-fuse-ld=");
+            fuse_ld += ld.effect_string ();
+          }
+          else
+          {
+            fuse_ld_dir = "-B" + ld.effect.directory ().representation ();
+            args.push_back (fuse_ld_dir.c_str ());
+
+            fuse_ld = "-fuse-ld=" + *ld_kind;
+          }
+
+          args.push_back (fuse_ld.c_str ());
+        }
+
+        // Note: before coptions/loptions so that it can be overridden.
+        //
+        if (lto != lto_mode::none)
+        {
+          const string& d (lto_cache.string ());
+
+          if (!ldc)
+          {
+            // link.exe or lld-link.
+            //
+            const string& lid (cast<string> (rs["bin.ld.id"]));
+
+            lto_args.push_back (lto == lto_mode::thin && lid == "msvc"
+                                ? "/LTCG:INCREMENTAL"
+                                : "/LTCG");
+
+            if (lto == lto_mode::thin && lid == "msvc-lld")
+            {
+              lto_args.push_back ("/lldltocache:" + d);
+              lto_args.push_back (string ("/lldltocachepolicy:") + lto_policy);
+            }
+            else
+              lto_cache.clear ();
+          }
+          else
+          {
+            switch (ctype)
+            {
+            case compiler_type::gcc:
+              {
+                lto_args.push_back ("-flto");
+
+                // Incremental LTO is only supported since GCC 15 (without
+                // pruning).
+                //
+                if (lto == lto_mode::thin && cmaj >= 15)
+                  lto_args.push_back ("-flto-incremental=" + d);
+                else
+                  lto_cache.clear ();
+
+                break;
+              }
+            case compiler_type::clang:
+              {
+                if (lto == lto_mode::thin)
+                {
+                  lto_args.push_back ("-flto=thin");
+
+                  if (tclass == "macos")
+                  {
+                    lto_args.push_back ("-Wl,-cache_path_lto," + d);
+                    lto_args.push_back ("-Wl,-prune_after_lto,604800");
+                  }
+                  else if (lld)
+                  {
+                    lto_args.push_back ("-Wl,--thinlto-cache-dir=" + d);
+                    lto_args.push_back (
+                      string ("-Wl,--thinlto-cache-policy=") + lto_policy);
+                  }
+                  else // LLVMgold plugin (ld.bfd, ld.gold).
+                  {
+                    lto_args.push_back ("-Wl,-plugin-opt,cache-dir=" + d);
+                    lto_args.push_back (
+                      string ("-Wl,-plugin-opt,cache-policy=") + lto_policy);
+                  }
+                }
+                else
+                  lto_args.push_back ("-flto");
+
+                break;
+              }
+            case compiler_type::msvc: assert (false); break;
+            case compiler_type::icc:
+              {
+                lto_args.push_back ("-ipo");
+                lto_cache.clear ();
+                break;
+              }
+            }
+          }
+
+          append_args (lto_args);
+        }
+
         if (ldc)
         {
           append_options (args, t, c_coptions);
@@ -2500,6 +2822,14 @@ namespace build2
       // pinpoint exactly what is causing the update. On the other hand, the
       // checksum is faster and simpler. And we like simple.
       //
+      // On ELF targets we avoid relinking if only the implementation of the
+      // shared libraries that we link has changed (see below for details).
+      //
+      interface_libs il;
+      bool elf (!lt.static_library () &&
+                tclass != "windows"   &&
+                tclass != "macos");
+
       const file* def (nullptr); // Cached if present.
       {
         sha256 cs;
@@ -2545,7 +2875,10 @@ namespace build2
             //
             if (la || ls)
             {
-              append_libraries (cs, update, mt, *f, la, p.data, bs, a, li);
+              append_libraries (cs, update, mt,
+                                *f, la, p.data,
+                                bs, a, li,
+                                elf ? &il : nullptr);
               f = nullptr; // Timestamp checked by hash_libraries().
             }
             else
@@ -2600,8 +2933,86 @@ namespace build2
       if (dd.writing () || dd.mtime > mt)
         scratch = update = true;
 
+      // For static libraries (other than lib.exe) keep track of the
+      // directory from which the archiver was last invoked. We pass the
+      // members relative to it and some implementations treat the same
+      // member specified with different paths as different members. So we
+      // only update the archive incrementally if this directory is the same
+      // (see below).
+      //
+      // Note that we only compare (and overwrite) it if we are updating since
+      // the change of this directory alone is not a reason to re-create the
+      // archive.
+      //
+      bool same_wd (false);
+      if (lt.static_library () && tsys != "win32-msvc")
+      {
+        if (update)
+          same_wd = (dd.expect (relative_base->string ()) == nullptr);
+        else
+          dd.read (); // Keep the line.
+      }
+
+      // Next is the checksum of the interfaces of the shared libraries that
+      // we link. If some of them are newer than us but their interfaces
+      // haven't changed (think a change to a function body), then there is
+      // no need to relink and we can just touch the target. This is similar
+      // to how the compile rule ignores changes that don't affect the
+      // translation unit.
+      //
+      // Note that we only calculate this checksum if we need it but we must
+      // store it whenever we relink. We also don't do this in the dry run
+      // mode since the libraries are not actually updated.
+      //
+      bool touch_only (false);
+      if (elf && (update || il.newer || dd.read () == nullptr))
+      {
+        string ics;
+        if (!ctx.dry_run)
+        {
+          sha256 cs;
+          bool ok (true);
+
+          for (const file* l: il.libs)
+          {
+            optional<string> c (elf_interface_checksum (l->path ()));
+
+            if (!(ok = c.has_value ()))
+              break; // Not ELF, force update.
+
+            hash_path (cs, l->path (), rs.out_path ());
+            cs.append (*c);
+          }
+
+          if (ok)
+            ics = cs.string ();
+        }
+
+        if (dd.expect (ics) != nullptr || ics.empty ())
+        {
+          if (il.newer && !update)
+            l4 ([&]{trace << "library interface change forcing update of "
+                          << t;});
+
+          update = true;
+        }
+        else if (!update)
+          touch_only = true;
+      }
+
       dd.close ();
 
+      if (touch_only)
+      {
+        l5 ([&]{trace << "only library implementation changed, touching "
+                      << t;});
+
+        touch (ctx, tp, false /* create */, verb_never);
+        t.mtime (system_clock::now ());
+        ctx.skip_count.fetch_add (1, memory_order_relaxed);
+        return target_state::changed;
+      }
+
       // If nothing changed, then we are done.
       //
       if (!update)
@@ -2610,6 +3021,15 @@ namespace build2
       // Ok, so we are updating. Finish building the command line.
       //
       string in, out, out1, out2, out3; // Storage.
+      string lto_jobs;
+
+      // Active thread slots allocated for the LTO jobs (see below).
+      //
+      size_t lto_slots (0);
+      auto lto_dealloc (make_guard ([&ctx, &lto_slots] ()
+                                    {
+                                      ctx.sched.deallocate (lto_slots);
+                                    }));
 
       // Translate paths to relative (to working directory) ones. This results
       // in easier to read diagnostics.
@@ -2818,15 +3238,65 @@ namespace build2
           case compiler_class::msvc: assert (false);
           }
         }
+
+        // Limit the number of parallel LTO jobs (partitions, ThinLTO
+        // backends) to our job budget rather than letting the linker use all
+        // the hardware threads. Note that this is done after hashing the
+        // options since it should not cause relinking.
+        //
+        // If there is a jobserver (ours or the one we are a client of), then
+        // let GCC's partitions share its tokens. Otherwise, give this link
+        // its share of the budget: its own slot plus the active thread slots
+        // that are currently free (all of them if this is the only thing
+        // left to do, as is often the case for the final link), which we
+        // hold for the duration of the link. This way concurrent links don't
+        // each start max_active() jobs.
+        //
+        if (lto != lto_mode::none)
+        {
+          const char* o (nullptr);
+
+          if (tsys == "win32-msvc")
+          {
+            if (lto == lto_mode::thin &&
+                cast<string> (rs["bin.ld.id"]) == "msvc-lld")
+              o = "/opt:lldltojobs=";
+          }
+          else if (ctype == compiler_type::gcc)
+          {
+            if (ctx.sched.jobserver_active ())
+              lto_jobs = "-flto=jobserver";
+            else
+              o = "-flto=";
+          }
+          else if (ctype == compiler_type::clang &&
+                   lto == lto_mode::thin    &&
+                   tclass != "macos")
+            o = lld ? "-Wl,--thinlto-jobs=" : "-Wl,-plugin-opt,jobs=";
+
+          if (o != nullptr)
+          {
+            if (!ctx.dry_run)
+              lto_slots = ctx.sched.try_allocate (ctx.sched.max_active () - 1);
+
+            lto_jobs = o + to_string (lto_slots + 1);
+          }
+
+          if (!lto_jobs.empty ())
+            args.push_back (lto_jobs.c_str ());
+        }
+
+        // Create the LTO cache directory if necessary.
+        //
+        if (!lto_cache.empty () && !ctx.dry_run && !exists (lto_cache))
+          mkdir_p (lto_cache, 3);
       }
 
       args[0] = ld->recall_string ();
 
       // Append input files noticing the position of the first.
       //
-#ifdef _WIN32
       size_t args_input (args.size ());
-#endif
 
       // The same logic as during hashing above. See also a similar loop
       // inside append_libraries().
@@ -2908,6 +3378,70 @@ namespace build2
 
       args.push_back (nullptr);
 
+      // Update the archive incrementally if only some of its members have
+      // changed.
+      //
+      // If the options and the input file set (including the order) are
+      // unchanged (see the depdb checks above) and the archive exists, then
+      // all we need to do is replace the changed members in place, which for
+      // large archives is a lot cheaper than re-creating them from scratch.
+      // Since the members are replaced at their original positions, the
+      // result in the deterministic mode (D) is byte-identical to the one
+      // created from scratch and so we only do this if the archiver supports
+      // this mode (see above).
+      //
+      // Note that ar identifies the members by their file names (without the
+      // directory) so we can only do this if they are unique. Thin archives,
+      // on the other hand, identify their members by paths and since they
+      // don't copy the members anyway, there is little to gain by updating
+      // them incrementally. Note also that lib.exe has no notion of replacing
+      // members in place.
+      //
+      // Finally, we only do this if the archiver is invoked from the same
+      // directory as the last time (see above) since otherwise the relative
+      // member paths can differ.
+      //
+      // Note also that a member that was updated within the same timestamp
+      // tick as the archive is considered changed since we cannot tell
+      // whether it was updated before or after the archive was written.
+      //
+      bool incr (false);
+      if (lt.static_library ()            &&
+          tsys != "win32-msvc"            &&
+          arg1.find ('D') != string::npos &&
+          arg1.find ('T') == string::npos &&
+          same_wd                         &&
+          !scratch                        &&
+          mt != timestamp_nonexistent)
+      {
+        cstrings cargs; // Changed members.
+        std::set<string> names;
+
+        size_t i (args_input), n (args.size () - 1);
+        for (; i != n; ++i)
+        {
+          path m (args[i]);
+
+          if (!names.insert (m.leaf ().string ()).second)
+            break;
+
+          if (mtime (m) >= mt)
+            cargs.push_back (args[i]);
+        }
+
+        if (i == n && !cargs.empty ())
+        {
+          l5 ([&]{trace << "updating " << cargs.size () << " out of "
+                        << n - args_input << " members of " << t;});
+
+          args.resize (args_input);
+          args.insert (args.end (), cargs.begin (), cargs.end ());
+          args.push_back (nullptr);
+
+          incr = true;
+        }
+      }
+
       // Cleanup old (versioned) libraries. Let's do it even for dry-run to
       // keep things simple.
       //
@@ -2984,10 +3518,10 @@ namespace build2
         // We use relative paths to the object files which means we may end
         // up with different ones depending on CWD and some implementation
         // treat them as different archive members. So remote the file to
-        // be sure. Note that we ignore errors leaving it to the archiever
-        // to complain.
+        // be sure (unless updating incrementally; see above). Note that we
+        // ignore errors leaving it to the archiever to complain.
         //
-        if (mt != timestamp_nonexistent)
+        if (mt != timestamp_nonexistent && !incr)
           try_rmfile (relt, true);
       }
 
@@ -3002,104 +3536,166 @@ namespace build2
       // the "logical" command line while at level 2 and above -- what we are
       // actually executing.
       //
-      // On Windows we need to deal with the command line length limit. The
-      // best workaround seems to be passing (part of) the command line in an
-      // "options file" ("response file" in Microsoft's terminology). Both
-      // Microsoft's link.exe/lib.exe as well as GNU g??.exe/ar.exe support
+      // We need to deal with the command line length limit (see
+      // command_line_limit()) which we may hit when linking lots of object
+      // files (for example, via utility libraries). The best workaround seems
+      // to be passing (part of) the command line in an "options file"
+      // ("response file" in Microsoft's terminology). Both Microsoft's
+      // link.exe/lib.exe as well as GNU/LLVM compiler drivers and ar support
       // the same @<file> notation (and with a compatible subset of the
       // content format; see below). Note also that GCC is smart enough to use
       // an options file to call the underlying linker if we called it with
       // @<file>. We will also assume that any other linker that we might be
       // using supports this notation.
       //
+      // Other archivers (for example, BSD and Apple ar) don't support options
+      // files so for them we instead split the input files into batches each
+      // appended to the archive with a separate `ar q` invocation followed by
+      // a single index step (see below).
+      //
       // Note that this is a limitation of the host platform, not the target
       // (and Wine, where these lines are a bit blurred, does not have this
       // length limitation).
       //
-#ifdef _WIN32
       auto_rmfile trm;
       string targ;
+      vector<pair<size_t, size_t>> batches; // Input argument ranges.
       {
+#ifdef _WIN32
         auto quote = [s = string ()] (const char* a) mutable -> const char*
         {
           return process::quote_argument (a, s);
         };
+#else
+        auto quote = [] (const char* a) {return a;};
+#endif
 
         // Calculate the would-be command line length similar to how process'
-        // implementation does it.
+        // implementation does it (on POSIX we count the argument pointers
+        // and terminating nulls, as does ARG_MAX).
         //
+        auto length = [&quote] (const char* a) -> size_t
+        {
+#ifdef _WIN32
+          return strlen (quote (a)) + 1; // Plus the space separator.
+#else
+          return strlen (a) + 1 + sizeof (char*);
+#endif
+        };
+
+        size_t limit (command_line_limit ());
+
         size_t n (0);
         for (const char* a: args)
         {
           if (a != nullptr)
-          {
-            if (n != 0)
-              n++; // For the space separator.
-
-            n += strlen (quote (a));
-          }
+            n += length (a);
         }
 
-        if (n > 32766) // 32768 - "Unicode terminating null character".
+        if (n > limit)
         {
-          // Use the .t extension (for "temporary").
-          //
-          const path& f ((trm = auto_rmfile (relt + ".t")).path);
-
-          try
+          bool rsp (true);
+          if (lt.static_library () && tsys != "win32-msvc")
           {
-            ofdstream ofs (f);
+            const string& id (cast<string> (rs["bin.ar.id"]));
+            rsp = (id == "gnu" || id == "llvm");
+          }
 
-            // Both Microsoft and GNU support a space-separated list of
-            // potentially-quoted arguments. GNU also supports backslash-
-            // escaping (whether Microsoft supports it is unclear; but it
-            // definitely doesn't need it for backslashes themselves, for
-            // example, in paths).
+          if (rsp)
+          {
+            // Use the .t extension (for "temporary").
             //
-            bool e (tsys != "win32-msvc"); // Assume GNU if not MSVC.
-            string b;
+            const path& f ((trm = auto_rmfile (relt + ".t")).path);
 
-            for (size_t i (args_input), n (args.size () - 1); i != n; ++i)
+            try
             {
-              const char* a (args[i]);
+              ofdstream ofs (f);
+
+              // Both Microsoft and GNU support a space-separated list of
+              // potentially-quoted arguments. GNU also supports backslash-
+              // escaping (whether Microsoft supports it is unclear; but it
+              // definitely doesn't need it for backslashes themselves, for
+              // example, in paths).
+              //
+              bool e (tsys != "win32-msvc"); // Assume GNU if not MSVC.
+              string b;
 
-              if (e) // We will most likely have backslashes so just do it.
+              for (size_t i (args_input), n (args.size () - 1); i != n; ++i)
               {
-                for (b.clear (); *a != '\0'; ++a)
+                const char* a (args[i]);
+
+                if (e) // We will most likely have backslashes so just do it.
+                {
+                  for (b.clear (); *a != '\0'; ++a)
+                  {
+#ifndef _WIN32
+                    // There is no Windows-style quoting (see above) so also
+                    // escape whitespaces and quotes.
+                    //
+                    if (*a == ' ' || *a == '\t' || *a == '\'' || *a == '"')
+                      b += '\\';
+#endif
+                    if (*a != '\\')
+                      b += *a;
+                    else
+                      b += "\\\\";
+                  }
+
+                  a = b.c_str ();
+                }
+#ifndef _WIN32
+                else if (strpbrk (a, " \t") != nullptr) // Say, lld-link.
                 {
-                  if (*a != '\\')
-                    b += *a;
-                  else
-                    b += "\\\\";
+                  b = '"';
+                  b += a;
+                  b += '"';
+                  a = b.c_str ();
                 }
+#endif
 
-                a = b.c_str ();
+                ofs << (i != args_input ? " " : "") << quote (a);
               }
 
-              ofs << (i != args_input ? " " : "") << quote (a);
+              ofs << '\n';
+              ofs.close ();
+            }
+            catch (const io_error& e)
+            {
+              fail << "unable to write to " << f << ": " << e;
             }
 
-            ofs << '\n';
-            ofs.close ();
+            // Replace input arguments with @file.
+            //
+            targ = '@' + f.string ();
+            args.resize (args_input);
+            args.push_back (targ.c_str());
+            args.push_back (nullptr);
+
+            //@@ TODO: leave .t file if linker failed and verb > 2?
           }
-          catch (const io_error& e)
+          else
           {
-            fail << "unable to write to " << f << ": " << e;
-          }
+            // Note that we always put at least one input into a batch.
+            //
+            size_t m (0);
+            for (size_t i (0); i != args_input; ++i)
+              m += length (args[i]);
 
-          // Replace input arguments with @file.
-          //
-          targ = '@' + f.string ();
-          args.resize (args_input);
-          args.push_back (targ.c_str());
-          args.push_back (nullptr);
+            for (size_t i (args_input), e (args.size () - 1); i != e; )
+            {
+              size_t b (i);
+              for (size_t k (m);
+                   i != e && (i == b || k + length (args[i]) <= limit);
+                   ++i)
+                k += length (args[i]);
 
-          //@@ TODO: leave .t file if linker failed and verb > 2?
+              batches.emplace_back (b, i);
+            }
+          }
         }
       }
-#endif
 
-      if (verb > 2)
+      if (verb > 2 && batches.empty ())
         print_process (args);
 
       // Remove the target file if any of the subsequent (after the linker)
@@ -3113,76 +3709,144 @@ namespace build2
       {
         rm = auto_rmfile (relt);
 
-        try
+        // Append the input files to the archive in batches. We have removed
+        // the old archive above so it is created by the first batch. Unless
+        // ranlib is used (see below), create the archive index at the end.
+        //
+        // If we are updating incrementally, then we have to replace the
+        // members in place and so keep the original operation (which takes
+        // care of the index as well).
+        //
+        if (!batches.empty ())
         {
-          // VC tools (both lib.exe and link.exe) send diagnostics to stdout.
-          // Also, link.exe likes to print various gratuitous messages. So for
-          // link.exe we redirect stdout to a pipe, filter that noise out, and
-          // send the rest to stderr.
-          //
-          // For lib.exe (and any other insane linker that may try to pull off
-          // something like this) we are going to redirect stdout to stderr.
-          // For sane compilers this should be harmless.
-          //
-          // Note that we don't need this for LLD's link.exe replacement which
-          // is quiet.
+          cstrings bargs (args.begin (), args.begin () + args_input);
+
+          // Note that we keep the thin (T) and deterministic (D) modifiers
+          // when appending.
           //
-          bool filter (tsys == "win32-msvc"  &&
-                       !lt.static_library () &&
-                       cast<string> (rs["bin.ld.id"]) != "msvc-lld");
+          string bm;
+          if (!incr)
+          {
+            bm = "qc";
+            for (char c: arg1)
+              if (c == 'T' || c == 'D')
+                bm += c;
 
-          process pr (*ld,
-                      args.data (),
-                      0                  /* stdin  */,
-                      (filter ? -1 : 2)  /* stdout */,
-                      2                  /* stderr */,
-                      nullptr            /* cwd    */,
-                      env_ptrs.empty () ? nullptr : env_ptrs.data ());
+            bargs[1] = bm.c_str ();
+          }
 
-          if (filter)
+          for (const pair<size_t, size_t>& b: batches)
           {
-            try
-            {
-              ifdstream is (
-                move (pr.in_ofd), fdstream_mode::text, ifdstream::badbit);
+            bargs.resize (args_input);
+            bargs.insert (bargs.end (),
+                          args.begin () + b.first,
+                          args.begin () + b.second);
+            bargs.push_back (nullptr);
+
+            if (verb > 2)
+              print_process (bargs);
+
+            run (*ld,
+                 bargs,
+                 dir_path () /* cwd */,
+                 env_ptrs.empty () ? nullptr : env_ptrs.data ());
+          }
 
-              msvc_filter_link (is, t, ot);
+          if (!incr && !ranlib)
+          {
+            const char* args[] = {
+              ld->recall_string (),
+              "s",
+              relt.string ().c_str (),
+              nullptr};
 
-              // If anything remains in the stream, send it all to stderr.
-              // Note that the eof check is important: if the stream is at
-              // eof, this and all subsequent writes to the diagnostics stream
-              // will fail (and you won't see a thing).
-              //
-              if (is.peek () != ifdstream::traits_type::eof ())
-                diag_stream_lock () << is.rdbuf ();
+            if (verb > 2)
+              print_process (args);
 
-              is.close ();
-            }
-            catch (const io_error&) {} // Assume exits with error.
+            run (*ld,
+                 args,
+                 dir_path () /* cwd */,
+                 env_ptrs.empty () ? nullptr : env_ptrs.data ());
           }
-
-          run_finish (args, pr);
         }
-        catch (const process_error& e)
+        else
         {
-          error << "unable to execute " << args[0] << ": " << e;
-
-          // In a multi-threaded program that fork()'ed but did not exec(), it
-          // is unwise to try to do any kind of cleanup (like unwinding the
-          // stack and running destructors).
-          //
-          if (e.child)
+          try
           {
-            rm.cancel ();
-#ifdef _WIN32
-            trm.cancel ();
-#endif
-            exit (1);
+            // VC tools (both lib.exe and link.exe) send diagnostics to
+            // stdout. Also, link.exe likes to print various gratuitous
+            // messages. So for link.exe we redirect stdout to a pipe, filter
+            // that noise out, and send the rest to stderr.
+            //
+            // For lib.exe (and any other insane linker that may try to pull
+            // off something like this) we are going to redirect stdout to
+            // stderr. For sane compilers this should be harmless.
+            //
+            // Note that we don't need this for LLD's link.exe replacement
+            // which is quiet.
+            //
+            bool filter (tsys == "win32-msvc"  &&
+                         !lt.static_library () &&
+                         cast<string> (rs["bin.ld.id"]) != "msvc-lld");
+
+            process pr (
+              process_spawn (
+                *ld,
+                args.data (),
+                0                  /* stdin  */,
+                (filter ? -1 : 2)  /* stdout */,
+                2                  /* stderr */,
+                nullptr            /* cwd    */,
+                env_ptrs.empty () ? nullptr : env_ptrs.data ()));
+
+            if (filter)
+            {
+              try
+              {
+                ifdstream is (
+                  move (pr.in_ofd), fdstream_mode::text, ifdstream::badbit);
+
+                msvc_filter_link (is, t, ot);
+
+                // If anything remains in the stream, send it all to stderr.
+                // Note that the eof check is important: if the stream is at
+                // eof, this and all subsequent writes to the diagnostics
+                // stream will fail (and you won't see a thing).
+                //
+                if (is.peek () != ifdstream::traits_type::eof ())
+                  diag_stream_lock () << is.rdbuf ();
+
+                is.close ();
+              }
+              catch (const io_error&) {} // Assume exits with error.
+            }
+
+            run_finish (args, pr);
           }
+          catch (const process_error& e)
+          {
+            error << "unable to execute " << args[0] << ": " << e;
 
-          throw failed ();
+            // In a multi-threaded program that fork()'ed but did not exec(),
+            // it is unwise to try to do any kind of cleanup (like unwinding
+            // the stack and running destructors).
+            //
+            if (e.child)
+            {
+              rm.cancel ();
+              trm.cancel ();
+              exit (1);
+            }
+
+            throw failed ();
+          }
         }
 
+        // Return the LTO job slots, if any (see above).
+        //
+        ctx.sched.deallocate (lto_slots);
+        lto_slots = 0;
+
         // Clean up executable's import library (see above for details).
         //
         if (lt.executable () && tsys == "win32-msvc")
@@ -3211,6 +3875,63 @@ namespace build2
                env_ptrs.empty () ? nullptr : env_ptrs.data ());
       }
 
+      // Package the split DWARF .dwo files into the .dwp file and/or split
+      // the debug information off into the .debug file, leaving only the
+      // link to it (by name and CRC) in the binary.
+      //
+      // Note that dwp reads the .dwo file names from the skeleton units in
+      // the binary which are removed by objcopy --strip-debug so the order
+      // is important.
+      //
+      auto run_tool = [&ctx, &env_ptrs] (const process_path& pp,
+                                         const char* args[])
+      {
+        args[0] = pp.recall_string ();
+
+        if (verb >= 2)
+          print_process (args);
+
+        if (!ctx.dry_run)
+          run (pp,
+               args,
+               dir_path () /* cwd */,
+               env_ptrs.empty () ? nullptr : env_ptrs.data ());
+      };
+
+      if (dwp != nullptr)
+      {
+        string o (relative (dwp->path ()).string ());
+
+        const char* args[] = {
+          nullptr, "-e", relt.string ().c_str (), "-o", o.c_str (), nullptr};
+
+        run_tool (cast<process_path> (rs["bin.dwp.path"]), args);
+      }
+
+      if (dbg != nullptr)
+      {
+        const process_path& oc (cast<process_path> (rs["bin.objcopy.path"]));
+
+        string d (relative (dbg->path ()).string ());
+        string l ("--add-gnu-debuglink=" + d);
+
+        {
+          const char* args[] = {
+            nullptr, "--only-keep-debug", relt.string ().c_str (), d.c_str (),
+            nullptr};
+
+          run_tool (oc, args);
+        }
+
+        {
+          const char* args[] = {
+            nullptr, "--strip-debug", l.c_str (), relt.string ().c_str (),
+            nullptr};
+
+          run_tool (oc, args);
+        }
+      }
+
       // For Windows generate (or clean up) rpath-emulating assembly.
       //
       if (tclass == "windows")
@@ -3366,9 +4087,8 @@ namespace build2
         if (extras.empty ())
           extras = {".d"}; // Default.
 
-#ifdef _WIN32
         extras.push_back (".t"); // Options file.
-#endif
+
         // For shared libraries we may have a bunch of symlinks that we need
         // to remove.
         //
@@ -133,11 +133,21 @@ namespace build2
                         const file&, bool, lflags,
                         const scope&, action, linfo) const;
 
+      // Shared libraries that only render us out of date if their interface
+      // has changed (see elf_interface_checksum()).
+      //
+      struct interface_libs
+      {
+        vector<const file*> libs;
+        bool                newer = false; // Some are newer than the target.
+      };
+
       void
       append_libraries (sha256&,
                         bool&, timestamp,
                         const file&, bool, lflags,
-                        const scope&, action, linfo) const;
+                        const scope&, action, linfo,
+                        interface_libs*) const;
 
       void
       rpath_libraries (strings&,
@@ -177,6 +187,14 @@ namespace build2
       pair<path, timestamp>
       windows_manifest (const file&, bool rpath_assembly) const;
 
+      // ELF-specific (elf-interface.cxx).
+      //
+      // Return the checksum of the shared library's interface or nullopt if
+      // the file is not ELF or cannot be read.
+      //
+      optional<string>
+      elf_interface_checksum (const path&) const;
+
       // pkg-config's .pc file generation (pkgconfig.cxx).
       //
       void
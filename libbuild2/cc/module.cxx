@@ -682,6 +682,34 @@ namespace build2
       //
       load_module (rs, rs, "cc.core", loc);
 
+      // If the linker kind is specified, then make sure the compiler driver
+      // will resolve it to the linker that we have probed (see the link rule
+      // for how it is passed).
+      //
+      // Clang is given the linker path directly. GCC, however, only accepts
+      // the kind and looks for ld.<kind> in its program search path, which
+      // we prefix with the linker's directory. GCC prior to 12 does not
+      // recognize mold at all.
+      //
+      if (const string* k = cast_null<string> (rs["bin.ld.kind"]))
+      {
+        if (ctype == compiler_type::gcc)
+        {
+          const path& ld (cast<process_path> (rs["bin.ld.path"]).effect);
+
+          if (*k == "mold" && cmaj < 12)
+            fail (loc) << "GCC " << cmaj << " does not support mold" <<
+              info << "GCC 12 or later is required for config.bin.ld.kind="
+                   << *k;
+
+          if (ld.leaf ().string () != "ld." + *k)
+            fail (loc) << "GCC can only use " << *k << " linker named ld."
+                       << *k <<
+              info << "linker is " << ld <<
+              info << "use config.bin.ld to specify ld." << *k << " path";
+        }
+      }
+
       // Process, sort, and cache (in this->xlate_hdr) translatable headers.
       // Keep the cache NULL if unused or empty.
       //
@@ -812,6 +840,18 @@ namespace build2
         r.insert<objs> (perform_clean_id,    x_compile, cr);
         r.insert<objs> (configure_update_id, x_compile, cr);
 
+        r.insert<pche> (perform_update_id,    x_compile, cr);
+        r.insert<pche> (perform_clean_id,     x_compile, cr);
+        r.insert<pche> (configure_update_id,  x_compile, cr);
+
+        r.insert<pcha> (perform_update_id,    x_compile, cr);
+        r.insert<pcha> (perform_clean_id,     x_compile, cr);
+        r.insert<pcha> (configure_update_id,  x_compile, cr);
+
+        r.insert<pchs> (perform_update_id,   x_compile, cr);
+        r.insert<pchs> (perform_clean_id,    x_compile, cr);
+        r.insert<pchs> (configure_update_id, x_compile, cr);
+
         if (modules)
         {
           r.insert<bmie> (perform_update_id,    x_compile, cr);
@@ -8,6 +8,8 @@
 #  include <libpkgconf/libpkgconf.h>
 #endif
 
+#include <map>
+
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
@@ -82,6 +84,11 @@ namespace build2
   // - in directory of the specified file
   // - in pc_dirs directories (in the natural order)
   //
+  // Note that the parsed package information is cached in the context (see
+  // pkgconf_cache below).
+  //
+  struct pkgconf_data;
+
   class pkgconf
   {
   public:
@@ -90,8 +97,8 @@ namespace build2
     path_type path;
 
   public:
-    explicit
-    pkgconf (path_type,
+    pkgconf (context&,
+             path_type,
              const dir_paths& pc_dirs,
              const dir_paths& sys_inc_dirs,
              const dir_paths& sys_lib_dirs);
@@ -101,33 +108,6 @@ namespace build2
     //
     pkgconf () = default;
 
-    ~pkgconf ();
-
-    // Movable-only type.
-    //
-    pkgconf (pkgconf&& p)
-        : path (move (p.path)),
-          client_ (p.client_),
-          pkg_ (p.pkg_)
-    {
-      p.client_ = nullptr;
-      p.pkg_ = nullptr;
-    }
-
-    pkgconf&
-    operator= (pkgconf&& p)
-    {
-      if (this != &p)
-      {
-        this->~pkgconf ();
-        new (this) pkgconf (move (p)); // Assume noexcept move-construction.
-      }
-      return *this;
-    }
-
-    pkgconf (const pkgconf&) = delete;
-    pkgconf& operator= (const pkgconf&) = delete;
-
     strings
     cflags (bool stat) const;
 
@@ -141,26 +121,134 @@ namespace build2
     variable (const string& s) const {return variable (s.c_str ());}
 
   private:
-    // Keep them as raw pointers not to deal with API thread-unsafety in
-    // deleters and introducing additional mutex locks.
-    //
-    pkgconf_client_t* client_ = nullptr;
-    pkgconf_pkg_t* pkg_ = nullptr;
+    shared_ptr<pkgconf_data> data_;
   };
 
-  // Currently the library is not thread-safe, even on the pkgconf_client_t
-  // level (see issue #128 for details).
-  //
-  // @@ An update: seems that the obvious thread-safety issues are fixed.
-  //    However, let's keep mutex locking for now not to introduce potential
-  //    issues before we make sure that there are no other ones.
+  // The libpkgconf client is not thread-safe but different clients can be
+  // used concurrently (see issue #128 for details). The exception is the
+  // client creation which may initialize the shared default personality and
+  // which we serialize with this mutex.
   //
   static mutex pkgconf_mutex;
 
+  // Each .pc file is loaded by its own libpkgconf client and the query
+  // results are memoized. All the other members are protected by mutex_ so
+  // that different files are parsed and queried in parallel.
+  //
+  // Besides the file itself, the results depend on the .pc files of the
+  // packages it requires (recursively) and so we also keep track of the
+  // modification times of all the files in this closure (see
+  // pkgconf_cache).
+  //
+  struct pkgconf_data
+  {
+    mutex mutex_;
+
+    std::map<path, timestamp> files;
+
+    pkgconf_client_t* client = nullptr;
+    pkgconf_pkg_t* pkg = nullptr;
+
+    optional<strings> cflags[2]; // Shared and static.
+    optional<strings> libs[2];
+
+    pkgconf_data () = default;
+
+    pkgconf_data (const pkgconf_data&) = delete;
+    pkgconf_data& operator= (const pkgconf_data&) = delete;
+
+    ~pkgconf_data ()
+    {
+      if (client != nullptr)
+      {
+        if (pkg != nullptr)
+          pkgconf_pkg_unref (client, pkg);
+
+        pkgconf_client_free (client);
+      }
+    }
+  };
+
+  // The parsed .pc files cache, one per context (see context::module_data).
+  //
+  // The key is the .pc file path followed by the search and the filter
+  // directories (which affect the result) and the entry is reused as long as
+  // the modification times of all the files in its closure (see above) have
+  // not changed. This way the same file is only parsed once even if it is
+  // imported by many projects or loaded by several modules (c, cxx). Note
+  // that parsing is performed without holding the cache lock.
+  //
+  struct pkgconf_cache
+  {
+    mutex mutex_;
+    std::map<string, shared_ptr<pkgconf_data>> map_;
+
+    static pkgconf_cache&
+    instance (context& ctx)
+    {
+      return *static_pointer_cast<pkgconf_cache> (
+        ctx.module_data ("cc.pkgconf",
+                         [] () {return make_shared<pkgconf_cache> ();}));
+    }
+  };
+
   // The package dependency traversal depth limit.
   //
   static const int pkgconf_max_depth = 100;
 
+  // Return true if the modification times of all the files in the closure
+  // are still the same. Should be called while holding the data lock.
+  //
+  static bool
+  pkgconf_valid (const pkgconf_data& d)
+  {
+    for (const auto& f: d.files)
+    {
+      if (mtime (f.first) != f.second)
+        return false;
+    }
+
+    return true;
+  }
+
+  // Collect the .pc files of the package and its dependencies (traversed
+  // with the client's current flags).
+  //
+  // Note that the traversal callback signature differs between the library
+  // versions (older versions pass the flags as an additional argument) and
+  // we rely on the template argument deduction to match either.
+  //
+  template <typename... A>
+  static void
+  pkgconf_collect_file (pkgconf_client_t*, pkgconf_pkg_t* p, void* d, A...)
+  {
+    if (p->filename != nullptr)
+      static_cast<strings*> (d)->push_back (p->filename);
+  }
+
+  // Add the .pc files of the package and its dependencies to the closure.
+  // Should be called while holding the data lock after a successful flags
+  // query (so that all the dependencies are already resolved).
+  //
+  static void
+  pkgconf_add_files (pkgconf_data& d)
+  {
+    strings fs;
+    pkgconf_pkg_traverse (d.client, d.pkg,
+                          &pkgconf_collect_file, &fs,
+                          pkgconf_max_depth, 0 /* skip_flags */);
+
+    for (string& f: fs)
+    {
+      path p (move (f));
+      if (d.files.find (p) == d.files.end ())
+      {
+        timestamp mt (mtime (p));
+        d.files.emplace (move (p), mt);
+      }
+    }
+  }
+
   // Normally the error_handler() callback can be called multiple times to
   // report a single error (once per message line), to produce a multi-line
   // message like this:
@@ -296,12 +384,51 @@ namespace build2
   // for example "not found".
   //
   pkgconf::
-  pkgconf (path_type p,
+  pkgconf (context& ctx,
+           path_type p,
            const dir_paths& pc_dirs,
            const dir_paths& sys_lib_dirs,
            const dir_paths& sys_inc_dirs)
       : path (move (p))
   {
+    pkgconf_cache& cache (pkgconf_cache::instance (ctx));
+
+    string k (path.string ());
+    for (const dir_paths* ds: {&pc_dirs, &sys_lib_dirs, &sys_inc_dirs})
+    {
+      k += '\0';
+      for (const dir_path& d: *ds)
+      {
+        k += d.string ();
+        k += '\n';
+      }
+    }
+
+    {
+      shared_ptr<pkgconf_data> d;
+      {
+        mlock l (cache.mutex_);
+
+        auto i (cache.map_.find (k));
+        if (i != cache.map_.end ())
+          d = i->second;
+      }
+
+      // Note that the closure can be extended by another thread (see
+      // pkgconf_add_files()) and so we have to check it under the data lock.
+      //
+      if (d != nullptr)
+      {
+        mlock l (d->mutex_);
+
+        if (pkgconf_valid (*d))
+        {
+          data_ = move (d);
+          return;
+        }
+      }
+    }
+
     auto add_dirs = [] (pkgconf_list_t& dir_list,
                         const dir_paths& dirs,
                         bool suppress_dups,
@@ -317,17 +444,26 @@ namespace build2
         pkgconf_path_add (d.string ().c_str (), &dir_list, suppress_dups);
     };
 
-    mlock l (pkgconf_mutex);
+    // If another thread beats us to it, we just use ours.
+    //
+    // Note also that until the data is added to the cache no other thread
+    // can see it and so we don't need to lock it.
+    //
+    shared_ptr<pkgconf_data> d (make_shared<pkgconf_data> ());
+    d->files.emplace (path, mtime (path));
 
     // Initialize the client handle.
     //
-    unique_ptr<pkgconf_client_t, void (*) (pkgconf_client_t*)> c (
-      call_pkgconf_client_new (&pkgconf_client_new,
-                               pkgconf_error_handler,
-                               nullptr /* handler_data */),
-      [] (pkgconf_client_t* c) {pkgconf_client_free (c);});
+    pkgconf_client_t* c;
+    {
+      mlock l (pkgconf_mutex);
+      c = call_pkgconf_client_new (&pkgconf_client_new,
+                                   pkgconf_error_handler,
+                                   nullptr /* handler_data */);
+    }
+    d->client = c;
 
-    pkgconf_client_set_flags (c.get (), pkgconf_flags);
+    pkgconf_client_set_flags (c, pkgconf_flags);
 
     // Note that the system header and library directory lists are
     // automatically pre-filled by the pkgconf_client_new() call (see above).
@@ -348,9 +484,9 @@ namespace build2
     // until flags retrieval, and their file directories are not added to the
     // search list.
     //
-    pkg_ = pkgconf_pkg_find (c.get (), path.string ().c_str ());
+    d->pkg = pkgconf_pkg_find (c, path.string ().c_str ());
 
-    if (pkg_ == nullptr)
+    if (d->pkg == nullptr)
       fail << "package '" << path << "' not found or invalid";
 
     // Add the .pc file search directories.
@@ -358,31 +494,26 @@ namespace build2
     assert (c->dir_list.length == 1); // Package file directory (see above).
     add_dirs (c->dir_list, pc_dirs, true /* suppress_dups */);
 
-    client_ = c.release ();
-  }
-
-  pkgconf::
-  ~pkgconf ()
-  {
-    if (client_ != nullptr) // Not empty.
-    {
-      assert (pkg_ != nullptr);
+    data_ = move (d);
 
-      mlock l (pkgconf_mutex);
-      pkgconf_pkg_unref (client_, pkg_);
-      pkgconf_client_free (client_);
-    }
+    mlock cl (cache.mutex_);
+    cache.map_[move (k)] = data_;
   }
 
   strings pkgconf::
   cflags (bool stat) const
   {
-    assert (client_ != nullptr); // Must not be empty.
+    assert (data_ != nullptr); // Must not be empty.
 
-    mlock l (pkgconf_mutex);
+    pkgconf_data& d (*data_);
+    mlock l (d.mutex_);
+
+    optional<strings>& r (d.cflags[stat ? 1 : 0]);
+    if (r)
+      return *r;
 
     pkgconf_client_set_flags (
-      client_,
+      d.client,
       pkgconf_flags |
 
       // Walk through the private package dependencies (Requires.private)
@@ -399,24 +530,32 @@ namespace build2
        : 0));
 
     pkgconf_list_t f = PKGCONF_LIST_INITIALIZER; // Aggregate initialization.
-    int e (pkgconf_pkg_cflags (client_, pkg_, &f, pkgconf_max_depth));
+    int e (pkgconf_pkg_cflags (d.client, d.pkg, &f, pkgconf_max_depth));
 
     if (e != PKGCONF_PKG_ERRF_OK)
       throw failed (); // Assume the diagnostics is issued.
 
     unique_ptr<pkgconf_list_t, fragments_deleter> fd (&f); // Auto-deleter.
-    return to_strings (f, 'I', client_->filter_includedirs);
+    r = to_strings (f, 'I', d.client->filter_includedirs);
+
+    pkgconf_add_files (d);
+    return *r;
   }
 
   strings pkgconf::
   libs (bool stat) const
   {
-    assert (client_ != nullptr); // Must not be empty.
+    assert (data_ != nullptr); // Must not be empty.
 
-    mlock l (pkgconf_mutex);
+    pkgconf_data& d (*data_);
+    mlock l (d.mutex_);
+
+    optional<strings>& r (d.libs[stat ? 1 : 0]);
+    if (r)
+      return *r;
 
     pkgconf_client_set_flags (
-      client_,
+      d.client,
       pkgconf_flags |
 
       // Additionally collect flags from the private dependency packages
@@ -428,22 +567,27 @@ namespace build2
        : 0));
 
     pkgconf_list_t f = PKGCONF_LIST_INITIALIZER; // Aggregate initialization.
-    int e (pkgconf_pkg_libs (client_, pkg_, &f, pkgconf_max_depth));
+    int e (pkgconf_pkg_libs (d.client, d.pkg, &f, pkgconf_max_depth));
 
     if (e != PKGCONF_PKG_ERRF_OK)
       throw failed (); // Assume the diagnostics is issued.
 
     unique_ptr<pkgconf_list_t, fragments_deleter> fd (&f); // Auto-deleter.
-    return to_strings (f, 'L', client_->filter_libdirs);
+    r = to_strings (f, 'L', d.client->filter_libdirs);
+
+    pkgconf_add_files (d);
+    return *r;
   }
 
   string pkgconf::
   variable (const char* name) const
   {
-    assert (client_ != nullptr); // Must not be empty.
+    assert (data_ != nullptr); // Must not be empty.
+
+    pkgconf_data& d (*data_);
+    mlock l (d.mutex_);
 
-    mlock l (pkgconf_mutex);
-    const char* r (pkgconf_tuple_find (client_, &pkg_->vars, name));
+    const char* r (pkgconf_tuple_find (d.client, &d.pkg->vars, name));
     return r != nullptr ? string (r) : string ();
   }
 
@@ -505,8 +649,19 @@ namespace build2
     // true.
     //
     bool common::
-    pkgconfig_derive (const dir_path& d, const pkgconfig_callback& f) const
+    pkgconfig_derive (context& ctx,
+                      const dir_path& d,
+                      const pkgconfig_callback& f) const
     {
+      // Note that we check the directories via the (cached) listings of
+      // their parents.
+      //
+      auto exists = [&ctx] (const dir_path& d)
+      {
+        return ctx.dir_cache.exists (d.directory (),
+                                     path (d.leaf ().string ()));
+      };
+
       dir_path pd (d);
 
       // First always check the pkgconfig/ subdirectory in this library
@@ -549,17 +704,20 @@ namespace build2
     // consider our .static/.shared files.
     //
     pair<path, path> common::
-    pkgconfig_search (const dir_path& libd,
+    pkgconfig_search (context& ctx,
+                      const dir_path& libd,
                       const optional<project_name>& proj,
                       const string& stem,
                       bool common) const
     {
+      directory_cache& dc (ctx.dir_cache);
+
       // When it comes to looking for .pc files we have to decide where to
       // search (which directory(ies)) as well as what to search for (which
       // names). Suffix is our ".shared" or ".static" extension.
       //
-      auto search_dir = [&proj, &stem] (const dir_path& dir,
-                                        const string& sfx) -> path
+      auto search_dir = [&proj, &stem, &dc] (const dir_path& dir,
+                                             const string& sfx) -> path
       {
         path f;
 
@@ -580,14 +738,14 @@ namespace build2
         f += stem;
         f += sfx;
         f += ".pc";
-        if (exists (f))
+        if (dc.exists (f))
           return f;
 
         f = dir;
         f /= stem;
         f += sfx;
         f += ".pc";
-        if (exists (f))
+        if (dc.exists (f))
           return f;
 
         if (proj)
@@ -596,7 +754,7 @@ namespace build2
           f /= proj->string ();
           f += sfx;
           f += ".pc";
-          if (exists (f))
+          if (dc.exists (f))
             return f;
         }
 
@@ -634,7 +792,7 @@ namespace build2
 
       pair<path, path> r;
 
-      if (pkgconfig_derive (libd, check))
+      if (pkgconfig_derive (ctx, libd, check))
       {
         r.first  = move (d.a);
         r.second = move (d.s);
@@ -658,7 +816,7 @@ namespace build2
       assert (at != nullptr || st != nullptr);
 
       pair<path, path> p (
-        pkgconfig_search (libd, proj, stem, true /* common */));
+        pkgconfig_search (s.ctx, libd, proj, stem, true /* common */));
 
       if (p.first.empty () && p.second.empty ())
         return false;
@@ -1216,17 +1374,19 @@ namespace build2
         return false;
       };
 
-      pkgconfig_derive (libd, add_pc_dir);
-      for (const dir_path& d: top_usrd) pkgconfig_derive (d, add_pc_dir);
-      for (const dir_path& d: top_sysd) pkgconfig_derive (d, add_pc_dir);
+      context& ctx (s.ctx);
+
+      pkgconfig_derive (ctx, libd, add_pc_dir);
+      for (const dir_path& d: top_usrd) pkgconfig_derive (ctx, d, add_pc_dir);
+      for (const dir_path& d: top_sysd) pkgconfig_derive (ctx, d, add_pc_dir);
 
       bool pa (at != nullptr && !ap.empty ());
       if (pa || sp.empty ())
-        apc = pkgconf (ap, pc_dirs, sys_lib_dirs, sys_inc_dirs);
+        apc = pkgconf (ctx, ap, pc_dirs, sys_lib_dirs, sys_inc_dirs);
 
       bool ps (st != nullptr && !sp.empty ());
       if (ps || ap.empty ())
-        spc = pkgconf (sp, pc_dirs, sys_lib_dirs, sys_inc_dirs);
+        spc = pkgconf (ctx, sp, pc_dirs, sys_lib_dirs, sys_inc_dirs);
 
       // Sort out the interface dependencies (which we are setting on lib{}).
       // If we have the shared .pc variant, then we use that.  Otherwise --
@@ -1273,7 +1433,8 @@ namespace build2
 #else
 
     pair<path, path> common::
-    pkgconfig_search (const dir_path&,
+    pkgconfig_search (context&,
+                      const dir_path&,
                       const optional<project_name>&,
                       const string&,
                       bool) const
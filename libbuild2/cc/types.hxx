@@ -76,6 +76,10 @@ namespace build2
       return os << (l == lang::c ? "C" : "C++");
     }
 
+    // Link-time optimization mode (cc.lto).
+    //
+    enum class lto_mode {none, full, thin};
+
     // Compile target types.
     //
     struct compile_target_types
@@ -83,6 +87,7 @@ namespace build2
       const target_type& obj;
       const target_type& bmi;
       const target_type& hbmi;
+      const target_type& pch;
     };
   }
 }
@@ -4,6 +4,8 @@
 #include <libbuild2/cc/utility.hxx>
 
 #include <libbuild2/file.hxx>
+#include <libbuild2/scope.hxx>
+#include <libbuild2/diagnostics.hxx>
 
 using namespace std;
 
@@ -17,5 +19,51 @@ namespace build2
     const dir_path module_build_dir (dir_path (module_dir) /= "build");
     const dir_path module_build_modules_dir (
       dir_path (module_build_dir) /= "modules");
+    const dir_path module_lto_cache_dir (dir_path (module_dir) /= "lto");
+
+    const scope&
+    outer_root (const scope& rs)
+    {
+      const scope* as (&rs);
+      {
+        const scope* ws (as->weak_scope ());
+        if (as != ws)
+        {
+          const scope* s (as);
+          do
+          {
+            s = s->parent_scope ()->root_scope ();
+
+            // Use cc.core.vars as a proxy for {c,cxx}.config (a bit smelly).
+            //
+            // This is also the module that registers the scope operation
+            // callback that cleans up the per-configuration state.
+            //
+            if (cast_false<bool> ((*s)["cc.core.vars.loaded"]))
+              as = s;
+
+          } while (s != ws);
+        }
+      }
+
+      return *as;
+    }
+
+    lto_mode
+    lto_type (const target& t)
+    {
+      if (const string* v = cast_null<string> (t["cc.lto"]))
+      {
+        if (*v == "full") return lto_mode::full;
+        if (*v == "thin") return lto_mode::thin;
+
+        if (*v != "none")
+          fail << "invalid cc.lto value '" << *v << "'" <<
+            info << "expected none, full, or thin" <<
+            info << "required by " << t;
+      }
+
+      return lto_mode::none;
+    }
   }
 }
@@ -31,6 +31,19 @@ namespace build2
     extern const dir_path module_dir;               // cc/
     extern const dir_path module_build_dir;         // cc/build/
     extern const dir_path module_build_modules_dir; // cc/build/modules/
+    extern const dir_path module_lto_cache_dir;     // cc/lto/
+
+    // Return the outermost root scope within this project's amalgamation
+    // that has loaded the cc.core.vars module (normally the configuration
+    // root). Used for per-configuration state such as module sidebuilds.
+    //
+    const scope&
+    outer_root (const scope& root);
+
+    // Return the link-time optimization mode for the target (cc.lto).
+    //
+    lto_mode
+    lto_type (const target&);
 
     // Compile output type from source target.
     //
@@ -10,6 +10,13 @@ namespace build2
     {
       using namespace bin;
 
+      // Precompiled headers have their own hierarchy.
+      //
+      if (t.is_a<pchx> ())
+        return (t.is_a<pche> () ? otype::e :
+                t.is_a<pcha> () ? otype::a :
+                otype::s);
+
       auto test = [&t, u] (const auto& h, const auto& i, const auto& o)
       {
         return t.is_a (u == unit_type::module_header ? h :
@@ -31,6 +38,7 @@ namespace build2
       const target_type* o (nullptr);
       const target_type* i (nullptr);
       const target_type* h (nullptr);
+      const target_type* p (nullptr);
 
       switch (t)
       {
@@ -38,20 +46,23 @@ namespace build2
         o = &obje::static_type;
         i = &bmie::static_type;
         h = &hbmie::static_type;
+        p = &pche::static_type;
         break;
       case otype::a:
         o = &obja::static_type;
         i = &bmia::static_type;
         h = &hbmia::static_type;
+        p = &pcha::static_type;
         break;
       case otype::s:
         o = &objs::static_type;
         i = &bmis::static_type;
         h = &hbmis::static_type;
+        p = &pchs::static_type;
         break;
       }
 
-      return compile_target_types {*o, *i, *h};
+      return compile_target_types {*o, *i, *h, *p};
     }
   }
 }
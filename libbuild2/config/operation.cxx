@@ -7,6 +7,7 @@
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/history.hxx>
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/buildspec.hxx>  // opspec
 #include <libbuild2/filesystem.hxx>
@@ -905,6 +906,16 @@ namespace build2
         {
           r = rmfile (ctx, out_root / rs.root_extra->src_root_file, 2) || r;
 
+          // Remove the execution history (see execution_history for
+          // details) since it would otherwise keep build/ from being
+          // removed.
+          //
+          {
+            path f (execution_history::file (rs));
+            if (!f.empty ())
+              r = rmfile (ctx, f, 2) || r;
+          }
+
           // Clean up the directories.
           //
           // Note: try to remove the root/ hooks directory if it is empty.
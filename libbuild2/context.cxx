@@ -3,14 +3,18 @@
 
 #include <libbuild2/context.hxx>
 
+#include <map>
 #include <sstream>
 #include <exception> // uncaught_exception[s]()
 
 #include <libbuild2/rule.hxx>
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
+#include <libbuild2/history.hxx>
 #include <libbuild2/variable.hxx>
 #include <libbuild2/function.hxx>
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 #include <libbutl/ft/exception.hxx> // uncaught_exceptions
@@ -47,12 +51,21 @@ namespace build2
     variable_pool var_pool;
     variable_overrides var_overrides;
     function_map functions;
+    execution_history history;
+    directory_cache dir_cache;
+
+    mutex module_data_mutex;
+    std::map<string, shared_ptr<void>> module_data;
 
     target_type_map global_target_types;
     variable_override_cache global_override_cache;
     strings global_var_overrides;
 
-    data (context& c): scopes (c), targets (c), var_pool (&c /* global */) {}
+    data (context& c)
+        : scopes (c),
+          targets (c),
+          var_pool (&c /* global */),
+          dir_cache (c) {}
   };
 
   context::
@@ -76,6 +89,8 @@ namespace build2
         var_pool (data_->var_pool),
         var_overrides (data_->var_overrides),
         functions (data_->functions),
+        history (data_->history),
+        dir_cache (data_->dir_cache),
         global_scope (create_global_scope (data_->scopes)),
         global_target_types (data_->global_target_types),
         global_override_cache (data_->global_override_cache),
@@ -584,6 +599,18 @@ namespace build2
     // Cannot be inline since context::data is undefined.
   }
 
+  shared_ptr<void> context::
+  module_data (const string& n, const function<shared_ptr<void> ()>& c)
+  {
+    mlock l (data_->module_data_mutex);
+
+    shared_ptr<void>& r (data_->module_data[n]);
+    if (r == nullptr)
+      r = c ();
+
+    return r;
+  }
+
   void context::
   current_meta_operation (const meta_operation_info& mif)
   {
@@ -614,6 +641,30 @@ namespace build2
     dependency_count.store (0, memory_order_relaxed);
     target_count.store (0, memory_order_relaxed);
     skip_count.store (0, memory_order_relaxed);
+    target_estimate.store (0, memory_order_relaxed);
+  }
+
+  // Record the phase switch in the timeline (see trace_file).
+  //
+  static void
+  trace_phase (run_phase p)
+  {
+    if (trace_file* tf = trace_sink)
+    {
+      ostringstream os;
+      os << p;
+      tf->instant ("phase", os.str (), string ());
+    }
+  }
+
+  // Set the span name for waiting for the phase switch.
+  //
+  static void
+  trace_phase_wait (string& n, run_phase p)
+  {
+    ostringstream os;
+    os << "wait for " << p;
+    n = os.str ();
   }
 
   bool run_phase_mutex::
@@ -643,9 +694,13 @@ namespace build2
       {
         ctx_.phase = p;
         r = !fail_;
+        trace_phase (p);
       }
       else if (ctx_.phase != p)
       {
+        trace_span ts ("phase",
+                       [p] (string& n, string&) {trace_phase_wait (n, p);});
+
         ctx_.sched.deactivate (false /* external */);
         for (; ctx_.phase != p; v->wait (l)) ;
         r = !fail_;
@@ -703,6 +758,8 @@ namespace build2
 
         if (v != nullptr)
         {
+          trace_phase (ctx_.phase);
+
           l.unlock ();
           v->notify_all ();
         }
@@ -748,6 +805,7 @@ namespace build2
       {
         ctx_.phase = n;
         r = !fail_;
+        trace_phase (n);
 
         // Notify others that could be waiting for this phase.
         //
@@ -759,6 +817,9 @@ namespace build2
       }
       else // phase != n
       {
+        trace_span ts ("phase",
+                       [n] (string& s, string&) {trace_phase_wait (s, n);});
+
         ctx_.sched.deactivate (false /* external */);
         for (; ctx_.phase != n; v->wait (l)) ;
         r = !fail_;
@@ -21,6 +21,8 @@
 namespace build2
 {
   class loaded_modules_lock;
+  class execution_history;
+  class directory_cache;
 
   class LIBBUILD2_SYMEXPORT run_phase_mutex
   {
@@ -189,6 +191,11 @@ namespace build2
     //
     bool keep_going;
 
+    // Test result cache flag (see --no-test-cache and the test module for
+    // details).
+    //
+    bool test_cache = true;
+
     // In order to perform each operation the build system goes through the
     // following phases:
     //
@@ -309,6 +316,14 @@ namespace build2
     atomic_count target_count;
     atomic_count skip_count;
 
+    // Estimated total recipe execution time (in milliseconds) of the targets
+    // counted in target_count based on the execution history (see
+    // execution_history). It is incremented during match and decremented
+    // during execution similar to target_count and is used to show the
+    // time remaining in the progress. Zero means unknown.
+    //
+    atomic_count target_estimate;
+
     // Build state (scopes, targets, variables, etc).
     //
     const scope_map& scopes;
@@ -317,6 +332,14 @@ namespace build2
     const variable_overrides& var_overrides; // Project and relative scope.
     function_map& functions;
 
+    // Target execution history (see execution_history for details).
+    //
+    execution_history& history;
+
+    // Directory listing cache (see directory_cache for details).
+    //
+    directory_cache& dir_cache;
+
     // Global scope.
     //
     const scope& global_scope;
@@ -458,6 +481,20 @@ namespace build2
     context* module_context;
     optional<unique_ptr<context>> module_context_storage;
 
+    // Context-wide data of build system modules.
+    //
+    // Some modules need to keep data that is shared among all the projects
+    // in the context (and thus among all the module instances), for
+    // example, caches. Such data is keyed by a module-specific name (for
+    // example, cc.pkgconf) and is destroyed together with the context.
+    //
+    // Return the data for the specified name, creating it with the
+    // specified function if not yet present. This function is MT-safe.
+    //
+    shared_ptr<void>
+    module_data (const string& name,
+                 const function<shared_ptr<void> ()>& create);
+
   public:
     // If module_context is absent, then automatic updating of build system
     // modules and ad hoc recipes is disabled. If it is NULL, then the context
@@ -4,6 +4,7 @@
 #include <libbuild2/diagnostics.hxx>
 
 #include <cstring>  // strchr()
+#include <streambuf>
 
 #include <libbutl/process-io.mxx>
 
@@ -101,6 +102,97 @@ namespace build2
     return r;
   }
 
+  // Diagnostics buffering.
+  //
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  string* diag_buffer = nullptr;
+
+  namespace
+  {
+    // The diag_stream buffer that writes to the current thread's diagnostics
+    // buffer, if any, and to the original diagnostics stream otherwise. Note
+    // that there is no put area so every write ends up in one of these.
+    //
+    class diag_dispatch_buf: public std::streambuf
+    {
+    public:
+      explicit
+      diag_dispatch_buf (ostream& os): os_ (os) {}
+
+    protected:
+      virtual int_type
+      overflow (int_type c) override
+      {
+        if (c == traits_type::eof ())
+          return traits_type::not_eof (c);
+
+        char ch (traits_type::to_char_type (c));
+
+        if (diag_buffer != nullptr)
+          *diag_buffer += ch;
+        else if (!os_.put (ch))
+          return traits_type::eof ();
+
+        return c;
+      }
+
+      virtual streamsize
+      xsputn (const char* s, streamsize n) override
+      {
+        if (diag_buffer != nullptr)
+          diag_buffer->append (s, static_cast<size_t> (n));
+        else if (!os_.write (s, n))
+          return 0;
+
+        return n;
+      }
+
+      virtual int
+      sync () override
+      {
+        return diag_buffer != nullptr || os_.flush () ? 0 : -1;
+      }
+
+    private:
+      ostream& os_;
+    };
+  }
+
+  diag_buffer_guard::
+  diag_buffer_guard (string& b)
+      : prev_ (diag_buffer)
+  {
+    // Install the dispatching diagnostics stream on the first use.
+    //
+    {
+      diag_stream_lock l;
+
+      static ostream* os ([] ()
+      {
+        static diag_dispatch_buf sb (*diag_stream);
+        static ostream r (&sb);
+
+        diag_stream = &r;
+        return &r;
+      } ());
+
+      assert (diag_stream == os);
+    }
+
+    diag_buffer = &b;
+  }
+
+  diag_buffer_guard::
+  ~diag_buffer_guard ()
+  {
+    diag_buffer = prev_;
+  }
+
   // Diagnostic facility, project specifics.
   //
 
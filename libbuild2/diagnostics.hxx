@@ -196,6 +196,31 @@ namespace build2
   using butl::diag_stream;
   using butl::diag_epilogue;
 
+  // Diagnostics buffering.
+  //
+  // While an instance of this guard is alive, the diagnostics issued by the
+  // current thread (more precisely, everything it writes to diag_stream
+  // while holding diag_stream_lock) is appended to the specified string
+  // rather than written to diag_stream. This way the diagnostics of the
+  // operations performed concurrently can be issued later and in the
+  // deterministic order rather than interleaved (see the buildscript
+  // parallel blocks for an example). The guards can be nested with the
+  // innermost one being in effect.
+  //
+  struct LIBBUILD2_SYMEXPORT diag_buffer_guard
+  {
+    explicit
+    diag_buffer_guard (string&);
+
+    ~diag_buffer_guard ();
+
+    diag_buffer_guard (const diag_buffer_guard&) = delete;
+    diag_buffer_guard& operator= (const diag_buffer_guard&) = delete;
+
+  private:
+    string* prev_;
+  };
+
   // Diagnostics stack. Each frame is "applied" to the fail/error/warn/info
   // diag record.
   //
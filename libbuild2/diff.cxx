@@ -0,0 +1,273 @@
+// file      : libbuild2/diff.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/diff.hxx>
+
+#include <algorithm> // reverse(), min()
+
+using namespace std;
+
+namespace build2
+{
+  namespace
+  {
+    struct text_line
+    {
+      string text;
+      bool   newline; // Terminated with a newline.
+
+      bool
+      operator== (const text_line& x) const
+      {
+        return newline == x.newline && text == x.text;
+      }
+    };
+
+    using text_lines = vector<text_line>;
+  }
+
+  // Read the next line returning false if there are no more lines.
+  //
+  static bool
+  read_line (istream& is, bool strip_cr, text_line& l)
+  {
+    // Note that we cannot peek once eof is set since that sets failbit.
+    //
+    if (is.eof () || is.peek () == istream::traits_type::eof ())
+      return false;
+
+    getline (is, l.text);
+    l.newline = !is.eof ();
+
+    if (strip_cr && !l.text.empty () && l.text.back () == '\r')
+      l.text.pop_back ();
+
+    return true;
+  }
+
+  // Calculate the shortest edit script transforming a into b using the
+  // Myers' O(ND) algorithm. The result is a sequence of ' ' (common line),
+  // '-' (line deleted from a), and '+' (line inserted from b) operations.
+  //
+  // Since we store the intermediate state for backtracking (which is
+  // quadratic in the number of differences), we give up and return the
+  // trivial (delete all, insert all) script if there are too many
+  // differences.
+  //
+  static string
+  edit_script (const text_lines& a, const text_lines& b)
+  {
+    using diff_t = ptrdiff_t;
+
+    const diff_t max_d (1000);
+
+    diff_t n (static_cast<diff_t> (a.size ()));
+    diff_t m (static_cast<diff_t> (b.size ()));
+    diff_t off (n + m + 1);
+
+    vector<diff_t> v (2 * off + 1, 0);
+    vector<vector<diff_t>> trace; // trace[d][k + d] is v[k] before step d.
+
+    auto down = [] (const vector<diff_t>& v, diff_t o, diff_t k, diff_t d)
+    {
+      return k == -d || (k != d && v[o + k - 1] < v[o + k + 1]);
+    };
+
+    for (diff_t d (0); d <= n + m; ++d)
+    {
+      if (d > max_d)
+      {
+        string r (static_cast<size_t> (n), '-');
+        r.append (static_cast<size_t> (m), '+');
+        return r;
+      }
+
+      trace.emplace_back (v.begin () + off - d, v.begin () + off + d + 1);
+
+      for (diff_t k (-d); k <= d; k += 2)
+      {
+        diff_t x (down (v, off, k, d) ? v[off + k + 1] : v[off + k - 1] + 1);
+        diff_t y (x - k);
+
+        while (x < n && y < m && a[x] == b[y])
+        {
+          ++x;
+          ++y;
+        }
+
+        v[off + k] = x;
+
+        if (x >= n && y >= m)
+        {
+          // Backtrack.
+          //
+          string r;
+
+          for (diff_t s (d); s >= 0; --s)
+          {
+            const vector<diff_t>& pv (trace[s]);
+            diff_t k (x - y);
+
+            diff_t pk (down (pv, s, k, s) ? k + 1 : k - 1);
+            diff_t px (pk + s >= 0 && pk + s <= 2 * s ? pv[pk + s] : 0);
+            diff_t py (px - pk);
+
+            for (; x > px && y > py; --x, --y)
+              r += ' ';
+
+            if (s > 0)
+              r += (x == px ? '+' : '-');
+
+            x = px;
+            y = py;
+          }
+
+          reverse (r.begin (), r.end ());
+          return r;
+        }
+      }
+    }
+
+    assert (false); // Cannot get here.
+    return string ();
+  }
+
+  // Print the unified diff hunk range.
+  //
+  static void
+  print_range (ostream& os, size_t start, size_t count)
+  {
+    // Note that for an empty range diff prints the line before it.
+    //
+    if (count == 1)
+      os << start + 1;
+    else
+      os << (count == 0 ? start : start + 1) << ',' << count;
+  }
+
+  bool
+  diff_text (istream& expected,
+             istream& actual,
+             bool strip_cr,
+             ostream* diff,
+             const string& expected_label,
+             const string& actual_label,
+             size_t context)
+  {
+    // Compare until the first difference keeping the last context lines.
+    //
+    text_lines ctx;  // Ring buffer.
+    size_t n (0);    // Number of same lines.
+
+    text_line e, a;
+    bool ee, ae;     // Expected/actual have a pending line.
+
+    for (;;)
+    {
+      ee = read_line (expected, strip_cr, e);
+      ae = read_line (actual, strip_cr, a);
+
+      if (!ee && !ae)
+        return true;
+
+      if (!ee || !ae || !(e == a))
+        break;
+
+      if (ctx.size () != context)
+        ctx.push_back (move (e));
+      else if (context != 0)
+        ctx[n % context] = move (e);
+
+      ++n;
+    }
+
+    if (diff == nullptr)
+      return false;
+
+    // Read the rest starting with the context lines.
+    //
+    text_lines es, as;
+    size_t base (n - ctx.size ()); // Number of lines before es[0]/as[0].
+
+    for (size_t i (0); i != ctx.size (); ++i)
+    {
+      const text_line& l (ctx[(base + i) % context]);
+      es.push_back (l);
+      as.push_back (l);
+    }
+
+    if (ee)
+    {
+      es.push_back (move (e));
+      while (read_line (expected, strip_cr, e))
+        es.push_back (move (e));
+    }
+
+    if (ae)
+    {
+      as.push_back (move (a));
+      while (read_line (actual, strip_cr, a))
+        as.push_back (move (a));
+    }
+
+    string r (edit_script (es, as));
+    size_t rn (r.size ());
+
+    // Number of expected/actual lines before each script position.
+    //
+    vector<size_t> ei (rn + 1, 0), ai (rn + 1, 0);
+    for (size_t i (0); i != rn; ++i)
+    {
+      ei[i + 1] = ei[i] + (r[i] != '+' ? 1 : 0);
+      ai[i + 1] = ai[i] + (r[i] != '-' ? 1 : 0);
+    }
+
+    ostream& os (*diff);
+
+    os << "--- " << expected_label << '\n'
+       << "+++ " << actual_label << '\n';
+
+    for (size_t i (0); i != rn; )
+    {
+      if (r[i] == ' ')
+      {
+        ++i;
+        continue;
+      }
+
+      // Find the end of this hunk merging changes that are separated by no
+      // more than twice the context lines.
+      //
+      size_t b (i > context ? i - context : 0);
+      size_t c (i + 1); // End of the last change.
+
+      for (size_t j (i + 1); j != rn && j <= c + 2 * context; ++j)
+      {
+        if (r[j] != ' ')
+          c = j + 1;
+      }
+
+      size_t h (min (rn, c + context));
+
+      os << "@@ -";
+      print_range (os, base + ei[b], ei[h] - ei[b]);
+      os << " +";
+      print_range (os, base + ai[b], ai[h] - ai[b]);
+      os << " @@\n";
+
+      for (size_t j (b); j != h; ++j)
+      {
+        const text_line& l (r[j] == '+' ? as[ai[j]] : es[ei[j]]);
+
+        os << r[j] << l.text << '\n';
+
+        if (!l.newline)
+          os << "\\ No newline at end of file\n";
+      }
+
+      i = h;
+    }
+
+    return false;
+  }
+}
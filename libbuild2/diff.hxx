@@ -0,0 +1,39 @@
+// file      : libbuild2/diff.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_DIFF_HXX
+#define LIBBUILD2_DIFF_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Compare the expected and actual text line by line, optionally ignoring
+  // the trailing carriage returns (similar to diff --strip-trailing-cr), and
+  // return true if they are the same. Otherwise, if the diff stream is not
+  // NULL, write the differences to it in the unified format (similar to
+  // diff -u) with the specified number of context lines using the specified
+  // labels in the header.
+  //
+  // Both streams are read incrementally and while they are the same only the
+  // last few lines (needed for the unified diff context) are retained. The
+  // rest of both streams is only read if the differences are requested.
+  //
+  // Note that the streams are expected to throw on the badbit but not the
+  // failbit (for example, ifdstream::badbit). Any exceptions (io_error,
+  // etc) are propagated.
+  //
+  LIBBUILD2_SYMEXPORT bool
+  diff_text (istream& expected,
+             istream& actual,
+             bool strip_cr,
+             ostream* diff,
+             const string& expected_label,
+             const string& actual_label,
+             size_t context = 3);
+}
+
+#endif // LIBBUILD2_DIFF_HXX
@@ -0,0 +1,233 @@
+// file      : libbuild2/diff.test.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <sstream>
+
+#include <cassert>
+#include <iostream>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/diff.hxx>
+
+using namespace std;
+
+namespace build2
+{
+  int
+  main (int, char*[])
+  {
+    // Return the unified diff between the expected and actual text or the
+    // empty string if they are the same. The expected output (hunk headers
+    // in particular) matches what GNU diff -u prints.
+    //
+    auto td = [] (const string& e,
+                  const string& a,
+                  size_t context = 3,
+                  bool strip_cr = false) -> string
+    {
+      istringstream es (e), as (a);
+      ostringstream os;
+
+      bool r (diff_text (es, as, strip_cr, &os, "e", "a", context));
+      assert (r == os.str ().empty ());
+      return os.str ();
+    };
+
+    // Return the specified number of numbered lines, optionally replacing
+    // some of them.
+    //
+    auto lines = [] (size_t n,
+                     const vector<size_t>& changed = {},
+                     const char* prefix = "") -> string
+    {
+      string r;
+      for (size_t i (1); i <= n; ++i)
+      {
+        bool c (find (changed.begin (), changed.end (), i) != changed.end ());
+        r += (c ? "x" : prefix) + to_string (i) + '\n';
+      }
+      return r;
+    };
+
+    // Same text.
+    //
+    assert (td ("", "") == "");
+    assert (td ("a\nb\n", "a\nb\n") == "");
+    assert (td ("a\nb", "a\nb") == "");
+
+    // Differences without the output stream.
+    //
+    {
+      istringstream es ("a\n"), as ("b\n");
+      assert (!diff_text (es, as, false, nullptr, "e", "a"));
+    }
+
+    // Trailing line without newline.
+    //
+    assert (td ("a\nb", "a\nb\n") ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -1,2 +1,2 @@\n"
+            " a\n"
+            "-b\n"
+            "\\ No newline at end of file\n"
+            "+b\n");
+
+    assert (td ("a\n", "a") ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -1 +1 @@\n"
+            "-a\n"
+            "+a\n"
+            "\\ No newline at end of file\n");
+
+    // Carriage return stripping.
+    //
+    assert (td ("a\r\nb\n", "a\nb\n", 3, true) == "");
+    assert (td ("a\r\nb\n", "a\nb\r", 3, true) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -1,2 +1,2 @@\n"
+            " a\n"
+            "-b\n"
+            "+b\n"
+            "\\ No newline at end of file\n");
+
+    assert (td ("a\r\nb\n", "a\nb\n") ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -1,2 +1,2 @@\n"
+            "-a\r\n"
+            "+a\n"
+            " b\n");
+
+    // Context before the first difference (retained in the ring buffer).
+    //
+    assert (td (lines (20), lines (20, {10})) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -7,7 +7,7 @@\n"
+            " 7\n"
+            " 8\n"
+            " 9\n"
+            "-10\n"
+            "+x10\n"
+            " 11\n"
+            " 12\n"
+            " 13\n");
+
+    assert (td (lines (20), lines (20, {10}), 0) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -10 +10 @@\n"
+            "-10\n"
+            "+x10\n");
+
+    // Hunk merging: changes separated by no more than twice the context
+    // lines end up in the same hunk.
+    //
+    assert (td (lines (20), lines (20, {5, 11})) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -2,13 +2,13 @@\n"
+            " 2\n"
+            " 3\n"
+            " 4\n"
+            "-5\n"
+            "+x5\n"
+            " 6\n"
+            " 7\n"
+            " 8\n"
+            " 9\n"
+            " 10\n"
+            "-11\n"
+            "+x11\n"
+            " 12\n"
+            " 13\n"
+            " 14\n");
+
+    assert (td (lines (20), lines (20, {5, 12}), 1) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -4,3 +4,3 @@\n"
+            " 4\n"
+            "-5\n"
+            "+x5\n"
+            " 6\n"
+            "@@ -11,3 +11,3 @@\n"
+            " 11\n"
+            "-12\n"
+            "+x12\n"
+            " 13\n");
+
+    // Empty ranges.
+    //
+    assert (td ("", "a\n") ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -0,0 +1 @@\n"
+            "+a\n");
+
+    assert (td ("a\nb\n", "") ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -1,2 +0,0 @@\n"
+            "-a\n"
+            "-b\n");
+
+    assert (td (lines (10), lines (5) + "x\n" + lines (10).substr (10), 0) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -5,0 +6 @@\n"
+            "+x\n");
+
+    assert (td (lines (10), lines (4) + lines (10).substr (10), 0) ==
+            "--- e\n"
+            "+++ a\n"
+            "@@ -5 +4,0 @@\n"
+            "-5\n");
+
+    // Too many differences: fall back to deleting everything (including
+    // the context) and inserting everything.
+    //
+    {
+      vector<size_t> c;
+      for (size_t i (2); i <= 2000; i += 2)
+        c.push_back (i);
+
+      istringstream is (td (lines (2000, {}, "a"), lines (2000, c, "a")));
+      string l;
+
+      assert (getline (is, l) && l == "--- e");
+      assert (getline (is, l) && l == "+++ a");
+      assert (getline (is, l) && l == "@@ -1,2000 +1,2000 @@");
+
+      size_t dn (0), an (0);
+      while (getline (is, l))
+      {
+        if (l[0] == '-')
+        {
+          assert (an == 0);
+          ++dn;
+        }
+        else
+        {
+          assert (l[0] == '+');
+          ++an;
+        }
+      }
+
+      assert (dn == 2000 && an == 2000);
+    }
+
+    return 0;
+  }
+}
+
+int
+main (int argc, char* argv[])
+{
+  return build2::main (argc, argv);
+}
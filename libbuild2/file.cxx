@@ -10,6 +10,7 @@
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
 #include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/prerequisite-key.hxx>
 
@@ -259,6 +260,14 @@ namespace build2
 
     const path_name& fn (l.name ());
 
+    trace_span ts ("load",
+                   [&fn] (string& n, string&)
+                   {
+                     ostringstream os;
+                     os << fn;
+                     n = os.str ();
+                   });
+
     try
     {
       l5 ([&]{trace << "sourcing " << fn;});
@@ -1699,11 +1708,13 @@ namespace build2
       if (verb >= 3)
         print_process (args);
 
-      process pr (pp,
-                  args,
-                  -2           /* stdin  to /dev/null                 */,
-                  -1           /* stdout to pipe                      */,
-                  opt ? -2 : 2 /* stderr to /dev/null or pass-through */);
+      process pr (
+        process_spawn (
+          pp,
+          args,
+          -2           /* stdin  to /dev/null                 */,
+          -1           /* stdout to pipe                      */,
+          opt ? -2 : 2 /* stderr to /dev/null or pass-through */));
 
       try
       {
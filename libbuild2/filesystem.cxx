@@ -3,6 +3,7 @@
 
 #include <libbuild2/filesystem.hxx>
 
+#include <libbuild2/scope.hxx>
 #include <libbuild2/context.hxx>
 #include <libbuild2/diagnostics.hxx>
 
@@ -201,6 +202,61 @@ namespace build2
     }
   }
 
+  bool directory_cache::
+  exists (const dir_path& d, const path& n)
+  {
+    // Don't cache relative directories (their meaning depends on the current
+    // working directory) as well as directories inside the projects being
+    // built (see above).
+    //
+    if (d.empty () || d.relative () || ctx_.scopes.find (d).root_scope ())
+      return entry_exists (d / n, true /* follow_symlinks */);
+
+#ifdef _WIN32
+    string k (lcase (n.string ()));
+#else
+    const string& k (n.string ());
+#endif
+
+    {
+      mlock l (mutex_);
+
+      auto i (dirs_.find (d.string ()));
+      if (i != dirs_.end ())
+        return i->second.find (k) != i->second.end ();
+    }
+
+    // Read the directory without holding the lock. If another thread beats
+    // us to it, then we use its listing (which should be the same).
+    //
+    std::unordered_set<string> es;
+    try
+    {
+      for (const dir_entry& de: dir_iterator (d, false /* ignore_dangling */))
+      {
+#ifdef _WIN32
+        es.insert (lcase (de.path ().string ()));
+#else
+        es.insert (de.path ().string ());
+#endif
+      }
+    }
+    catch (const system_error& e)
+    {
+      if (build2::exists (d))
+        fail << "unable to scan directory " << d << ": " << e;
+
+      es.clear (); // Cache as empty.
+    }
+
+    mlock l (mutex_);
+
+    const std::unordered_set<string>& s (
+      dirs_.emplace (d.string (), move (es)).first->second);
+
+    return s.find (k) != s.end ();
+  }
+
   bool
   empty (const dir_path& d)
   {
@@ -4,6 +4,9 @@
 #ifndef LIBBUILD2_FILESYSTEM_HXX
 #define LIBBUILD2_FILESYSTEM_HXX
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include <libbutl/filesystem.mxx>
 
 #include <libbuild2/types.hxx>
@@ -146,6 +149,52 @@ namespace build2
                 bool follow_symlinks = false,
                 bool ignore_error = false);
 
+  // Directory listing cache.
+  //
+  // Answer filesystem entry existence queries from the cached directory
+  // listing rather than by probing the filesystem. This is used, for
+  // example, when searching for libraries where a single import can result
+  // in a dozen of probes in each library search directory (which can be
+  // expensive on network filesystems).
+  //
+  // The listing of each directory is read on the first query and is kept for
+  // the lifetime of the context. Since the directories inside the projects
+  // being built can change during the build, queries for such directories
+  // are not cached and fall back to probing the filesystem. A non-existent
+  // or non-directory path is cached as an empty directory.
+  //
+  // Note that the result only indicates the presence of the entry and not
+  // its type. Note also that on Windows the names are compared
+  // case-insensitively.
+  //
+  // All the functions are MT-safe.
+  //
+  class LIBBUILD2_SYMEXPORT directory_cache
+  {
+  public:
+    explicit
+    directory_cache (context& c): ctx_ (c) {}
+
+    // Return true if the directory contains an entry with the specified
+    // name (which should be a simple path). Print the diagnostics and fail
+    // on system error.
+    //
+    bool
+    exists (const dir_path&, const path& name);
+
+    bool
+    exists (const path& p) {return exists (p.directory (), p.leaf ());}
+
+    directory_cache (const directory_cache&) = delete;
+    directory_cache& operator= (const directory_cache&) = delete;
+
+  private:
+    context& ctx_;
+
+    mutex mutex_;
+    std::unordered_map<string, std::unordered_set<string>> dirs_;
+  };
+
   // Check for a directory emptiness. Print the diagnostics and fail on system
   // error.
   //
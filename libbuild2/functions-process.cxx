@@ -7,6 +7,8 @@
 #include <libbuild2/function.hxx>
 #include <libbuild2/variable.hxx>
 
+#include <libbuild2/script/builtin.hxx>
+
 using namespace std;
 using namespace butl;
 
@@ -106,7 +108,20 @@ namespace build2
     if (!nm.simple () || nm.pair)
       return nullptr;
 
-    const builtin_info* r (builtins.find (nm.value));
+    // Pass the options so that the external program is executed if some of
+    // them are not supported by the builtin. Note that the non-simple names
+    // cannot be options and so we stop at the first one.
+    //
+    strings as;
+    for (auto i (args.begin () + 1); i != args.end (); ++i)
+    {
+      if (!i->simple () || i->pair)
+        break;
+
+      as.push_back (i->value);
+    }
+
+    const builtin_info* r (script::find_builtin (nm.value, &as));
     return r != nullptr ? r->function : nullptr;
   }
 
@@ -0,0 +1,437 @@
+// file      : libbuild2/history.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/history.hxx>
+
+#include <sstream>
+#include <cstring> // memcmp()
+
+#include <libbuild2/scope.hxx>
+#include <libbuild2/target.hxx>
+#include <libbuild2/context.hxx>
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  // The history file format is binary and starts with the signature and the
+  // format version followed by the entries, each represented as the key
+  // size, the key, and the recipe execution wall and CPU times in
+  // nanoseconds. All the integers are unsigned and are stored in the
+  // little-endian byte order (4 bytes for sizes, 8 bytes for times).
+  //
+  static const char     history_signature[4] = {'b', '2', 'h', 's'};
+  static const uint32_t history_version = 2;
+
+  static const path history_file ("history");
+
+  // The part entry keys are the target keys followed by this separator and
+  // the part name.
+  //
+  static const char part_separator ('\n');
+
+  template <typename T>
+  static bool
+  read_uint (ifdstream& is, T& r)
+  {
+    unsigned char b[sizeof (T)];
+    if (!is.read (reinterpret_cast<char*> (b), sizeof (T)))
+      return false;
+
+    r = 0;
+    for (size_t i (sizeof (T)); i != 0; --i)
+      r = (r << 8) | b[i - 1];
+
+    return true;
+  }
+
+  template <typename T>
+  static void
+  write_uint (ofdstream& os, T v)
+  {
+    unsigned char b[sizeof (T)];
+    for (size_t i (0); i != sizeof (T); ++i, v >>= 8)
+      b[i] = static_cast<unsigned char> (v & 0xFF);
+
+    os.write (reinterpret_cast<const char*> (b), sizeof (T));
+  }
+
+  static inline uint64_t
+  nanoseconds (const duration& d)
+  {
+    return static_cast<uint64_t> (
+      chrono::duration_cast<chrono::nanoseconds> (d).count ());
+  }
+
+  auto execution_history::
+  find_project (action a, const target& t, string& k) -> project*
+  {
+    // Note that only targets in the out tree are tracked.
+    //
+    if (!t.out.empty ())
+      return nullptr;
+
+    const scope* rs (t.base_scope ().root_scope ());
+    if (rs == nullptr)
+      return nullptr;
+
+    const dir_path& out_root (rs->out_path ());
+    if (!t.dir.sub (out_root))
+      return nullptr;
+
+    // Note that the map nodes are stable and so we can keep using the
+    // project after releasing the lock.
+    //
+    project* pp;
+    {
+      slock l (mutex_);
+      auto i (projects_.find (rs));
+      pp = i != projects_.end () ? &i->second : nullptr;
+    }
+
+    if (pp == nullptr)
+    {
+      ulock l (mutex_);
+      pp = &projects_.emplace (piecewise_construct,
+                               forward_as_tuple (rs),
+                               forward_as_tuple ()).first->second;
+    }
+
+    project& p (*pp);
+
+    // Load the history (unless already loaded by another thread) holding
+    // only this project's lock.
+    //
+    if (!p.loaded.load (memory_order_acquire))
+    {
+      mlock l (p.recorded_mutex);
+      if (!p.loaded.load (memory_order_relaxed))
+      {
+        p.file = file (*rs);
+
+        if (!p.file.empty ())
+          load (p);
+
+        p.loaded.store (true, memory_order_release);
+      }
+    }
+
+    if (p.file.empty ())
+      return nullptr;
+
+    // The key is the operation name (with the outer operation name, if any,
+    // in parenthesis) followed by the target type and name relative to
+    // out_root. For example:
+    //
+    // update obj{foo/bar.o}
+    // update(install) exe{hello}
+    //
+    const operation_table& ot (t.ctx.operation_table);
+
+    k = ot[a.operation ()];
+    if (a.outer ())
+    {
+      k += '(';
+      k += ot[a.outer_operation ()];
+      k += ')';
+    }
+    k += ' ';
+    k += t.type ().name;
+    k += '{';
+    k += t.dir.leaf (out_root).representation ();
+    k += t.name;
+    if (const string* e = t.ext ())
+    {
+      if (!e->empty ())
+      {
+        k += '.';
+        k += *e;
+      }
+    }
+    k += '}';
+
+    return &p;
+  }
+
+  path execution_history::
+  file (const scope& rs)
+  {
+    // Skip simple projects as well as those configured in source.
+    //
+    const auto& re (*rs.root_extra);
+
+    if (!re.project || *re.project == nullptr)
+      return path ();
+
+    const dir_path& out_root (rs.out_path ());
+
+    if (out_root == rs.src_path ())
+      return path ();
+
+    return out_root / re.build_dir / history_file;
+  }
+
+  optional<execution_history::entry> execution_history::
+  find (action a, const target& t)
+  {
+    string k;
+    if (project* p = find_project (a, t, k))
+    {
+      auto i (p->entries.find (k));
+      if (i != p->entries.end ())
+        return i->second;
+    }
+
+    return nullopt;
+  }
+
+  duration execution_history::
+  estimate (action a, const target& t)
+  {
+    string k;
+    if (project* p = find_project (a, t, k))
+    {
+      auto i (p->entries.find (k));
+      return i != p->entries.end () ? i->second.wall : p->average;
+    }
+
+    return duration::zero ();
+  }
+
+  void execution_history::
+  record (action a, const target& t, const entry& e)
+  {
+    string k;
+    if (project* p = find_project (a, t, k))
+    {
+      mlock l (p->recorded_mutex);
+      p->recorded[move (k)] = e;
+      p->changed = true;
+    }
+
+    // Note that we keep the statistics for all the targets, tracked or not.
+    //
+    mlock l (stat_mutex_);
+    statistics& s (stat_);
+
+    s.count++;
+    s.wall += e.wall;
+    s.cpu += e.cpu;
+
+    vector<pair<string, entry>>& v (s.slowest);
+
+    if (v.size () < statistics::slowest_count ||
+        e.wall > v.back ().second.wall)
+    {
+      auto i (find_if (v.begin (), v.end (),
+                       [&e] (const pair<string, entry>& x)
+                       {
+                         return e.wall > x.second.wall;
+                       }));
+
+      string d (t.ctx.operation_table[a.operation ()]);
+      d += ' ';
+      {
+        ostringstream os;
+        os << t;
+        d += os.str ();
+      }
+
+      v.emplace (i, move (d), e);
+
+      if (v.size () > statistics::slowest_count)
+        v.pop_back ();
+    }
+  }
+
+  optional<execution_history::entry> execution_history::
+  recorded (action a, const target& t)
+  {
+    string k;
+    if (project* p = find_project (a, t, k))
+    {
+      mlock l (p->recorded_mutex);
+      auto i (p->recorded.find (k));
+      if (i != p->recorded.end ())
+        return i->second;
+    }
+
+    return nullopt;
+  }
+
+  optional<duration> execution_history::
+  find (action a, const target& t, const string& part)
+  {
+    string k;
+    if (project* p = find_project (a, t, k))
+    {
+      k += part_separator;
+      k += part;
+
+      auto i (p->entries.find (k));
+      if (i != p->entries.end ())
+        return i->second.wall;
+    }
+
+    return nullopt;
+  }
+
+  void execution_history::
+  record (action a, const target& t, const string& part, duration w)
+  {
+    string k;
+    if (project* p = find_project (a, t, k))
+    {
+      k += part_separator;
+      k += part;
+
+      mlock l (p->recorded_mutex);
+      p->recorded[move (k)] = entry {w, duration::zero ()};
+      p->changed = true;
+    }
+  }
+
+  auto execution_history::statistics::
+  operator+= (const statistics& x) -> statistics&
+  {
+    count += x.count;
+    wall += x.wall;
+    cpu += x.cpu;
+
+    vector<pair<string, entry>> v;
+    v.reserve (slowest.size () + x.slowest.size ());
+
+    merge (slowest.begin (), slowest.end (),
+           x.slowest.begin (), x.slowest.end (),
+           back_inserter (v),
+           [] (const pair<string, entry>& a, const pair<string, entry>& b)
+           {
+             return a.second.wall > b.second.wall;
+           });
+
+    if (v.size () > slowest_count)
+      v.resize (slowest_count);
+
+    slowest = move (v);
+    return *this;
+  }
+
+  void execution_history::
+  load (project& p)
+  {
+    tracer trace ("execution_history::load");
+
+    if (!exists (p.file))
+      return;
+
+    std::map<string, entry>& es (p.entries);
+    try
+    {
+      ifdstream is (p.file, fdopen_mode::binary, ifdstream::badbit);
+
+      char s[sizeof (history_signature)];
+      uint32_t v;
+
+      if (!is.read (s, sizeof (s))                       ||
+          memcmp (s, history_signature, sizeof (s)) != 0 ||
+          !read_uint (is, v) || v != history_version)
+      {
+        l4 ([&]{trace << "ignoring " << p.file << ": unknown format";});
+        return;
+      }
+
+      for (uint32_t n; read_uint (is, n); )
+      {
+        // Sanity check the key size so that we don't try to allocate
+        // something outrageous for a corrupted file.
+        //
+        string k (n <= 4096 ? n : 0, '\0');
+        uint64_t w, c;
+
+        if (n > 4096            ||
+            !is.read (&k[0], n) ||
+            !read_uint (is, w)  ||
+            !read_uint (is, c))
+        {
+          l4 ([&]{trace << "ignoring " << p.file << ": truncated";});
+          es.clear ();
+          return;
+        }
+
+        es[move (k)] = entry {
+          chrono::duration_cast<duration> (chrono::nanoseconds (w)),
+          chrono::duration_cast<duration> (chrono::nanoseconds (c))};
+      }
+
+      is.close ();
+    }
+    catch (const io_error& e)
+    {
+      l4 ([&]{trace << "ignoring " << p.file << ": " << e;});
+      es.clear ();
+      return;
+    }
+
+    // Note that the part entries are not included.
+    //
+    duration s (duration::zero ());
+    size_t n (0);
+
+    for (const auto& e: es)
+    {
+      if (e.first.find (part_separator) == string::npos)
+      {
+        s += e.second.wall;
+        n++;
+      }
+    }
+
+    if (n != 0)
+      p.average = s / static_cast<duration::rep> (n);
+  }
+
+  void execution_history::
+  save ()
+  {
+    for (auto& pp: projects_)
+    {
+      project& p (pp.second);
+
+      if (!p.changed)
+        continue;
+
+      for (const auto& e: p.recorded)
+        p.entries[e.first] = e.second;
+
+      try
+      {
+        ofdstream os (p.file,
+                      fdopen_mode::out      | fdopen_mode::binary |
+                      fdopen_mode::truncate | fdopen_mode::create);
+
+        os.write (history_signature, sizeof (history_signature));
+        write_uint (os, history_version);
+
+        for (const auto& e: p.entries)
+        {
+          const string& k (e.first);
+
+          write_uint (os, static_cast<uint32_t> (k.size ()));
+          os.write (k.c_str (), k.size ());
+          write_uint (os, nanoseconds (e.second.wall));
+          write_uint (os, nanoseconds (e.second.cpu));
+        }
+
+        os.close ();
+        p.changed = false;
+      }
+      catch (const io_error& e)
+      {
+        warn << "unable to write " << p.file << ": " << e;
+      }
+    }
+  }
+}
@@ -0,0 +1,166 @@
+// file      : libbuild2/history.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_HISTORY_HXX
+#define LIBBUILD2_HISTORY_HXX
+
+#include <map>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/action.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Target execution history.
+  //
+  // Recipe execution times recorded during previous runs which are used to
+  // estimate the cost of executing a target (see target::opstate::weight)
+  // as well as the time remaining until the end of the build (see the
+  // execute() meta-operation callback).
+  //
+  // The history is kept per project and is persisted in the history file in
+  // the project's out_root build/ subdirectory (see file() for details),
+  // which is removed by disfigure. The file is loaded lazily, on the first
+  // lookup or record for the project, and is only written back if something
+  // has changed. Since it is just a cache, any errors reading it are ignored
+  // and errors writing it are reported as warnings.
+  //
+  // The entries loaded from the file are not modified until save() and so,
+  // once a project's history is loaded, the lookups (which are performed
+  // for every target during match) are lock-free. The entries recorded
+  // during this run are kept separately, under a per-project lock, and are
+  // merged into the loaded ones by save().
+  //
+  // Only targets in the project's out tree are tracked and they are
+  // identified by the action's operation names and the target's type and
+  // name relative to out_root.
+  //
+  // All the functions except save() and stat() are MT-safe.
+  //
+  class LIBBUILD2_SYMEXPORT execution_history
+  {
+  public:
+    // Recipe execution wall and CPU times excluding the time spent waiting
+    // for other targets (see scheduler::task_timer). The CPU time includes
+    // that of the child processes (see process_wait()).
+    //
+    struct entry
+    {
+      duration wall;
+      duration cpu;
+    };
+
+    // Statistics of the recipe executions recorded during this run.
+    //
+    struct statistics
+    {
+      size_t   count = 0;
+      duration wall = duration::zero ();
+      duration cpu = duration::zero ();
+
+      // The slowest (in terms of wall time) recorded recipe executions,
+      // slowest first. The description is the operation name followed by
+      // the target.
+      //
+      static const size_t slowest_count = 10;
+      vector<pair<string, entry>> slowest;
+
+      statistics&
+      operator+= (const statistics&);
+    };
+
+    // Return the entry recorded for this target during previous runs or
+    // nullopt if there is none.
+    //
+    optional<entry>
+    find (action, const target&);
+
+    // Return the estimated recipe execution time for this target. If there
+    // is no entry for this target, then return the average of the project's
+    // entries and zero if there are none (or the target is not tracked).
+    // Note that the entries recorded during this run are not considered.
+    //
+    duration
+    estimate (action, const target&);
+
+    // Record the recipe execution of this target replacing the existing
+    // entry, if any.
+    //
+    void
+    record (action, const target&, const entry&);
+
+    // Return the entry recorded for this target during this run or nullopt
+    // if there is none.
+    //
+    optional<entry>
+    recorded (action, const target&);
+
+    // Return (from previous runs) and record the execution time of a part
+    // of the target's recipe identified by name (for example, a testscript
+    // scope id path). Such entries are only persisted and are not included
+    // in the statistics or the project average.
+    //
+    optional<duration>
+    find (action, const target&, const string& part);
+
+    void
+    record (action, const target&, const string& part, duration wall);
+
+    // Return the statistics of this run. Should be called serially.
+    //
+    const statistics&
+    stat () const {return stat_;}
+
+    // Merge the entries recorded during this run into the project histories
+    // and write the changed ones back. Should be called serially, normally
+    // at the end of the execute phase.
+    //
+    void
+    save ();
+
+    // Return the history file path for the project with the specified root
+    // scope or empty path if its history is not tracked. Simple projects as
+    // well as projects configured in source are not tracked since in the
+    // latter case the file would end up in the source directory.
+    //
+    static path
+    file (const scope& root);
+
+  private:
+    struct project
+    {
+      path file;                        // Empty if not tracked.
+      std::map<string, entry> entries;  // Loaded, immutable until save().
+      duration average = duration::zero ();
+      atomic<bool> loaded {false};
+
+      mutex recorded_mutex;             // Protects load, recorded, changed.
+      std::map<string, entry> recorded; // During this run.
+      bool changed = false;
+    };
+
+    // Return the project this target belongs to (loading its history if
+    // necessary) and set the key if the target is tracked. Return NULL
+    // otherwise.
+    //
+    project*
+    find_project (action, const target&, string& key);
+
+    void
+    load (project&);
+
+  private:
+    shared_mutex mutex_; // Protects projects_ (but not their content).
+    std::map<const scope*, project> projects_;
+
+    mutex stat_mutex_;
+    statistics stat_;
+  };
+}
+
+#endif // LIBBUILD2_HISTORY_HXX
@@ -0,0 +1,382 @@
+// file      : libbuild2/jobserver.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/jobserver.hxx>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/stat.h> // mkfifo()
+#endif
+
+#include <cerrno>
+#include <cstring> // strlen()
+
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+#ifndef _WIN32
+  // Open the fifo for non-blocking reading and writing. Return -1 and set
+  // errno on failure.
+  //
+  static int
+  open_fifo (const path& f)
+  {
+    int fd;
+    while ((fd = open (f.string ().c_str (),
+                       O_RDWR | O_NONBLOCK | O_CLOEXEC)) == -1 &&
+           errno == EINTR) ;
+    return fd;
+  }
+#endif
+
+  // The pipe reader state which is shared with the helper thread.
+  //
+  // The thread reads one token at a time when requested by try_acquire()
+  // and keeps it until taken by a subsequent call. Since the thread may be
+  // blocked in read() when the jobserver is destroyed, it is detached and
+  // a token that it reads after that is returned right away.
+  //
+  struct jobserver::reader
+  {
+    int rfd;                // Inherited read end (not owned).
+    int wfd;                // Inherited write end (not owned).
+
+    mutex m;
+    condition_variable cv;
+    bool request = false;   // Token is requested.
+    optional<char> token;   // Token is read but not yet taken.
+    bool stop = false;      // Jobserver is destroyed.
+    bool failed = false;    // Read end is closed or failed.
+
+    reader (int r, int w): rfd (r), wfd (w) {}
+  };
+
+  void jobserver::
+  read_tokens (shared_ptr<reader> p)
+  {
+#ifndef _WIN32
+    reader& r (*p);
+
+    mlock l (r.m);
+    for (;;)
+    {
+      r.cv.wait (l, [&r] {return r.request || r.stop;});
+
+      if (r.stop)
+        break;
+
+      l.unlock ();
+
+      char c;
+      ssize_t n;
+      while ((n = read (r.rfd, &c, 1)) == -1 && errno == EINTR) ;
+
+      l.lock ();
+      r.request = false;
+
+      if (n != 1)
+      {
+        r.failed = true;
+        break;
+      }
+
+      if (r.stop)
+      {
+        while (write (r.wfd, &c, 1) == -1 && errno == EINTR) ;
+        break;
+      }
+
+      r.token = c;
+    }
+#else
+    (void) p;
+#endif
+  }
+
+  unique_ptr<jobserver> jobserver::
+  connect ()
+  {
+#ifndef _WIN32
+    tracer trace ("jobserver::connect");
+
+    optional<string> mf (getenv ("MAKEFLAGS"));
+
+    if (!mf)
+      return nullptr;
+
+    // Extract the jobserver authentication value. The newer --jobserver-auth
+    // takes precedence over the older --jobserver-fds (make may pass both
+    // for compatibility) and if specified multiple times, the last one
+    // wins.
+    //
+    const string& s (*mf);
+    string v;
+    for (const char* o: {"--jobserver-fds=", "--jobserver-auth="})
+    {
+      size_t p (s.rfind (o));
+      if (p != string::npos)
+      {
+        p += strlen (o);
+        size_t e (s.find (' ', p));
+        v.assign (s, p, e == string::npos ? e : e - p);
+      }
+    }
+
+    if (v.empty ())
+      return nullptr;
+
+    unique_ptr<jobserver> r (new jobserver ());
+
+    if (v.compare (0, 5, "fifo:") == 0)
+    {
+      path f (string (v, 5));
+
+      if ((r->rfd_ = open_fifo (f)) == -1)
+      {
+        l4 ([&]{trace << "unable to open jobserver fifo " << f << ": "
+                      << system_error (errno, generic_category ()).what ()
+                      << ", ignoring";});
+        return nullptr;
+      }
+
+      r->wfd_ = r->rfd_;
+    }
+    else
+    {
+      // The R,W form with the file descriptors inherited from make.
+      //
+      int rfd, wfd;
+      {
+        size_t p (v.find (','));
+        try
+        {
+          if (p == string::npos)
+            throw invalid_argument ("missing comma");
+
+          rfd = stoi (string (v, 0, p));
+          wfd = stoi (string (v, p + 1));
+        }
+        catch (const std::exception&)
+        {
+          warn << "invalid jobserver value '" << v << "' in MAKEFLAGS";
+          return nullptr;
+        }
+      }
+
+      // Make only passes the file descriptors to the commands that it
+      // considers recursive (prefixed with + or referencing $(MAKE)).
+      //
+      if (fcntl (rfd, F_GETFD) == -1 || fcntl (wfd, F_GETFD) == -1)
+      {
+        l4 ([&]{trace << "jobserver file descriptors are not inherited, "
+                      << "ignoring (prefix the recipe command with '+' in "
+                      << "the parent makefile)";});
+        return nullptr;
+      }
+
+      r->wfd_ = wfd;
+
+      // We need a non-blocking read end but we cannot make the inherited
+      // one non-blocking since the file description is shared with other
+      // processes. On Linux we re-open the pipe via procfs which creates a
+      // new description. Elsewhere (where /dev/fd/N is equivalent to dup())
+      // we read the inherited one in a helper thread.
+      //
+#ifdef __linux__
+      string pf ("/proc/self/fd/" + to_string (rfd));
+
+      while ((r->rfd_ = open (pf.c_str (),
+                              O_RDONLY | O_NONBLOCK | O_CLOEXEC)) == -1 &&
+             errno == EINTR) ;
+
+      if (r->rfd_ == -1)
+      {
+        l4 ([&]{trace << "unable to reopen jobserver pipe: "
+                      << system_error (errno, generic_category ()).what ()
+                      << ", ignoring";});
+        return nullptr;
+      }
+#else
+      r->reader_ = make_shared<reader> (rfd, wfd);
+
+      try
+      {
+        thread (&read_tokens, r->reader_).detach ();
+      }
+      catch (const system_error& e)
+      {
+        l4 ([&]{trace << "unable to start jobserver reader thread: " << e
+                      << ", ignoring";});
+        return nullptr;
+      }
+#endif
+    }
+
+    return r;
+#else
+    return nullptr;
+#endif
+  }
+
+  unique_ptr<jobserver> jobserver::
+  create (size_t jobs)
+  {
+#ifndef _WIN32
+    assert (jobs != 0);
+
+    unique_ptr<jobserver> r (new jobserver ());
+
+    path f (path::temp_path ("build2-jobserver"));
+
+    if (mkfifo (f.string ().c_str (), 0600) != 0)
+      throw_generic_error (errno);
+
+    r->fifo_ = f; // Remove on destruction from now on.
+
+    if ((r->rfd_ = open_fifo (f)) == -1)
+      throw_generic_error (errno);
+
+    r->wfd_ = r->rfd_;
+
+    // Fill the pool keeping the implicit token.
+    //
+    for (string t (jobs - 1, '+'); !t.empty (); )
+    {
+      ssize_t n (write (r->wfd_, t.data (), t.size ()));
+
+      if (n == -1)
+      {
+        if (errno == EINTR)
+          continue;
+
+        throw_generic_error (errno);
+      }
+
+      t.erase (0, static_cast<size_t> (n));
+    }
+
+    // Export to the child processes.
+    //
+    string mf;
+    if (optional<string> v = getenv ("MAKEFLAGS"))
+      mf = move (*v);
+
+    mf += " -j";
+    mf += to_string (jobs);
+    mf += " --jobserver-auth=fifo:";
+    mf += f.string ();
+
+    setenv ("MAKEFLAGS", mf);
+
+    return r;
+#else
+    throw_generic_error (ENOTSUP);
+#endif
+  }
+
+  bool jobserver::
+  try_acquire ()
+  {
+#ifndef _WIN32
+    mlock l (mutex_);
+
+    if (reader_ != nullptr)
+    {
+      reader& r (*reader_);
+      mlock rl (r.m);
+
+      if (r.token)
+      {
+        tokens_ += *r.token;
+        r.token = nullopt;
+        return true;
+      }
+
+      if (!r.request && !r.failed)
+      {
+        r.request = true;
+        r.cv.notify_one ();
+      }
+
+      return false;
+    }
+
+    for (char c;;)
+    {
+      ssize_t n (read (rfd_, &c, 1));
+
+      if (n == 1)
+      {
+        tokens_ += c;
+        return true;
+      }
+
+      if (n == -1 && errno == EINTR)
+        continue;
+
+      return false; // EAGAIN, EOF, or error.
+    }
+#else
+    return false;
+#endif
+  }
+
+  void jobserver::
+  release ()
+  {
+#ifndef _WIN32
+    mlock l (mutex_);
+
+    assert (!tokens_.empty ());
+
+    char c (tokens_.back ());
+    tokens_.pop_back ();
+
+    // Note that there is not much we can do if this fails other than lose
+    // the token.
+    //
+    while (write (wfd_, &c, 1) == -1 && errno == EINTR) ;
+#endif
+  }
+
+  jobserver::
+  ~jobserver ()
+  {
+#ifndef _WIN32
+    // Return any tokens that are still held.
+    //
+    while (!tokens_.empty ())
+      release ();
+
+    // Stop the reader thread returning the token that it has read, if any.
+    //
+    if (reader_ != nullptr)
+    {
+      reader& r (*reader_);
+      mlock l (r.m);
+
+      if (r.token)
+      {
+        char c (*r.token);
+        while (write (wfd_, &c, 1) == -1 && errno == EINTR) ;
+        r.token = nullopt;
+      }
+
+      r.stop = true;
+      r.cv.notify_one ();
+    }
+
+    if (rfd_ != -1)
+      close (rfd_);
+
+    if (!fifo_.empty ())
+      try_rmfile (fifo_, true /* ignore_error */);
+#endif
+  }
+}
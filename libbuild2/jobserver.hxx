@@ -0,0 +1,96 @@
+// file      : libbuild2/jobserver.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_JOBSERVER_HXX
+#define LIBBUILD2_JOBSERVER_HXX
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // GNU make jobserver.
+  //
+  // The jobserver is a pool of tokens shared between cooperating processes
+  // that limits their combined parallelism: in order to run an additional
+  // job a process has to acquire a token (by reading a byte from a pipe or
+  // fifo) and return it (by writing the same byte back) when done. Every
+  // process also has one implicit token for its first job.
+  //
+  // We can act as a client of a jobserver advertised in MAKEFLAGS (for
+  // example, if invoked from make or from another b) and as a server of
+  // our own fifo-based jobserver that we export to child processes via
+  // MAKEFLAGS (for example, for GCC's -flto=jobserver or nested make in
+  // foreign projects). In both cases the scheduler acquires tokens for its
+  // active threads beyond the first (see scheduler::use_jobserver()).
+  //
+  // Only the fifo (make 4.4 and later) and the pipe file descriptor styles
+  // are supported and only on POSIX. The functions are MT-safe except for
+  // the construction and destruction.
+  //
+  class LIBBUILD2_SYMEXPORT jobserver
+  {
+  public:
+    // Connect to the jobserver advertised in the MAKEFLAGS environment
+    // variable. Return NULL if there is none or if it cannot be used (for
+    // example, because make did not pass the pipe file descriptors to a
+    // command that it does not consider recursive). Note that the latter
+    // case is common and so it is only traced at verbosity level 4.
+    //
+    static unique_ptr<jobserver>
+    connect ();
+
+    // Create a fifo-based jobserver with jobs - 1 tokens and export it via
+    // the MAKEFLAGS environment variable of this process (and thus to all
+    // the child processes). Throw system_error on failure.
+    //
+    static unique_ptr<jobserver>
+    create (size_t jobs);
+
+    // Acquire a token without blocking returning false if none are
+    // available.
+    //
+    bool
+    try_acquire ();
+
+    // Return a previously acquired token.
+    //
+    void
+    release ();
+
+    // Return true if we are the server.
+    //
+    bool
+    server () const {return !fifo_.empty ();}
+
+    ~jobserver ();
+
+    jobserver (const jobserver&) = delete;
+    jobserver& operator= (const jobserver&) = delete;
+
+  private:
+    jobserver () = default;
+
+  private:
+    int rfd_ = -1;         // Non-blocking read end (owned).
+    int wfd_ = -1;         // Write end (same as rfd_ for fifo).
+    path fifo_;            // Our fifo, if we are the server.
+
+    mutex mutex_;
+    string tokens_;        // Acquired tokens (returned in the LIFO order).
+
+    // Except on Linux there is no way to obtain a non-blocking read end of
+    // the pipe inherited from make and so we read it (blocking) in a helper
+    // thread (see jobserver.cxx for details).
+    //
+    struct reader;
+    shared_ptr<reader> reader_;
+
+    static void
+    read_tokens (shared_ptr<reader>);
+  };
+}
+
+#endif // LIBBUILD2_JOBSERVER_HXX
@@ -9,6 +9,7 @@
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
+#include <libbuild2/history.hxx>
 #include <libbuild2/variable.hxx>
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/diagnostics.hxx>
@@ -254,6 +255,28 @@ namespace build2
     assert (ctx.phase == run_phase::load);
   }
 
+  // Format the time in milliseconds for the progress line, for example,
+  // 1h05m, 2m07s, or 12s.
+  //
+  static string
+  progress_time (size_t ms)
+  {
+    size_t s ((ms + 999) / 1000);
+
+    auto two = [] (size_t v)
+    {
+      return (v < 10 ? "0" : "") + to_string (v);
+    };
+
+    if (s >= 3600)
+      return to_string (s / 3600) + 'h' + two (s % 3600 / 60) + 'm';
+
+    if (s >= 60)
+      return to_string (s / 60) + 'm' + two (s % 60) + 's';
+
+    return to_string (s) + 's';
+  }
+
   void
   execute (const values&, action a, action_targets& ts,
            uint16_t diag, bool prog)
@@ -299,6 +322,13 @@ namespace build2
         size_t init (ctx.target_count.load (memory_order_relaxed));
         size_t incr (init > 100 ? init / 100 : 1); // 1%.
 
+        // If we have the execution history, then also show the estimated
+        // time remaining. We assume the remaining recipes will be spread
+        // evenly among the active threads, which is optimistic but should
+        // be in the right ballpark for all but the tail of the build.
+        //
+        size_t est (ctx.target_estimate.load (memory_order_relaxed));
+
         if (init != incr)
         {
           what = "% of targets " + diag_did (ctx, a);
@@ -306,7 +336,7 @@ namespace build2
           mg = ctx.sched.monitor (
             ctx.target_count,
             init - incr,
-            [init, incr, &what, &ctx] (size_t c) -> size_t
+            [init, incr, est, &what, &ctx] (size_t c) -> size_t
             {
               size_t p ((init - c) * 100 / init);
               size_t s (ctx.skip_count.load (memory_order_relaxed));
@@ -316,6 +346,18 @@ namespace build2
               diag_progress += to_string (p);
               diag_progress += what;
 
+              if (est != 0)
+              {
+                size_t e (ctx.target_estimate.load (memory_order_relaxed));
+
+                if (e <= est) // Sanity check.
+                {
+                  diag_progress += ", ";
+                  diag_progress += progress_time (e / ctx.sched.max_active ());
+                  diag_progress += " left";
+                }
+              }
+
               if (s != 0)
               {
                 diag_progress += " (";
@@ -329,15 +371,33 @@ namespace build2
       }
 
       // Similar logic to execute_members(): first start asynchronous
-      // execution of all the top-level targets.
+      // execution of all the top-level targets, heaviest first unless the
+      // execution mode is 'last' (see target::opstate::weight).
       //
       {
+        vector<size_t> o;
+        if (ctx.current_mode == execution_mode::first &&
+            !ctx.sched.serial ()                      &&
+            ts.size () > 1)
+        {
+          o.reserve (ts.size ());
+          for (size_t i (0); i != ts.size (); ++i)
+            o.push_back (i);
+
+          stable_sort (o.begin (), o.end (),
+                       [a, &ts] (size_t x, size_t y)
+                       {
+                         return (ts[x].as<target> ()[a].weight >
+                                 ts[y].as<target> ()[a].weight);
+                       });
+        }
+
         atomic_count task_count (0);
         wait_guard wg (ctx, task_count);
 
-        for (const action_target& at: ts)
+        for (size_t i (0); i != ts.size (); ++i)
         {
-          const target& t (at.as<target> ());
+          const target& t (ts[o.empty () ? i : o[i]].as<target> ());
 
           l5 ([&]{trace << diag_doing (a, t);});
 
@@ -356,6 +416,10 @@ namespace build2
       // We are now running serially.
       //
 
+      // Save the recipe execution times recorded during this run.
+      //
+      ctx.history.save ();
+
       // Clear the dry-run flag.
       //
       ctx.dry_run = false;
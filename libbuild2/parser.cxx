@@ -17,6 +17,7 @@
 #include <libbuild2/function.hxx>
 #include <libbuild2/variable.hxx>
 #include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 #include <libbuild2/prerequisite.hxx>
 
@@ -1890,6 +1891,14 @@ namespace build2
 
     l5 ([&]{trace (loc) << "entering " << in;});
 
+    trace_span ts ("load",
+                   [&in] (string& n, string&)
+                   {
+                     ostringstream os;
+                     os << in;
+                     n = os.str ();
+                   });
+
     if (in.path != nullptr)
       enter_buildfile (*in.path);
 
@@ -11,6 +11,7 @@
 #endif
 
 #ifndef _WIN32
+#  include <time.h> // clock_gettime()
 #  include <thread> // this_thread::sleep_for()
 #else
 #  include <libbutl/win32-utility.hxx>
@@ -20,6 +21,8 @@
 
 #include <cerrno>
 
+#include <libbuild2/jobserver.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 using namespace std;
@@ -50,6 +53,108 @@ namespace build2
     scheduler_queue = q;
   }
 
+  // TLS total times spent in nested regions as well as the CPU time of the
+  // child processes (see task_timer).
+  //
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  duration::rep scheduler_nested_wall = 0;
+
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  duration::rep scheduler_nested_cpu = 0;
+
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  duration::rep scheduler_child_cpu = 0;
+
+  // Return the CPU time of the calling thread plus that of the child
+  // processes attributed to it.
+  //
+  static duration
+  thread_cpu () noexcept
+  {
+    duration r (scheduler_child_cpu);
+
+#ifndef _WIN32
+    timespec ts;
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+      r += chrono::duration_cast<duration> (
+        chrono::seconds (ts.tv_sec) + chrono::nanoseconds (ts.tv_nsec));
+#else
+    FILETIME c, e, k, u;
+    if (GetThreadTimes (GetCurrentThread (), &c, &e, &k, &u))
+    {
+      auto ft = [] (const FILETIME& t) // In 100ns units.
+      {
+        return (static_cast<uint64_t> (t.dwHighDateTime) << 32) |
+          t.dwLowDateTime;
+      };
+
+      r += chrono::duration_cast<duration> (
+        chrono::nanoseconds ((ft (k) + ft (u)) * 100));
+    }
+#endif
+
+    return r;
+  }
+
+  scheduler::task_timer::
+  task_timer ()
+      : nested_wall_ (scheduler_nested_wall),
+        nested_cpu_ (scheduler_nested_cpu),
+        start_wall_ (chrono::steady_clock::now ()),
+        start_cpu_ (thread_cpu ())
+  {
+  }
+
+  scheduler::task_timer::
+  ~task_timer ()
+  {
+    // Override rather than add to the nested times accumulated during our
+    // lifetime since they are already included in ours.
+    //
+    scheduler_nested_wall =
+      nested_wall_ +
+      chrono::duration_cast<duration> (
+        chrono::steady_clock::now () - start_wall_).count ();
+
+    scheduler_nested_cpu =
+      nested_cpu_ + (thread_cpu () - start_cpu_).count ();
+  }
+
+  auto scheduler::task_timer::
+  elapsed () const -> times
+  {
+    duration w (chrono::duration_cast<duration> (
+                  chrono::steady_clock::now () - start_wall_));
+    duration c (thread_cpu () - start_cpu_);
+
+    w -= duration (scheduler_nested_wall - nested_wall_);
+    c -= duration (scheduler_nested_cpu - nested_cpu_);
+
+    return times {w < duration::zero () ? duration::zero () : w,
+                  c < duration::zero () ? duration::zero () : c};
+  }
+
+  void scheduler::task_timer::
+  add_child_cpu (duration d) noexcept
+  {
+    scheduler_child_cpu += d.count ();
+  }
+
   size_t scheduler::
   wait (size_t start_count, const atomic_count& task_count, work_queue wq)
   {
@@ -62,6 +167,12 @@ namespace build2
 
     assert (max_active_ != 1); // Serial execution, nobody to wait for.
 
+    // Exclude the time spent waiting from the time of the task that is
+    // waiting (see task_timer for details).
+    //
+    task_timer tt;
+    trace_span ts ("scheduler", [] (string& n, string&) {n = "wait";});
+
     // See if we can run some of our own tasks.
     //
     if (wq != work_none)
@@ -103,6 +214,7 @@ namespace build2
     lock l (mutex_);
 
     active_--;
+    release_tokens ();
     waiting_++;
     if (external)
       external_++;
@@ -153,8 +265,19 @@ namespace build2
     ready_++;
     progress_.fetch_add (1, memory_order_relaxed);
 
-    while (!shutdown_ && active_ >= max_active_)
-      ready_condv_.wait (l);
+    for (;;)
+    {
+      while (!shutdown_ && active_ + reserved_ >= max_active_)
+        ready_condv_.wait (l);
+
+      if (shutdown_ || acquire_token ())
+        break;
+
+      // No jobserver tokens are available. Since there is no way to get
+      // notified when one is returned, poll.
+      //
+      ready_condv_.wait_for (l, chrono::milliseconds (20));
+    }
 
     ready_--;
     active_++;
@@ -185,6 +308,118 @@ namespace build2
 #endif
   }
 
+  size_t scheduler::
+  allocate (size_t n)
+  {
+    if (max_active_ == 1) // Serial execution.
+      return 0;
+
+    if ((n = min (n, max_active_ - 1)) == 0)
+      return 0;
+
+    // Only one allocation can be in progress at a time since otherwise
+    // threads holding partial allocations could end up waiting for each
+    // other. Note that we wait for our turn deactivated for the same reason.
+    //
+    unique_lock<std::mutex> al (alloc_mutex_, defer_lock);
+    if (!al.try_lock ())
+    {
+      deactivate (false /* external */);
+      al.lock ();
+      activate (false /* external */);
+    }
+
+    lock l (mutex_);
+
+    // Make other threads stand aside while we are collecting the slots (see
+    // activate(), helper(), and async()).
+    //
+    reserved_ = n;
+
+    size_t r (0);
+    while (r != n && !shutdown_)
+    {
+      if (active_ < max_active_ && acquire_token ())
+      {
+        active_++;
+        reserved_--;
+        r++;
+        continue;
+      }
+
+      // There is no notification when a thread becomes inactive (or when a
+      // jobserver token is returned) so poll.
+      //
+      l.unlock ();
+      active_sleep (chrono::milliseconds (10));
+      l.lock ();
+    }
+
+    reserved_ = 0;
+
+    if (shutdown_)
+    {
+      active_ -= r;
+      release_tokens ();
+      throw_generic_error (ECANCELED);
+    }
+
+    return r;
+  }
+
+  size_t scheduler::
+  try_allocate (size_t n)
+  {
+    if (max_active_ == 1) // Serial execution.
+      return 0;
+
+    if ((n = min (n, max_active_ - 1)) == 0)
+      return 0;
+
+    // Don't interfere with an allocation in progress (see allocate()).
+    //
+    unique_lock<std::mutex> al (alloc_mutex_, try_to_lock);
+    if (!al.owns_lock ())
+      return 0;
+
+    lock l (mutex_);
+
+    size_t r (0);
+    for (; r != n && !shutdown_; ++r)
+    {
+      if (active_ == max_active_ || !acquire_token ())
+        break;
+
+      active_++;
+    }
+
+    return r;
+  }
+
+  void scheduler::
+  deallocate (size_t n)
+  {
+    if (n == 0)
+      return;
+
+    lock l (mutex_);
+
+    active_ -= n;
+    release_tokens ();
+    progress_.fetch_add (1, memory_order_relaxed);
+
+    // Spare active threads have become available (similar to deactivate()).
+    //
+    if (ready_ != 0)
+      ready_condv_.notify_all ();
+
+    for (size_t i (0);
+         i != n &&
+           queued_task_count_.load (std::memory_order_consume) != 0 &&
+           activate_helper (l);
+         ++i) ;
+  }
+
   size_t scheduler::
   suspend (size_t start_count, const atomic_count& task_count)
   {
@@ -192,6 +427,8 @@ namespace build2
       wait_queue_[
         hash<const atomic_count*> () (&task_count) % wait_queue_size_]);
 
+    trace_span ts ("scheduler", [] (string& n, string&) {n = "suspend";});
+
     // This thread is no longer active.
     //
     deactivate (false /* external */);
@@ -242,6 +479,9 @@ namespace build2
     if (max_active_ == 1) // Serial execution, nobody to wakeup.
       return;
 
+    if (trace_file* tf = trace_sink)
+      tf->instant ("scheduler", "resume", string ());
+
     wait_slot& s (
       wait_queue_[hash<const atomic_count*> () (&tc) % wait_queue_size_]);
 
@@ -396,6 +636,40 @@ namespace build2
       dead_thread_ = thread (deadlock_monitor, this);
   }
 
+  void scheduler::
+  use_jobserver (jobserver& js)
+  {
+    lock l (mutex_);
+
+    assert (!shutdown_ && init_active_ == 1 && jobserver_ == nullptr);
+    jobserver_ = &js;
+  }
+
+  bool scheduler::
+  acquire_token ()
+  {
+    // Note that the first active thread uses the implicit token.
+    //
+    if (jobserver_ == nullptr || active_ == 0 || tokens_ >= active_)
+      return true;
+
+    if (!jobserver_->try_acquire ())
+      return false;
+
+    tokens_++;
+    return true;
+  }
+
+  void scheduler::
+  release_tokens ()
+  {
+    if (jobserver_ != nullptr)
+    {
+      for (size_t n (active_ != 0 ? active_ - 1 : 0); tokens_ > n; tokens_--)
+        jobserver_->release ();
+    }
+  }
+
   size_t scheduler::
   tune (size_t max_active)
   {
@@ -488,6 +762,16 @@ namespace build2
 
       assert (external_ == 0);
 
+      // Return the jobserver tokens, if any, and stop using it.
+      //
+      if (jobserver_ != nullptr)
+      {
+        for (; tokens_ != 0; tokens_--)
+          jobserver_->release ();
+
+        jobserver_ = nullptr;
+      }
+
       // Wait for the deadlock monitor (the only remaining thread).
       //
       if (orig_max_active_ != 1) // See tune() for why not max_active_.
@@ -749,7 +1033,7 @@ namespace build2
       // If there is a spare active thread, become active and go looking for
       // some work.
       //
-      if (s.active_ < s.max_active_)
+      if (s.active_ + s.reserved_ < s.max_active_ && s.acquire_token ())
       {
         s.active_++;
 
@@ -780,6 +1064,7 @@ namespace build2
         }
 
         s.active_--;
+        s.release_tokens ();
 
         // While executing the tasks a thread might have become ready
         // (equivalent logic to deactivate()).
@@ -790,10 +1075,16 @@ namespace build2
           s.dead_condv_.notify_one ();
       }
 
-      // Become idle and wait for a notification.
+      // Become idle and wait for a notification. If we could not become
+      // active because of the lack of jobserver tokens, then poll (see
+      // activate() for details).
       //
       s.idle_++;
-      s.idle_condv_.wait (l);
+      if (s.jobserver_ != nullptr &&
+          s.queued_task_count_.load (memory_order_consume) != 0)
+        s.idle_condv_.wait_for (l, chrono::milliseconds (20));
+      else
+        s.idle_condv_.wait (l);
       s.idle_--;
     }
 
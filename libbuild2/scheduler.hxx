@@ -18,6 +18,8 @@
 
 namespace build2
 {
+  class jobserver;
+
   // Scheduler of tasks and threads. Works best for "substantial" tasks (e.g.,
   // running a process), where in comparison thread synchronization overhead
   // is negligible.
@@ -72,6 +74,12 @@ namespace build2
     // Return true if the task was queued and false if it was executed
     // synchronously.
     //
+    // Note that helpers pick up the queued tasks in the order they were
+    // queued. As a result, queuing the tasks that are expected to take longer
+    // (or to lead to more work) first gives them a head start (this is how
+    // the execution priority is implemented; see execute_prerequisites() for
+    // an example).
+    //
     // If the scheduler is shutdown, throw system_error(ECANCELED).
     //
     template <typename F, typename... A>
@@ -159,6 +167,106 @@ namespace build2
     static void
     active_sleep (const duration&);
 
+    // Allocate additional active thread slots to the calling active thread,
+    // for example, to run an external program that uses multiple threads
+    // itself and should not share the CPU with other jobs. Wait until the
+    // requested number of slots (but no more than max_active() - 1) becomes
+    // available and return the number allocated, which should later be
+    // returned with deallocate(). Note that while holding the allocation the
+    // thread should not wait for other tasks.
+    //
+    size_t
+    allocate (size_t);
+
+    void
+    deallocate (size_t);
+
+    // Similar to allocate() but don't wait: allocate as many of the
+    // requested slots as are currently available (which can be none). This
+    // can be used to give an external program its share of the job budget,
+    // for example, all of it if this is the only thing left to do.
+    //
+    size_t
+    try_allocate (size_t);
+
+    // RAII allocation, for example:
+    //
+    // scheduler::alloc_guard ag (ctx.sched, ctx.sched.max_active () - 1);
+    // run (...);
+    // ag.deallocate ();
+    //
+    struct alloc_guard
+    {
+      size_t n;
+
+      alloc_guard (scheduler& s, size_t m): n (s.allocate (m)), s_ (s) {}
+      ~alloc_guard () {deallocate ();}
+
+      void
+      deallocate ()
+      {
+        if (n != 0)
+        {
+          s_.deallocate (n);
+          n = 0;
+        }
+      }
+
+      alloc_guard (const alloc_guard&) = delete;
+      alloc_guard& operator= (const alloc_guard&) = delete;
+
+    private:
+      scheduler& s_;
+    };
+
+    // Measure the time a task took by itself, that is, excluding the time
+    // spent waiting for other tasks and executing them synchronously.
+    //
+    // To achieve this each thread keeps track of the total time spent in
+    // such nested regions. A wait() call that actually had to wait is such a
+    // region automatically while others are marked by the task_timer
+    // instances themselves. Note that the time of regions nested in other
+    // nested regions is not counted twice.
+    //
+    // Besides the wall time the task's CPU time is measured the same way.
+    // This is the CPU time of the thread itself plus that of the child
+    // processes it has waited for and attributed with add_child_cpu() (the
+    // OS only accounts the child CPU time per process, not per thread).
+    //
+    class LIBBUILD2_SYMEXPORT task_timer
+    {
+    public:
+      task_timer ();
+      ~task_timer ();
+
+      struct times
+      {
+        duration wall;
+        duration cpu;
+      };
+
+      // Return the times elapsed since construction minus the times spent
+      // in the nested regions.
+      //
+      times
+      elapsed () const;
+
+      // Attribute the CPU time of a child process to the calling thread.
+      //
+      static void
+      add_child_cpu (duration) noexcept;
+
+      task_timer (const task_timer&) = delete;
+      task_timer& operator= (const task_timer&) = delete;
+
+    private:
+      duration::rep nested_wall_; // Thread's nested times at construction.
+      duration::rep nested_cpu_;
+
+      std::chrono::steady_clock::time_point start_wall_;
+      duration start_cpu_;
+    };
+
     // Startup and shutdown.
     //
   public:
@@ -255,6 +363,28 @@ namespace build2
     bool
     serial () const {return max_active_ == 1;}
 
+    // Return the maximum number of active threads.
+    //
+    // Note: can only be called from threads that have observed startup.
+    //
+    size_t
+    max_active () const {return max_active_;}
+
+    // Additionally limit the active threads beyond the first (which uses the
+    // implicit token) by the jobserver tokens (see jobserver for details).
+    // Should be called after startup() but before any tasks are scheduled
+    // and the jobserver should not be destroyed before shutdown().
+    //
+    void
+    use_jobserver (jobserver&);
+
+    // Return true if the active threads are limited by the jobserver (see
+    // above), in which case its tokens are shared with the child processes
+    // that support the jobserver protocol.
+    //
+    bool
+    jobserver_active () const {return jobserver_ != nullptr;}
+
     // Wait for all the helper threads to terminate. Throw system_error on
     // failure. Note that the initially active threads are not waited for.
     // Return scheduling statistics.
@@ -468,6 +598,30 @@ namespace build2
     //
     size_t external_ = 0;
 
+    // Jobserver, if any, and the number of its tokens held. We maintain
+    // the tokens held to be active_ - 1 (see acquire/release_tokens()).
+    //
+    jobserver* jobserver_ = nullptr;
+    size_t     tokens_ = 0;
+
+    // Number of active thread slots that are being collected by allocate()
+    // and that other threads should therefore not take. Only one allocation
+    // can be in progress at a time (see allocate() for details).
+    //
+    size_t     reserved_ = 0;
+    std::mutex alloc_mutex_;
+
+    // Acquire a token for a thread about to become active, if necessary,
+    // returning false if none are available. Release the tokens that are no
+    // longer necessary after a thread has become inactive. Both should be
+    // called while holding the lock.
+    //
+    bool
+    acquire_token ();
+
+    void
+    release_tokens ();
+
     // Original values (as specified during startup) that can be altered via
     // tuning.
     //
@@ -110,7 +110,7 @@ namespace build2
     {
       lock l (mutex_);
 
-      if (active_ < max_active_)
+      if (active_ + reserved_ < max_active_)
         activate_helper (l);
     }
 
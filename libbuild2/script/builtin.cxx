@@ -0,0 +1,1422 @@
+// file      : libbuild2/script/builtin.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/script/builtin.hxx>
+
+#include <deque>
+#include <regex>
+#include <cctype>     // isspace(), tolower()
+#include <cstring>    // memcpy(), strcspn(), strncmp()
+#include <streambuf>
+#include <iterator>   // istreambuf_iterator
+#include <algorithm>  // sort(), unique(), lower_bound()
+#include <functional> // greater
+
+#include <libbutl/fdstream.mxx>
+
+#include <libbuild2/diff.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  namespace script
+  {
+    // builtin_channel
+    //
+    // The data is kept in a ring buffer.
+    //
+    class builtin_channel
+    {
+    public:
+      explicit
+      builtin_channel (size_t c): buf_ (c) {}
+
+      // Block while the channel is full. Discard the data if the read end is
+      // closed.
+      //
+      void
+      write (const char* s, size_t n)
+      {
+        mlock l (mutex_);
+
+        for (size_t c (buf_.size ()); n != 0; )
+        {
+          cv_.wait (l, [this, c] {return size_ != c || rclosed_;});
+
+          if (rclosed_)
+            break;
+
+          size_t t ((head_ + size_) % c);
+          size_t m (min (n, c - size_));
+          size_t m1 (min (m, c - t));
+
+          memcpy (buf_.data () + t, s, m1);
+          memcpy (buf_.data (), s + m1, m - m1);
+
+          size_ += m;
+          s += m;
+          n -= m;
+
+          cv_.notify_all ();
+        }
+      }
+
+      // Block while the channel is empty. Return 0 if there is no more data.
+      //
+      size_t
+      read (char* s, size_t n)
+      {
+        mlock l (mutex_);
+        cv_.wait (l, [this] {return size_ != 0 || wclosed_;});
+
+        size_t c (buf_.size ());
+        size_t m (min (n, size_));
+        size_t m1 (min (m, c - head_));
+
+        memcpy (s, buf_.data () + head_, m1);
+        memcpy (s + m1, buf_.data (), m - m1);
+
+        head_ = (head_ + m) % c;
+        size_ -= m;
+
+        cv_.notify_all ();
+        return m;
+      }
+
+      void
+      close (bool w)
+      {
+        mlock l (mutex_);
+
+        if (w)
+          wclosed_ = true;
+        else
+        {
+          rclosed_ = true;
+          size_ = 0;
+        }
+
+        cv_.notify_all ();
+      }
+
+    private:
+      mutex mutex_;
+      condition_variable cv_;
+
+      vector<char> buf_;
+      size_t head_ = 0;
+      size_t size_ = 0;
+      bool wclosed_ = false;
+      bool rclosed_ = false;
+    };
+
+    builtin_channel_end& builtin_channel_end::
+    operator= (builtin_channel_end&& e)
+    {
+      if (this != &e)
+      {
+        close ();
+        channel_ = move (e.channel_);
+        write_ = e.write_;
+      }
+
+      return *this;
+    }
+
+    void builtin_channel_end::
+    close ()
+    {
+      if (channel_ != nullptr)
+      {
+        channel_->close (write_);
+        channel_.reset ();
+      }
+    }
+
+    builtin_channel_pipe
+    open_builtin_channel (size_t c)
+    {
+      shared_ptr<builtin_channel> p (make_shared<builtin_channel> (c));
+      return builtin_channel_pipe {builtin_channel_end (p, false),
+                                   builtin_channel_end (p, true)};
+    }
+
+    namespace
+    {
+      // Stream buffers reading/writing the channel end.
+      //
+      class channel_ibuf: public streambuf
+      {
+      public:
+        explicit
+        channel_ibuf (builtin_channel_end&& e): end_ (move (e)) {}
+
+        void
+        close () {end_.close ();}
+
+      protected:
+        virtual int_type
+        underflow () override
+        {
+          size_t n (end_ ? end_.get ()->read (buf_, sizeof (buf_)) : 0);
+
+          if (n == 0)
+            return traits_type::eof ();
+
+          setg (buf_, buf_, buf_ + n);
+          return traits_type::to_int_type (*buf_);
+        }
+
+      private:
+        builtin_channel_end end_;
+        char buf_[8192];
+      };
+
+      class channel_obuf: public streambuf
+      {
+      public:
+        explicit
+        channel_obuf (builtin_channel_end&& e)
+            : end_ (move (e))
+        {
+          setp (buf_, buf_ + sizeof (buf_));
+        }
+
+        ~channel_obuf () override {close ();}
+
+        void
+        close ()
+        {
+          if (end_)
+          {
+            sync ();
+            end_.close ();
+          }
+        }
+
+      protected:
+        virtual int_type
+        overflow (int_type c) override
+        {
+          sync ();
+
+          if (c != traits_type::eof ())
+          {
+            *pptr () = traits_type::to_char_type (c);
+            pbump (1);
+          }
+
+          return traits_type::not_eof (c);
+        }
+
+        virtual int
+        sync () override
+        {
+          size_t n (pptr () - pbase ());
+
+          if (n != 0 && end_)
+            end_.get ()->write (pbase (), n);
+
+          setp (buf_, buf_ + sizeof (buf_));
+          return 0;
+        }
+
+      private:
+        builtin_channel_end end_;
+        char buf_[8192];
+      };
+    }
+
+    namespace
+    {
+      // Builtin failure. The diagnostics has already been issued.
+      //
+      struct builtin_failed {};
+
+      // Builtin execution environment.
+      //
+      struct builtin_env
+      {
+        const char*          name;
+        auto_fd&             in;   // Only opened as a stream on demand.
+        builtin_channel_end& ich;  // Used instead of in if not empty.
+        ostream&             cout;
+        ostream&             cerr;
+        const dir_path&      cwd;
+
+        // Start the diagnostics line. The caller is expected to finish it
+        // with endl and throw builtin_failed.
+        //
+        ostream&
+        error () {return cerr << name << ": ";}
+      };
+
+      using builtin_impl = uint8_t (const strings&, builtin_env&);
+    }
+
+    // Return true if the argument at the specified position is an option,
+    // skipping the '--' separator, if present.
+    //
+    static bool
+    option (const strings& args, size_t& i)
+    {
+      if (i == args.size ())
+        return false;
+
+      const string& a (args[i]);
+
+      if (a == "--")
+      {
+        ++i;
+        return false;
+      }
+
+      return a.size () > 1 && a[0] == '-';
+    }
+
+    [[noreturn]] static void
+    unknown_option (builtin_env& e, const string& o)
+    {
+      e.error () << "unknown option '" << o << "'" << endl;
+      throw builtin_failed ();
+    }
+
+    // Return the value of the option at the specified position which can
+    // either be specified as the next argument (-n 10) or be attached to the
+    // option (-n10).
+    //
+    static const string&
+    option_value (const strings& args, size_t& i, string& s, builtin_env& e)
+    {
+      const string& o (args[i]);
+
+      if (o.size () > 2)
+      {
+        s.assign (o, 2, string::npos);
+        return s;
+      }
+
+      if (++i == args.size ())
+      {
+        e.error () << "missing value for option '" << o << "'" << endl;
+        throw builtin_failed ();
+      }
+
+      return args[i];
+    }
+
+    static size_t
+    parse_number (const string& v, const string& o, builtin_env& e)
+    {
+      if (!v.empty () && v.find_first_not_of ("0123456789") == string::npos)
+      try
+      {
+        return static_cast<size_t> (stoull (v));
+      }
+      catch (const std::exception&) {} // Fall through.
+
+      e.error () << "invalid value '" << v << "' for option '"
+                 << o.substr (0, 2) << "'" << endl;
+      throw builtin_failed ();
+    }
+
+    // Input file stream. Read stdin if the file name is '-' skipping the
+    // remaining input on close so that the writer doesn't fail if we don't
+    // read everything (think head).
+    //
+    static auto_fd
+    open_input (const string& f, builtin_env& e)
+    {
+      if (f == "-")
+      {
+        if (e.in == nullfd)
+        {
+          e.error () << "stdin is already read" << endl;
+          throw builtin_failed ();
+        }
+
+        return move (e.in);
+      }
+
+      path p (f);
+      if (p.relative ())
+        p = e.cwd / p;
+
+      try
+      {
+        return fdopen (p, fdopen_mode::in);
+      }
+      catch (const io_error& x)
+      {
+        e.error () << "unable to open '" << f << "': " << x << endl;
+        throw builtin_failed ();
+      }
+    }
+
+    namespace
+    {
+      // Note that stdin can also be the channel read end.
+      //
+      class input: public istream
+      {
+      public:
+        input (const string& f, builtin_env& e)
+            : istream (nullptr)
+        {
+          if (f == "-" && e.ich)
+          {
+            cbuf_.reset (new channel_ibuf (move (e.ich)));
+            rdbuf (cbuf_.get ());
+          }
+          else
+          {
+            fs_.reset (
+              new ifdstream (open_input (f, e),
+                             f == "-"
+                             ? fdstream_mode::skip
+                             : fdstream_mode::none,
+                             ifdstream::badbit));
+            rdbuf (fs_->rdbuf ());
+          }
+
+          exceptions (badbit);
+        }
+
+        void
+        close ()
+        {
+          if (fs_ != nullptr)
+            fs_->close ();
+          else
+            cbuf_->close ();
+        }
+
+      private:
+        unique_ptr<ifdstream>    fs_;
+        unique_ptr<channel_ibuf> cbuf_;
+      };
+    }
+
+    // Return the file names or '-' (stdin) if none are specified.
+    //
+    static strings
+    input_files (const strings& args, size_t i)
+    {
+      return i != args.size ()
+        ? strings (args.begin () + i, args.end ())
+        : strings ({"-"});
+    }
+
+    // Read the next line returning false if there are no more lines. Set nl
+    // to false if the line is not terminated with a newline.
+    //
+    static bool
+    read_line (istream& is, string& l, bool& nl)
+    {
+      // Note that we cannot peek once eof is set since that sets failbit.
+      //
+      if (is.eof () || is.peek () == istream::traits_type::eof ())
+        return false;
+
+      getline (is, l);
+      nl = !is.eof ();
+      return true;
+    }
+
+    // cmp [-s] <file1> <file2>
+    //
+    static uint8_t
+    cmp (const strings& args, builtin_env& e)
+    {
+      bool silent (false);
+
+      size_t i (0);
+      for (; option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        if (o == "-s")
+          silent = true;
+        else
+          unknown_option (e, o);
+      }
+
+      if (args.size () - i != 2)
+      {
+        e.error () << "two files expected" << endl;
+        throw builtin_failed ();
+      }
+
+      const string& f1 (args[i]);
+      const string& f2 (args[i + 1]);
+
+      input is1 (f1, e);
+      input is2 (f2, e);
+
+      using traits = istream::traits_type;
+
+      streambuf& b1 (*is1.rdbuf ());
+      streambuf& b2 (*is2.rdbuf ());
+
+      uint8_t r (0);
+      uint64_t byte (1), line (1);
+
+      for (;; ++byte)
+      {
+        traits::int_type c1 (b1.sbumpc ());
+        traits::int_type c2 (b2.sbumpc ());
+
+        if (c1 == c2)
+        {
+          if (c1 == traits::eof ())
+            break;
+
+          if (c1 == '\n')
+            ++line;
+
+          continue;
+        }
+
+        r = 1;
+
+        if (!silent)
+        {
+          if (c1 == traits::eof () || c2 == traits::eof ())
+            e.error () << "EOF on " << (c1 == traits::eof () ? f1 : f2)
+                       << " after byte " << byte - 1 << ", line " << line
+                       << endl;
+          else
+            e.cout << f1 << ' ' << f2 << " differ: byte " << byte
+                   << ", line " << line << endl;
+        }
+
+        break;
+      }
+
+      is1.close ();
+      is2.close ();
+
+      return r;
+    }
+
+    // diff -u|-U <num> [--strip-trailing-cr] <file1> <file2>
+    //
+    static uint8_t
+    diff (const strings& args, builtin_env& e)
+    {
+      size_t ctx (3);
+      bool strip_cr (false);
+
+      size_t i (0);
+      string s;
+      for (; option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        if (o == "-u")
+          ctx = 3;
+        else if (o.compare (0, 2, "-U") == 0)
+          ctx = parse_number (option_value (args, i, s, e), o, e);
+        else if (o == "--strip-trailing-cr")
+          strip_cr = true;
+        else
+          unknown_option (e, o);
+      }
+
+      if (args.size () - i != 2)
+      {
+        e.error () << "two files expected" << endl;
+        throw builtin_failed ();
+      }
+
+      const string& f1 (args[i]);
+      const string& f2 (args[i + 1]);
+
+      input is1 (f1, e);
+      input is2 (f2, e);
+
+      bool r (diff_text (is1, is2, strip_cr, &e.cout, f1, f2, ctx));
+
+      is1.close ();
+      is2.close ();
+
+      return r ? 0 : 1;
+    }
+
+    // Translate the basic regular expression into the ECMAScript one.
+    //
+    // Besides the POSIX BRE syntax, recognize the GNU extensions that are
+    // commonly used with grep: the \| alternation, the \+ and \? repetitions,
+    // the \< and \> word boundaries, and the \w, \W, \s, \S, \b, and \B
+    // escape sequences. Throw regex_error if the bracket expression is not
+    // terminated.
+    //
+    static string
+    basic_to_ecma (const string& p)
+    {
+      string r;
+
+      // True if we are at the beginning of the (sub-)expression, where * is
+      // literal and ^ is an anchor.
+      //
+      bool start (true);
+
+      for (size_t i (0), n (p.size ()); i != n; ++i)
+      {
+        char c (p[i]);
+
+        bool s (start);
+        start = false;
+
+        switch (c)
+        {
+        case '\\':
+          {
+            if (i + 1 == n)
+            {
+              r += "\\\\";
+              break;
+            }
+
+            c = p[++i];
+
+            switch (c)
+            {
+            case '(':
+            case '|':
+              {
+                r += c;
+                start = true;
+                break;
+              }
+            case ')':
+            case '{':
+            case '}':
+              {
+                r += c;
+                break;
+              }
+            case '+':
+            case '?':
+              {
+                // Literal at the beginning of the (sub-)expression.
+                //
+                if (s)
+                  r += '\\';
+
+                r += c;
+                break;
+              }
+            case '<': r += "\\b(?=\\w)"; break;
+            case '>': r += "\\b(?!\\w)"; break;
+            case 'w':
+            case 'W':
+            case 's':
+            case 'S':
+            case 'b':
+            case 'B':
+              {
+                r += '\\';
+                r += c;
+                break;
+              }
+            default:
+              {
+                // Back-reference or an escaped character. Note that the
+                // escaped alpha-numeric character has a special meaning in
+                // ECMAScript.
+                //
+                if ((c >= '1' && c <= '9') || !alnum (c))
+                  r += '\\';
+
+                r += c;
+                break;
+              }
+            }
+
+            break;
+          }
+        case '[':
+          {
+            // Copy the bracket expression escaping the characters which are
+            // special inside it in ECMAScript but not in POSIX.
+            //
+            size_t j (i + 1);
+
+            r += '[';
+
+            if (j != n && p[j] == '^')
+              r += p[j++];
+
+            if (j != n && p[j] == ']')
+            {
+              r += "\\]";
+              ++j;
+            }
+
+            for (; j != n && p[j] != ']'; ++j)
+            {
+              char b (p[j]);
+
+              // Character class, equivalence class, or collating symbol.
+              //
+              if (b == '[' && j + 1 != n &&
+                  (p[j + 1] == ':' || p[j + 1] == '=' || p[j + 1] == '.'))
+              {
+                size_t e (p.find (string {p[j + 1], ']'}, j + 2));
+
+                if (e == string::npos)
+                  throw regex_error (regex_constants::error_brack);
+
+                r.append (p, j, e + 2 - j);
+                j = e + 1;
+                continue;
+              }
+
+              if (b == '\\' || b == '[')
+                r += '\\';
+
+              r += b;
+            }
+
+            if (j == n)
+              throw regex_error (regex_constants::error_brack);
+
+            r += ']';
+            i = j;
+            break;
+          }
+        case '*':
+          {
+            if (s)
+              r += '\\';
+
+            r += c;
+            break;
+          }
+        case '^':
+          {
+            if (s)
+              start = true;
+            else
+              r += '\\';
+
+            r += c;
+            break;
+          }
+        case '$':
+          {
+            // Anchor at the end of the (sub-)expression.
+            //
+            if (!(i + 1 == n ||
+                  (p[i + 1] == '\\' && i + 2 != n &&
+                   (p[i + 2] == ')' || p[i + 2] == '|'))))
+              r += '\\';
+
+            r += c;
+            break;
+          }
+        case '+':
+        case '?':
+        case '(':
+        case ')':
+        case '{':
+        case '}':
+        case ']':
+        case '|':
+          {
+            r += '\\';
+            r += c;
+            break;
+          }
+        default:
+          {
+            r += c;
+            break;
+          }
+        }
+      }
+
+      return r;
+    }
+
+    // grep [-v] [-c] [-q] [-i] [-x] [-n] [-E|-F] [-e <pattern>]...
+    //      [<pattern>] [<file>...]
+    //
+    static uint8_t
+    grep (const strings& args, builtin_env& e)
+    {
+      bool invert (false), count (false), quiet (false), icase (false),
+        line_match (false), line_numbers (false), extended (false),
+        fixed (false);
+
+      strings ps;
+
+      size_t i (0);
+      string s;
+      for (; option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        if      (o == "-v") invert = true;
+        else if (o == "-c") count = true;
+        else if (o == "-q") quiet = true;
+        else if (o == "-i") icase = true;
+        else if (o == "-x") line_match = true;
+        else if (o == "-n") line_numbers = true;
+        else if (o == "-E") {extended = true; fixed = false;}
+        else if (o == "-F") {fixed = true; extended = false;}
+        else if (o.compare (0, 2, "-e") == 0)
+          ps.push_back (option_value (args, i, s, e));
+        else
+          unknown_option (e, o);
+      }
+
+      if (ps.empty ())
+      {
+        if (i == args.size ())
+        {
+          e.error () << "missing pattern" << endl;
+          throw builtin_failed ();
+        }
+
+        ps.push_back (args[i++]);
+      }
+
+      auto lower = [] (string s)
+      {
+        for (char& c: s)
+          c = static_cast<char> (tolower (static_cast<unsigned char> (c)));
+        return s;
+      };
+
+      vector<regex> rs;
+
+      if (fixed)
+      {
+        if (icase)
+        {
+          for (string& p: ps)
+            p = lower (move (p));
+        }
+      }
+      else
+      {
+        // Note that std::regex only supports the strict POSIX basic regular
+        // expressions and so we translate them into ECMAScript instead (see
+        // basic_to_ecma() for details).
+        //
+        regex::flag_type f (extended ? regex::extended : regex::ECMAScript);
+
+        if (icase)
+          f |= regex::icase;
+
+        for (const string& p: ps)
+        try
+        {
+          if (extended)
+            rs.emplace_back (p, f);
+          else
+            rs.emplace_back (basic_to_ecma (p), f);
+        }
+        catch (const regex_error& x)
+        {
+          e.error () << "invalid regex '" << p << "': " << x << endl;
+          throw builtin_failed ();
+        }
+      }
+
+      auto match = [&ps, &rs, fixed, icase, line_match, &lower]
+                   (const string& l)
+      {
+        if (fixed)
+        {
+          string t;
+          const string& s (icase ? (t = lower (l)) : l);
+
+          for (const string& p: ps)
+          {
+            if (line_match ? s == p : s.find (p) != string::npos)
+              return true;
+          }
+        }
+        else
+        {
+          for (const regex& r: rs)
+          {
+            if (line_match ? regex_match (l, r) : regex_search (l, r))
+              return true;
+          }
+        }
+
+        return false;
+      };
+
+      strings fs (input_files (args, i));
+      bool names (fs.size () > 1);
+
+      bool selected (false);
+
+      for (const string& f: fs)
+      {
+        input is (f, e);
+
+        size_t n (0);
+        string l;
+        bool nl;
+        for (uint64_t ln (1); read_line (is, l, nl); ++ln)
+        {
+          if (match (l) == invert)
+            continue;
+
+          selected = true;
+
+          if (quiet)
+            break;
+
+          if (count)
+          {
+            ++n;
+            continue;
+          }
+
+          if (names)
+            e.cout << f << ':';
+
+          if (line_numbers)
+            e.cout << ln << ':';
+
+          e.cout << l << '\n';
+        }
+
+        is.close ();
+
+        if (quiet && selected)
+          break;
+
+        if (count)
+        {
+          if (names)
+            e.cout << f << ':';
+
+          e.cout << n << '\n';
+        }
+      }
+
+      return selected ? 0 : 1;
+    }
+
+    // head [-n <num>] [<file>...]
+    // tail [-n <num>] [<file>...]
+    //
+    static uint8_t
+    head_tail (const strings& args, builtin_env& e, bool head)
+    {
+      size_t n (10);
+
+      size_t i (0);
+      string s;
+      for (; option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        if (o.compare (0, 2, "-n") == 0)
+          n = parse_number (option_value (args, i, s, e), o, e);
+        else
+          unknown_option (e, o);
+      }
+
+      strings fs (input_files (args, i));
+      bool headers (fs.size () > 1);
+
+      for (size_t j (0); j != fs.size (); ++j)
+      {
+        const string& f (fs[j]);
+
+        if (headers)
+          e.cout << (j != 0 ? "\n" : "") << "==> "
+                 << (f == "-" ? "standard input" : f.c_str ()) << " <==\n";
+
+        input is (f, e);
+
+        string l;
+        bool nl;
+
+        if (head)
+        {
+          for (size_t k (0); k != n && read_line (is, l, nl); ++k)
+          {
+            e.cout << l;
+
+            if (nl)
+              e.cout << '\n';
+          }
+        }
+        else if (n != 0)
+        {
+          deque<pair<string, bool>> ls;
+
+          while (read_line (is, l, nl))
+          {
+            if (ls.size () == n)
+              ls.pop_front ();
+
+            ls.emplace_back (move (l), nl);
+          }
+
+          for (const pair<string, bool>& p: ls)
+          {
+            e.cout << p.first;
+
+            if (p.second)
+              e.cout << '\n';
+          }
+        }
+
+        is.close ();
+      }
+
+      return 0;
+    }
+
+    static uint8_t
+    head (const strings& args, builtin_env& e)
+    {
+      return head_tail (args, e, true);
+    }
+
+    static uint8_t
+    tail (const strings& args, builtin_env& e)
+    {
+      return head_tail (args, e, false);
+    }
+
+    // sort [-r] [-u] [<file>...]
+    //
+    static uint8_t
+    sort (const strings& args, builtin_env& e)
+    {
+      bool reverse (false), unique (false);
+
+      size_t i (0);
+      for (; option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        if      (o == "-r") reverse = true;
+        else if (o == "-u") unique = true;
+        else                unknown_option (e, o);
+      }
+
+      strings ls;
+
+      for (const string& f: input_files (args, i))
+      {
+        input is (f, e);
+
+        string l;
+        bool nl;
+        while (read_line (is, l, nl))
+          ls.push_back (move (l));
+
+        is.close ();
+      }
+
+      // Note that strings are compared byte-wise, as in the C locale.
+      //
+      if (reverse)
+        std::sort (ls.begin (), ls.end (), greater<string> ());
+      else
+        std::sort (ls.begin (), ls.end ());
+
+      if (unique)
+        ls.erase (std::unique (ls.begin (), ls.end ()), ls.end ());
+
+      for (const string& l: ls)
+        e.cout << l << '\n';
+
+      return 0;
+    }
+
+    // wc [-l] [-w] [-c] [<file>...]
+    //
+    static uint8_t
+    wc (const strings& args, builtin_env& e)
+    {
+      bool lines (false), words (false), bytes (false);
+
+      size_t i (0);
+      for (; option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        if      (o == "-l") lines = true;
+        else if (o == "-w") words = true;
+        else if (o == "-c") bytes = true;
+        else                unknown_option (e, o);
+      }
+
+      if (!lines && !words && !bytes)
+        lines = words = bytes = true;
+
+      bool names (i != args.size ());
+      strings fs (input_files (args, i));
+
+      auto print = [&e, lines, words, bytes, names]
+                   (uint64_t l, uint64_t w, uint64_t c, const string& n)
+      {
+        const char* s ("");
+
+        if (lines) {e.cout << s << l; s = " ";}
+        if (words) {e.cout << s << w; s = " ";}
+        if (bytes) {e.cout << s << c;}
+
+        if (names)
+          e.cout << ' ' << n;
+
+        e.cout << '\n';
+      };
+
+      uint64_t tl (0), tw (0), tc (0);
+
+      for (const string& f: fs)
+      {
+        input is (f, e);
+
+        uint64_t l (0), w (0), c (0);
+        bool space (true);
+
+        for (istreambuf_iterator<char> j (is), ej; j != ej; ++j)
+        {
+          char ch (*j);
+
+          ++c;
+
+          if (ch == '\n')
+            ++l;
+
+          if (isspace (static_cast<unsigned char> (ch)))
+            space = true;
+          else if (space)
+          {
+            space = false;
+            ++w;
+          }
+        }
+
+        is.close ();
+
+        print (l, w, c, f);
+
+        tl += l;
+        tw += w;
+        tc += c;
+      }
+
+      if (fs.size () > 1)
+        print (tl, tw, tc, "total");
+
+      return 0;
+    }
+
+    namespace
+    {
+      struct builtin_impl_info
+      {
+        const char*   name;
+        builtin_impl* function;
+        uint8_t       error;    // Exit status on error.
+
+        // Space-separated list of the supported options. The option that
+        // requires a value is followed by '='.
+        //
+        const char*   options;
+
+        // Space-separated list of options one of which must be specified for
+        // the implementation to be used or NULL if there is no such
+        // requirement. For example, our diff only produces the unified
+        // format and so shouldn't be used in place of the system utility
+        // that would produce the normal format.
+        //
+        const char*   required;
+      };
+    }
+
+    // Note: sorted by name and in sync with infos below.
+    //
+    static const builtin_impl_info impls[] = {
+      {"cmp",  &cmp,  2, "-s",                           nullptr},
+      {"diff", &diff, 2, "-u -U= --strip-trailing-cr",   "-u -U"},
+      {"grep", &grep, 2, "-v -c -q -i -x -n -E -F -e=",  nullptr},
+      {"head", &head, 1, "-n=",                          nullptr},
+      {"sort", &sort, 1, "-r -u",                        nullptr},
+      {"tail", &tail, 1, "-n=",                          nullptr},
+      {"wc",   &wc,   1, "-l -w -c",                     nullptr}};
+
+    // Return true if the builtin implementation supports all the options
+    // in the argument list and the required option, if any, is specified.
+    //
+    static bool
+    supported (const builtin_impl_info& ii, const strings& args)
+    {
+      // Return true if the option name is in the space-separated list.
+      //
+      auto listed = [] (const char* l, const char* o, size_t n)
+      {
+        for (const char* b (l); *b != '\0'; )
+        {
+          const char* e (b + strcspn (b, " "));
+
+          if (static_cast<size_t> (e - b) == n && strncmp (b, o, n) == 0)
+            return true;
+
+          b = *e == ' ' ? e + 1 : e;
+        }
+
+        return false;
+      };
+
+      bool q (ii.required == nullptr);
+
+      for (size_t i (0); option (args, i); ++i)
+      {
+        const string& o (args[i]);
+
+        bool r (false);
+        for (const char* b (ii.options); *b != '\0'; )
+        {
+          const char* e (b + strcspn (b, " "));
+
+          bool v (e[-1] == '=');
+          size_t n (e - b - (v ? 1 : 0));
+
+          // Note that the value can only be attached to a short option.
+          //
+          if (o.compare (0, n, b, n) == 0 &&
+              (o.size () == n || (v && n == 2)))
+          {
+            if (v && o.size () == n)
+              ++i; // Skip the value.
+
+            if (!q)
+              q = listed (ii.required, b, n);
+
+            r = true;
+            break;
+          }
+
+          b = *e == ' ' ? e + 1 : e;
+        }
+
+        if (!r)
+          return false;
+      }
+
+      return q;
+    }
+
+    // Run the builtin implementation returning its exit status. Note that
+    // it is normally executed in a separate thread and so cannot throw.
+    //
+    static uint8_t
+    run_impl (const builtin_impl_info& ii,
+              const strings& args,
+              auto_fd in, builtin_channel_end ich,
+              auto_fd out, builtin_channel_end och,
+              auto_fd err,
+              const dir_path& cwd) noexcept
+    {
+      try
+      {
+        ofdstream cerr (err != nullfd ? move (err) : fddup (stderr_fd ()));
+
+        uint8_t r (ii.error);
+
+        try
+        {
+          // Write stdout either to the file descriptor or to the channel.
+          //
+          bool oc (och);
+          channel_obuf ob (move (och));
+
+          ofdstream fcout;
+          ostream ccout (&ob);
+
+          if (!oc)
+            fcout.open (out != nullfd ? move (out) : fddup (stdout_fd ()));
+
+          ostream& cout (oc ? ccout : fcout);
+
+          builtin_env e {ii.name, in, ich, cout, cerr, cwd};
+          r = ii.function (args, e);
+
+          if (oc)
+          {
+            cout.flush ();
+            ob.close ();
+          }
+          else
+            fcout.close ();
+        }
+        catch (const builtin_failed&)
+        {
+          r = ii.error;
+        }
+        catch (const invalid_path& e)
+        {
+          cerr << ii.name << ": invalid path '" << e.path << "'" << endl;
+          r = ii.error;
+        }
+        catch (const io_error& e)
+        {
+          cerr << ii.name << ": " << e << endl;
+          r = ii.error;
+        }
+        catch (const system_error& e)
+        {
+          cerr << ii.name << ": " << e << endl;
+          r = ii.error;
+        }
+
+        cerr.close ();
+        return r;
+      }
+      catch (const std::exception&)
+      {
+        return ii.error;
+      }
+    }
+
+    // Execute the builtin asynchronously, in a separate thread, similar to
+    // the libbutl builtins that read/write the standard streams.
+    //
+    static builtin
+    start_impl (const builtin_impl_info& ii,
+                uint8_t& r,
+                const strings& args,
+                auto_fd in, builtin_channel_end ich,
+                auto_fd out, builtin_channel_end och,
+                auto_fd err,
+                const dir_path& cwd)
+    {
+      return builtin (
+        r,
+        unique_ptr<builtin::async_state> (
+          new builtin::async_state (
+            [&ii,
+             &r,
+             &args,
+             in  = move (in),
+             ich = move (ich),
+             out = move (out),
+             och = move (och),
+             err = move (err),
+             &cwd] () mutable noexcept
+            {
+              r = run_impl (ii,
+                            args,
+                            move (in), move (ich),
+                            move (out), move (och),
+                            move (err),
+                            cwd);
+            })));
+    }
+
+    template <size_t i>
+    static builtin
+    async_impl (uint8_t& r,
+                const strings& args,
+                auto_fd in, auto_fd out, auto_fd err,
+                const dir_path& cwd,
+                const builtin_callbacks&)
+    {
+      return start_impl (impls[i],
+                         r,
+                         args,
+                         move (in), builtin_channel_end (),
+                         move (out), builtin_channel_end (),
+                         move (err),
+                         cwd);
+    }
+
+    static const builtin_info infos[] = {
+      {&async_impl<0>, 2},
+      {&async_impl<1>, 2},
+      {&async_impl<2>, 2},
+      {&async_impl<3>, 1},
+      {&async_impl<4>, 1},
+      {&async_impl<5>, 1},
+      {&async_impl<6>, 1}};
+
+    static_assert (sizeof (impls) / sizeof (*impls) ==
+                   sizeof (infos) / sizeof (*infos),
+                   "builtin tables out of sync");
+
+    // Return our builtin implementation or NULL if not found.
+    //
+    static const builtin_impl_info*
+    find_impl (const string& n)
+    {
+      const builtin_impl_info* b (begin (impls));
+      const builtin_impl_info* e (end (impls));
+
+      const builtin_impl_info* i (
+        lower_bound (b, e,
+                     n,
+                     [] (const builtin_impl_info& x, const string& n)
+                     {
+                       return n.compare (x.name) > 0;
+                     }));
+
+      return i != e && n == i->name ? i : nullptr;
+    }
+
+    const builtin_info*
+    find_builtin (const string& n, const strings* args)
+    {
+      if (const builtin_info* r = builtins.find (n))
+        return r;
+
+      const builtin_impl_info* i (find_impl (n));
+
+      return i != nullptr && (args == nullptr || supported (*i, *args))
+        ? &infos[i - begin (impls)]
+        : nullptr;
+    }
+
+    bool
+    channel_builtin (const string& n, const strings& args)
+    {
+      // Note that libbutl builtins take precedence (see find_builtin()).
+      //
+      if (builtins.find (n) != nullptr)
+        return false;
+
+      const builtin_impl_info* i (find_impl (n));
+      return i != nullptr && supported (*i, args);
+    }
+
+    builtin
+    start_builtin (const string& n,
+                   uint8_t& r,
+                   const strings& args,
+                   auto_fd in, builtin_channel_end ich,
+                   auto_fd out, builtin_channel_end och,
+                   auto_fd err,
+                   const dir_path& cwd)
+    {
+      const builtin_impl_info* ii (find_impl (n));
+      assert (ii != nullptr);
+
+      return start_impl (*ii,
+                         r,
+                         args,
+                         move (in), move (ich),
+                         move (out), move (och),
+                         move (err),
+                         cwd);
+    }
+  }
+}
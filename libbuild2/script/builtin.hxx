@@ -0,0 +1,110 @@
+// file      : libbuild2/script/builtin.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_SCRIPT_BUILTIN_HXX
+#define LIBBUILD2_SCRIPT_BUILTIN_HXX
+
+#include <libbutl/builtin.mxx>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  namespace script
+  {
+    // Find the script builtin by the program name returning NULL if there
+    // is no such builtin.
+    //
+    // Besides the libbutl builtins (cat, cp, sed, etc), the text utilities
+    // that are commonly used in scripts (cmp, diff, grep, head, sort, tail,
+    // and wc) are implemented here, in-process, in order to avoid spawning
+    // a process for each invocation. Similar to the libbutl builtins, they
+    // only implement the commonly used subset of the corresponding
+    // utilities (see the Testscript manual for details).
+    //
+    // If the arguments are specified, then also return NULL if some of the
+    // options are not supported by the builtin implemented here (grep -o,
+    // sort -k, etc) so that the external program is executed instead.
+    //
+    // Note that the program name is expected to be as specified in the
+    // script and so a name prefixed with ^ (which requests the external
+    // program) is never found.
+    //
+    LIBBUILD2_SYMEXPORT const butl::builtin_info*
+    find_builtin (const string& name, const strings* args = nullptr);
+
+    // In-memory bounded byte channel that can connect stdout of one builtin
+    // implemented here to stdin of another instead of the OS pipe. This way
+    // the data does not go through the kernel and the threads executing the
+    // builtins only need to synchronize when the channel becomes full or
+    // empty rather than on every pipe buffer worth of data.
+    //
+    class builtin_channel;
+
+    // The channel end. Closing (or destroying) the write end signals the end
+    // of data to the reader while closing the read end makes the writer
+    // discard the rest of its output (similar to fdstream_mode::skip).
+    //
+    class LIBBUILD2_SYMEXPORT builtin_channel_end
+    {
+    public:
+      builtin_channel_end () = default;
+      builtin_channel_end (shared_ptr<builtin_channel> c, bool w)
+          : channel_ (move (c)), write_ (w) {}
+
+      builtin_channel_end (builtin_channel_end&&) = default;
+      builtin_channel_end& operator= (builtin_channel_end&&);
+
+      ~builtin_channel_end () {close ();}
+
+      void
+      close ();
+
+      builtin_channel*
+      get () const {return channel_.get ();}
+
+      explicit operator bool () const {return channel_ != nullptr;}
+
+    private:
+      shared_ptr<builtin_channel> channel_;
+      bool write_ = false;
+    };
+
+    struct builtin_channel_pipe
+    {
+      builtin_channel_end in;
+      builtin_channel_end out;
+    };
+
+    // Open the channel that can buffer up to the specified number of bytes.
+    //
+    LIBBUILD2_SYMEXPORT builtin_channel_pipe
+    open_builtin_channel (size_t capacity);
+
+    // Return true if this is a builtin implemented here that supports the
+    // specified arguments and that therefore can be connected with the
+    // channel (see start_builtin() below).
+    //
+    LIBBUILD2_SYMEXPORT bool
+    channel_builtin (const string& name, const strings& args);
+
+    // Start the builtin implemented here (see channel_builtin() above) in a
+    // separate thread. If the stdin (stdout) channel end is not empty, then
+    // read (write) it rather than the corresponding file descriptor (which
+    // should be nullfd in this case).
+    //
+    LIBBUILD2_SYMEXPORT butl::builtin
+    start_builtin (const string& name,
+                   uint8_t& result,
+                   const strings& args,
+                   auto_fd in, builtin_channel_end ich,
+                   auto_fd out, builtin_channel_end och,
+                   auto_fd err,
+                   const dir_path& cwd);
+  }
+}
+
+#endif // LIBBUILD2_SCRIPT_BUILTIN_HXX
@@ -1991,7 +1991,8 @@ namespace build2
                 const function<exec_cmd_function>& exec_cmd,
                 const function<exec_if_function>& exec_if,
                 size_t& li,
-                variable_pool* var_pool)
+                variable_pool* var_pool,
+                optional<bool> single)
     {
       try
       {
@@ -2038,18 +2039,23 @@ namespace build2
             }
           case line_type::cmd:
             {
-              bool single (false);
+              bool s (false);
 
               if (li == 1)
               {
-                lines::const_iterator j (i);
-                for (++j; j != e && j->type == line_type::var; ++j) ;
+                if (single)
+                  s = *single;
+                else
+                {
+                  lines::const_iterator j (i);
+                  for (++j; j != e && j->type == line_type::var; ++j) ;
 
-                if (j == e) // We have no another command.
-                  single = true;
+                  if (j == e) // We have no another command.
+                    s = true;
+                }
               }
 
-              exec_cmd (t, tt, li++, single, ll);
+              exec_cmd (t, tt, li++, s, ll);
 
               replay_stop ();
               break;
@@ -2152,7 +2158,8 @@ namespace build2
                 if (!exec_lines (i + 1, j,
                                  exec_set, exec_cmd, exec_if,
                                  li,
-                                 var_pool))
+                                 var_pool,
+                                 single))
                   return false;
 
                 i = j->type == line_type::cmd_end ? j : next (j, true, true);
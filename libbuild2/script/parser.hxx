@@ -163,13 +163,19 @@ namespace build2
       // execution phase and so the variable pool must be provided. Note that
       // in this case the variable pool insertions are not MT-safe.
       //
+      // If the single flag is specified, then it indicates whether the
+      // script contains a single command, which is passed to exec_cmd() for
+      // the first command line. Otherwise, it is deduced from the lines
+      // range, which should then represent the whole script.
+      //
       bool
       exec_lines (lines::const_iterator b, lines::const_iterator e,
                   const function<exec_set_function>&,
                   const function<exec_cmd_function>&,
                   const function<exec_if_function>&,
                   size_t& li,
-                  variable_pool* = nullptr);
+                  variable_pool* = nullptr,
+                  optional<bool> single = nullopt);
 
       // Customization hooks.
       //
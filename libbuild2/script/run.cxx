@@ -3,7 +3,12 @@
 
 #include <libbuild2/script/run.hxx>
 
-#include <ios> // streamsize
+#ifdef __linux__
+#  include <fcntl.h> // fcntl(), F_SETPIPE_SZ
+#endif
+
+#include <ios>     // streamsize
+#include <sstream>
 
 #include <libbutl/regex.mxx>
 #include <libbutl/builtin.mxx>
@@ -11,10 +16,13 @@
 #include <libbutl/filesystem.mxx>   // path_search()
 #include <libbutl/path-pattern.mxx>
 
+#include <libbuild2/diff.hxx>
 #include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 #include <libbuild2/script/regex.hxx>
+#include <libbuild2/script/builtin.hxx>
 #include <libbuild2/script/builtin-options.hxx>
 
 using namespace std;
@@ -296,30 +304,113 @@ namespace build2
                (rd.type == redirect_type::file &&
                 rd.file.mode == redirect_fmode::compare))
       {
-        // The expected output is provided as a file or as a string. Save the
-        // string to a file in the later case.
+        // The expected output is provided as a file or as a string. In the
+        // later case the string is saved to a file if we need to spawn the
+        // diff utility or for troubleshooting on mismatch.
         //
         assert (!op.empty ());
 
         path eop;
+        string eos;
 
         if (rd.type == redirect_type::file)
           eop = normalize (rd.file.path, *env.work_dir.path, ll);
         else
         {
           eop = path (op + ".orig");
+          eos = transform (rd.str, false /* regex */, rd.modifiers (), env);
+        }
+
+        auto save_expected = [&eop, &eos, &rd, &ll, &env] ()
+        {
+          if (rd.type != redirect_type::file)
+          {
+            save (eop, eos, ll);
+            env.clean_special (eop);
+          }
+        };
+
+        // Unless the external diff utility is requested, compare in-process
+        // since there can be a large number of such comparisons and spawning
+        // a process for each is expensive. Note that in the common case of
+        // the output matching we don't need to write any files.
+        //
+        if (env.diff_utility == nullptr)
+        {
+          // Similar to the -L options below.
+          //
+          auto label = [&env] (const path& p)
+          {
+            return avail_on_failure (p, env)
+                   ? p.string ()
+                   : p.leaf ().string ();
+          };
+
+          ostringstream ds;
+          bool eq;
 
-          save (eop,
-                transform (rd.str, false /* regex */, rd.modifiers (), env),
-                ll);
+          try
+          {
+            ifdstream ois (op, ifdstream::badbit);
+            ostringstream* dos (diag ? &ds : nullptr);
 
-          env.clean_special (eop);
+            if (rd.type == redirect_type::file)
+            {
+              ifdstream eis (eop, ifdstream::badbit);
+              eq = diff_text (eis, ois,
+                              env.host.class_ == "windows",
+                              dos,
+                              label (eop), label (op));
+            }
+            else
+            {
+              istringstream eis (eos);
+              eq = diff_text (eis, ois,
+                              env.host.class_ == "windows",
+                              dos,
+                              label (eop), label (op));
+            }
+          }
+          catch (const io_error& e)
+          {
+            fail (ll) << "unable to compare " << op << " with " << eop << ": "
+                      << e << endf;
+          }
+
+          if (eq)
+            return true;
+
+          save_expected ();
+
+          // Output doesn't match the expected result.
+          //
+          if (diag)
+          {
+            // Save the differences to a file for troubleshooting.
+            //
+            path ep (op + ".diff");
+            save (ep, ds.str (), ll);
+            env.clean_special (ep);
+
+            diag_record d (error (ll));
+            d << pr << " " << what << " doesn't match expected";
+
+            output_info (d, op);
+            output_info (d, eop, "expected ");
+            output_info (d, ep, "", " diff");
+            input_info  (d);
+
+            print_file (d, ep, ll);
+          }
+
+          return false;
         }
 
+        save_expected ();
+
         // Use the diff utility for comparison.
         //
-        path dp ("diff");
-        process_path pp (run_search (dp, true));
+        process_path pp (run_search (*env.diff_utility, true));
 
         cstrings args {pp.recall_string (), "-u"};
 
@@ -389,10 +480,11 @@ namespace build2
           // user it is a part of the script failure diagnostics so let's
           // redirect stdout to stderr.
           //
-          process p (pp, args.data (), 0, 2, efd.get ());
+          process p (process_spawn (pp, args.data (), 0, 2, efd.get ()));
+          trace_process_start (p, args.data ());
           efd.reset ();
 
-          if (p.wait ())
+          if (process_wait (p))
             return true;
 
           assert (p.exit);
@@ -915,13 +1007,68 @@ namespace build2
         name);
     }
 
+    // Return true if the command will be executed in-process as a builtin
+    // or as the set pseudo-builtin (which reads its stdin).
+    //
+    static bool
+    in_process (const command& c)
+    {
+      if (c.program.initial != nullptr)
+        return false;
+
+      const string& p (c.program.recall.string ());
+      const builtin_info* bi (find_builtin (p, &c.arguments));
+
+      return bi != nullptr && (bi->function != nullptr || p == "set");
+    }
+
+    // Open the pipe connecting two commands executed in-process.
+    //
+    // Such commands are executed in separate threads of this process that
+    // exchange the data via the pipe and every time its buffer fills up the
+    // writer blocks until the reader catches up. So on Linux, where the
+    // pipe capacity can be changed, we make it large enough for the output
+    // of a typical builtin (cat, sed, etc) to fit without blocking. Note
+    // that if that's not possible (the limit is 1M by default, see
+    // /proc/sys/fs/pipe-max-size), we just keep the default capacity.
+    //
+    static fdpipe
+    open_builtin_pipe ()
+    {
+      fdpipe r (open_pipe ());
+
+#if defined(__linux__) && defined(F_SETPIPE_SZ)
+      fcntl (r.out.get (), F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+      return r;
+    }
+
+    // Return true if the command will be executed as one of the builtins
+    // implemented in libbuild2 and so can be connected to another such
+    // command with the in-memory channel rather than the pipe (see
+    // open_builtin_channel() for details).
+    //
+    static inline bool
+    channel_command (const command& c)
+    {
+      return c.program.initial == nullptr &&
+             channel_builtin (c.program.recall.string (), c.arguments);
+    }
+
+    // If the stdin channel end (ich) is not empty, then it is used by the
+    // command instead of the file descriptor (ifd). If the default stderr
+    // redirect (derr) is not NULL, then it is used instead of the
+    // environment's.
+    //
     static bool
     run_pipe (environment& env,
               command_pipe::const_iterator bc,
               command_pipe::const_iterator ec,
-              auto_fd ifd,
+              auto_fd ifd, builtin_channel_end ich,
               size_t ci, size_t li, const location& ll,
-              bool diag)
+              bool diag,
+              const redirect* derr)
     {
       if (bc == ec) // End of the pipeline.
         return true;
@@ -960,10 +1107,10 @@ namespace build2
         env.clean ({cl.type, move (np)}, false);
       }
 
-      // If stdin file descriptor is not open then this is the first pipeline
-      // command.
+      // If stdin file descriptor is not open (and there is no stdin
+      // channel) then this is the first pipeline command.
       //
-      bool first (ifd.get () == -1);
+      bool first (ifd.get () == -1 && !ich);
 
       command_pipe::const_iterator nc (bc + 1);
       bool last (nc == ec);
@@ -983,7 +1130,9 @@ namespace build2
                            ? nullptr // stdout is piped.
                            : &(c.out ? *c.out : env.out).effective ());
 
-      const redirect& err ((c.err ? *c.err : env.err).effective ());
+      const redirect& err ((c.err           ? *c.err :
+                            derr != nullptr ? *derr  :
+                            env.err).effective ());
 
       auto process_args = [&c] () -> cstrings
       {
@@ -1161,7 +1310,7 @@ namespace build2
         }
       }
 
-      assert (ifd.get () != -1);
+      assert (ifd.get () != -1 || ich);
 
       // Prior to opening file descriptors for command outputs redirects
       // let's check if the command is the set builtin. Being a builtin
@@ -1294,11 +1443,14 @@ namespace build2
 
       path osp;
       fdpipe ofd;
+      builtin_channel_pipe och;
 
       // If this is the last command in the pipeline than redirect the
       // command process stdout to a file. Otherwise create a pipe and
       // redirect the stdout to the write-end of the pipe. The read-end will
-      // be passed as stdin for the next command in the pipeline.
+      // be passed as stdin for the next command in the pipeline. Two
+      // builtins implemented in libbuild2 are connected with the in-memory
+      // channel instead.
       //
       // @@ Shouldn't we allow the here-* and file output redirects for a
       //    command with pipelined output? Say if such redirect is present
@@ -1314,7 +1466,17 @@ namespace build2
       else
       {
         assert (!c.out); // No redirect expected.
-        ofd = open_pipe ();
+
+        // Note that stderr merged into stdout needs the file descriptor.
+        //
+        if (channel_command (c)   &&
+            channel_command (*nc) &&
+            err.type != redirect_type::merge)
+          och = open_builtin_channel (1024 * 1024);
+        else if (in_process (c) && in_process (*nc))
+          ofd = open_builtin_pipe ();
+        else
+          ofd = open_pipe ();
       }
 
       path esp;
@@ -1340,13 +1502,13 @@ namespace build2
         }
       }
 
-      // All descriptors should be open to the date.
+      // All descriptors (or the stdout channel) should be open to the date.
       //
-      assert (ofd.out.get () != -1 && efd.get () != -1);
+      assert ((ofd.out.get () != -1 || och.out) && efd.get () != -1);
 
       optional<process_exit> exit;
       const builtin_info* bi (resolve
-                              ? builtins.find (program)
+                              ? find_builtin (program, &c.arguments)
                               : nullptr);
 
       bool success;
@@ -1569,17 +1731,26 @@ namespace build2
         try
         {
           uint8_t r; // Storage.
-          builtin b (bi->function (r,
-                                   c.arguments,
-                                   move (ifd), move (ofd.out), move (efd),
-                                   *env.work_dir.path,
-                                   bcs));
+          builtin b (ich || och.out
+                     ? start_builtin (program,
+                                      r,
+                                      c.arguments,
+                                      move (ifd), move (ich),
+                                      move (ofd.out), move (och.out),
+                                      move (efd),
+                                      *env.work_dir.path)
+                     : bi->function (r,
+                                     c.arguments,
+                                     move (ifd), move (ofd.out), move (efd),
+                                     *env.work_dir.path,
+                                     bcs));
 
           success = run_pipe (env,
                               nc,
                               ec,
-                              move (ofd.in),
-                              ci + 1, li, ll, diag);
+                              move (ofd.in), move (och.in),
+                              ci + 1, li, ll, diag,
+                              derr);
 
           exit = process_exit (b.wait ());
         }
@@ -1593,6 +1764,8 @@ namespace build2
       {
         // Execute the process.
         //
+        assert (!ich && !och.out); // Only connect builtins.
+
         cstrings args (process_args ());
 
         // If the process path is not pre-searched then resolve the relative
@@ -1648,11 +1821,14 @@ namespace build2
             print_process (pe, args);
 
           process pr (
-            *pe.path,
-            args.data (),
-            {ifd.get (), -1}, process::pipe (ofd), {-1, efd.get ()},
-            env.work_dir.path->string ().c_str (),
-            pe.vars);
+            process_spawn (
+              *pe.path,
+              args.data (),
+              {ifd.get (), -1}, process::pipe (ofd), {-1, efd.get ()},
+              env.work_dir.path->string ().c_str (),
+              pe.vars));
+
+          trace_process_start (pr, args.data ());
 
           ifd.reset ();
           ofd.out.reset ();
@@ -1661,10 +1837,11 @@ namespace build2
           success = run_pipe (env,
                               nc,
                               ec,
-                              move (ofd.in),
-                              ci + 1, li, ll, diag);
+                              move (ofd.in), builtin_channel_end (),
+                              ci + 1, li, ll, diag,
+                              derr);
 
-          pr.wait ();
+          process_wait (pr);
 
           exit = move (pr.exit);
         }
@@ -1779,7 +1956,8 @@ namespace build2
     run_expr (environment& env,
               const command_expr& expr,
               size_t li, const location& ll,
-              bool diag)
+              bool diag,
+              const redirect* derr = nullptr)
     {
       // Commands are numbered sequentially throughout the expression
       // starting with 1. Number 0 means the command is a single one.
@@ -1817,8 +1995,11 @@ namespace build2
         // with false.
         //
         if (!((or_op && r) || (!or_op && !r)))
-          r = run_pipe (
-            env, p.begin (), p.end (), auto_fd (), ci, li, ll, print);
+          r = run_pipe (env,
+                        p.begin (), p.end (),
+                        auto_fd (), builtin_channel_end (),
+                        ci, li, ll, print,
+                        derr);
 
         ci += p.size ();
       }
@@ -1829,13 +2010,14 @@ namespace build2
     void
     run (environment& env,
          const command_expr& expr,
-         size_t li, const location& ll)
+         size_t li, const location& ll,
+         const redirect* err)
     {
       // Note that we don't print the expression at any verbosity level
       // assuming that the caller does this, potentially providing some
       // additional information (command type, etc).
       //
-      if (!run_expr (env, expr, li, ll, true /* diag */))
+      if (!run_expr (env, expr, li, ll, true /* diag */, err))
         throw failed (); // Assume diagnostics is already printed.
     }
 
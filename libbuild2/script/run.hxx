@@ -38,8 +38,13 @@ namespace build2
     // Location is the start position of this command line in the script. It
     // can be used in diagnostics.
     //
+    // If the stderr redirect is specified, then it is used as the default
+    // one instead of the environment's (see buildscript parallel blocks for
+    // a use case).
+    //
     void
-    run (environment&, const command_expr&, size_t index, const location&);
+    run (environment&, const command_expr&, size_t index, const location&,
+         const redirect* err = nullptr);
 
     bool
     run_if (environment&, const command_expr&, size_t, const location&);
@@ -731,6 +731,8 @@ namespace build2
           assert (false); // Error so should have been checked.
       }
 
+      mlock l (cleanup_mutex_);
+
       auto pr = [&p] (const cleanup& v) -> bool {return v.path == p;};
       auto i (find_if (cleanups.begin (), cleanups.end (), pr));
 
@@ -743,6 +745,7 @@ namespace build2
     void environment::
     clean_special (path p)
     {
+      mlock l (cleanup_mutex_);
       special_cleanups.emplace_back (move (p));
     }
   }
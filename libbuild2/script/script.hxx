@@ -410,6 +410,11 @@ namespace build2
       const redirect out;
       const redirect err;
 
+      // The external diff utility to compare the expected and actual output
+      // with. If NULL, then compare in-process (see diff_text()).
+      //
+      const path* diff_utility = nullptr;
+
       environment (build2::context& ctx,
                    const target_triplet& h,
                    const dir_name_view& wd,
@@ -449,6 +454,10 @@ namespace build2
       // cleanup type if this path is already registered. Ignore implicit
       // registration of a path outside root directory (see below).
       //
+      // Note that the cleanup registration functions are MT-safe since
+      // commands can be executed in parallel (see buildscript parallel
+      // blocks for details).
+      //
       void
       clean (cleanup, bool implicit);
 
@@ -478,6 +487,9 @@ namespace build2
     public:
       virtual
       ~environment () = default;
+
+    private:
+      mutex cleanup_mutex_;
     };
   }
 }
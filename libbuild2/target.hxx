@@ -477,6 +477,17 @@ namespace build2
       //
       target_state state;
 
+      // Critical path weight estimate for this operation: the cost of this
+      // target's recipe plus the highest weight among its prerequisites, in
+      // milliseconds (0 means unknown or nothing to do). It is calculated
+      // after the rule's apply() based on the execution times recorded
+      // during previous runs (see execution_history) unless already set by
+      // the rule itself (see prerequisite_weight()). It is used to decide
+      // which prerequisites to start executing first (see
+      // execute_prerequisites() for details).
+      //
+      size_t weight = 0;
+
       // Rule-specific variables.
       //
       // The rule (for this action) has to be matched before these variables
@@ -12,6 +12,8 @@ namespace build2
 {
   namespace test
   {
+    const dir_path module_dir ("test");
+
     // Determine if we have the target (first), id path (second), or both (in
     // which case we also advance the iterator).
     //
@@ -215,5 +217,52 @@ namespace build2
 
       return r;
     }
+
+    // Return the shard key of the target.
+    //
+    static string
+    shard_key (const target& t)
+    {
+      const scope& rs (t.root_scope ());
+
+      string r (t.out_dir ().leaf (rs.out_path ()).posix_representation ());
+      r += t.type ().name;
+      r += '{';
+      r += t.name;
+      r += '}';
+      return r;
+    }
+
+    // Return the shard the key belongs to. Note that the result must be the
+    // same on every run, platform, and machine.
+    //
+    static size_t
+    shard_of (const string& k, size_t n)
+    {
+      uint64_t h (stoull (string (sha256 (k).string (), 0, 16), nullptr, 16));
+      return static_cast<size_t> (h % n);
+    }
+
+    bool common::
+    shard (const target& t) const
+    {
+      if (shard_count == 0)
+        return true;
+
+      return shard_of (shard_key (t), shard_count) == shard_index;
+    }
+
+    bool common::
+    shard (const target& t, const path& id) const
+    {
+      if (shard_count == 0)
+        return true;
+
+      string k (shard_key (t));
+      k += '@';
+      k += id.posix_string ();
+
+      return shard_of (k, shard_count) == shard_index;
+    }
   }
 }
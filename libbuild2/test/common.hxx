@@ -16,6 +16,11 @@ namespace build2
     enum class output_before {fail, warn, clean};
     enum class output_after {clean, keep};
 
+    // The test module's caches directory in out_root/build/ (see the test
+    // rule for details).
+    //
+    extern const dir_path module_dir; // test/
+
     struct common_data
     {
       const variable& config_test;
@@ -45,6 +50,20 @@ namespace build2
       const names* test_ = nullptr; // The config.test value if any.
       scope*       root_ = nullptr; // The root scope for target resolution.
 
+      // The config.test.diff value if any.
+      //
+      const path*  diff_ = nullptr;
+
+      // The config.test.shard value if any: the 0-based shard index and the
+      // number of shards (0 if not sharding).
+      //
+      size_t shard_index = 0;
+      size_t shard_count = 0;
+
+      // The config.test.cache value.
+      //
+      bool cache = true;
+
       // Return true if the specified alias target should pass-through to its
       // prerequisites.
       //
@@ -62,6 +81,17 @@ namespace build2
       bool
       test (const target& test_target, const path& id_path) const;
 
+      // Return true if the specified target (simple test) or testscript
+      // top-level scope belongs to our shard. The assignment is based on a
+      // stable hash of the target name (relative to its project's out_root)
+      // and the scope id path.
+      //
+      bool
+      shard (const target& test_target) const;
+
+      bool
+      shard (const target& test_target, const path& id_path) const;
+
       explicit
       common (common_data&& d): common_data (move (d)) {}
     };
@@ -6,6 +6,7 @@
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/rule.hxx>
+#include <libbuild2/filesystem.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 #include <libbuild2/config/utility.hxx>
@@ -21,6 +22,35 @@ namespace build2
 {
   namespace test
   {
+    // Scope operation callback that cleans up the test result records and
+    // the pre-parsed testscripts (see the test rule for details).
+    //
+    static target_state
+    clean_module_caches (action, const scope& rs, const dir&)
+    {
+      context& ctx (rs.ctx);
+
+      const dir_path& out_root (rs.out_path ());
+
+      target_state r (target_state::unchanged);
+
+      dir_path d (out_root / rs.root_extra->build_dir / module_dir);
+
+      if (exists (d) && rmdir_r (ctx, d))
+      {
+        // Clean up build/ if it became empty (e.g., in case of a build with
+        // a transient configuration).
+        //
+        d = out_root / rs.root_extra->build_dir;
+        if (empty (d))
+          rmdir (ctx, d, 2);
+
+        r = target_state::changed;
+      }
+
+      return r;
+    }
+
     bool
     boot (scope& rs, const location&, module_boot_extra& extra)
     {
@@ -101,6 +131,32 @@ namespace build2
       vp.insert<strings> ("test.redirects");
       vp.insert<strings> ("test.cleanups");
 
+      // Mark tests as heavy: such tests are run without sharing the CPU
+      // with other jobs (see the testscript runner for details).
+      //
+      vp.insert<bool> ("test.heavy");
+
+      // The environment variables that affect the tests and whose changes
+      // should invalidate the test result cache (see the test rule for
+      // details).
+      //
+      vp.insert<strings> ("test.environment");
+
+      // The external diff utility to compare the test output with instead of
+      // doing it in-process.
+      //
+      vp.insert<path> ("config.test.diff");
+
+      // The subset of tests to run as <index>/<count> (1-based) shard of the
+      // deterministic partitioning of the tests (see common::shard()).
+      //
+      vp.insert<string> ("config.test.shard");
+
+      // Whether to keep the test result and pre-parsed testscript caches (see
+      // the test rule for details). True by default.
+      //
+      vp.insert<bool> ("config.test.cache");
+
       // Unless already set, default test.target to build.host. Note that it
       // can still be overriden by the user, e.g., in root.build.
       //
@@ -191,6 +247,39 @@ namespace build2
         else fail << "invalid config.test.output before value '" << b << "'";
       }
 
+      // config.test.diff
+      //
+      m.diff_ = cast_null<path> (lookup_config (rs, "config.test.diff"));
+
+      // config.test.cache
+      //
+      m.cache = cast_true<bool> (lookup_config (rs, "config.test.cache"));
+
+      // config.test.shard
+      //
+      if (const string* v = cast_null<string> (
+            lookup_config (rs, "config.test.shard")))
+      {
+        auto num = [] (const string& s) -> size_t
+        {
+          return (!s.empty () && s.size () < 10 &&
+                  s.find_first_not_of ("0123456789") == string::npos
+                  ? static_cast<size_t> (stoul (s))
+                  : 0);
+        };
+
+        size_t p (v->find ('/'));
+        size_t i (p != string::npos ? num (string (*v, 0, p))  : 0);
+        size_t n (p != string::npos ? num (string (*v, p + 1)) : 0);
+
+        if (n == 0 || i == 0 || i > n)
+          fail << "invalid config.test.shard value '" << *v << "'" <<
+            info << "expected <index>/<count> with 1 <= <index> <= <count>";
+
+        m.shard_index = i - 1;
+        m.shard_count = n;
+      }
+
       //@@ TODO: Need ability to specify extra diff options (e.g.,
       //   --strip-trailing-cr, now hardcoded).
       //
@@ -222,6 +311,16 @@ namespace build2
           perform_test_id, "test.file", file_rule::instance);
       }
 
+      // Register scope operation callback.
+      //
+      // Note that similar to cc module sidebuilds, we clean up the caches as
+      // a pre operation not to prevent the (otherwise-empty) out root
+      // directory from being cleaned up (via the standard fsdir{} chain).
+      //
+      rs.operation_callbacks.emplace (
+        perform_clean_id,
+        scope::operation_callback {&clean_module_caches, nullptr /*post*/});
+
       return true;
     }
 
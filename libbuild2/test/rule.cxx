@@ -3,11 +3,17 @@
 
 #include <libbuild2/test/rule.hxx>
 
+#include <sstream>
+#include <algorithm> // find()
+
+#include <libbuild2/diff.hxx>
+#include <libbuild2/depdb.hxx>
 #include <libbuild2/scope.hxx>
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
 #include <libbuild2/algorithm.hxx>
 #include <libbuild2/filesystem.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 #include <libbuild2/test/target.hxx>
@@ -298,6 +304,13 @@ namespace build2
         }
       }
 
+      // If we are sharding, then only test simple tests that belong to our
+      // shard. For testscripts this is done for each top-level scope by the
+      // runner.
+      //
+      if (test && !script && !shard (t))
+        test = false;
+
       // Neither testing nor passing-through.
       //
       if (!test && pass_n == 0)
@@ -356,11 +369,308 @@ namespace build2
       return ts;
     }
 
+    // Test result cache.
+    //
+    // For each test target we keep a depdb-like record of its last
+    // successful run (<wd-name>.result) in the test module's cache directory
+    // (see cache_dir() below). The first line is the cache format id, the
+    // second is the checksum of everything that affects the test other than
+    // the contents of its input files (the test.* variables, command line,
+    // config.test{,.shard}, the environment variables listed in
+    // test.environment, etc), and the rest are the paths of the input files
+    // (the test executable, path-based prerequisites, testscripts including
+    // the files they include), one per line. If all the lines match and none
+    // of the input files are newer than the record, then the test is assumed
+    // to still pass and is skipped (unless --no-test-cache is specified).
+    // Keeping the records (as well as the pre-parsed testscripts; see
+    // script_cache_path() below) can be disabled with config.test.cache=false.
+    //
+    // Note that a test may also depend on things that we don't track (for
+    // example, variables other than test.* referenced in a testscript, files
+    // that are not prerequisites of the test target, or environment
+    // variables not listed in test.environment). Such changes will go
+    // unnoticed until one of the tracked inputs changes or the run is forced
+    // with --no-test-cache.
+    //
+    static const char cache_id[] = "test.cache 1";
+
+    // Return the test working directory. It is in the out_base of the target
+    // and is called just test for dir{} targets and test-<target-name> for
+    // other targets. Note that for simple tests it is only used to derive the
+    // test result cache record path.
+    //
+    static dir_path
+    work_dir (const target& t)
+    {
+      dir_path r (t.out_dir ());
+
+      if (t.is_a<dir> ())
+        r /= "test";
+      else
+        r /= "test-" + t.name;
+
+      return r;
+    }
+
+    // Return the directory of the test module caches for the target. It is
+    // the target's out_base mirrored in out_root/build/test/ which is removed
+    // when the project is cleaned (see clean_module_caches() for details).
+    // Note that keeping the caches out of out_base also means they don't
+    // clash with any target-related files there (e.g., the exe{test-foo}
+    // depdb).
+    //
+    static dir_path
+    cache_dir (const target& t)
+    {
+      const scope& rs (t.root_scope ());
+      const dir_path& out_root (rs.out_path ());
+
+      return (out_root /
+              rs.root_extra->build_dir /
+              module_dir /
+              t.out_dir ().leaf (out_root));
+    }
+
+    static inline path
+    cache_path (const target& t, const dir_path& wd)
+    {
+      return cache_dir (t) / path (wd.leaf ().string () + ".result");
+    }
+
+    // Return the pre-parsed testscript cache path. It is next to the test
+    // result cache record and is called <wd-name>.<testscript-name>.tsc (see
+    // test::script::parser::pre_parse() for details).
+    //
+    static inline path
+    script_cache_path (const target& t,
+                       const dir_path& wd,
+                       const testscript& ts)
+    {
+      return cache_dir (t) /
+        path (wd.leaf ().string () + '.' + ts.name + ".tsc");
+    }
+
+    // Move the working directory left from the previous run out of the way
+    // so that it can be removed in parallel with running the tests (see
+    // trash_remove() below). Return the directory it was moved to or empty
+    // if that's not possible (in which case the caller should remove it in
+    // place).
+    //
+    static dir_path
+    trash_dir (context& ctx, const dir_path& wd)
+    {
+      tracer trace ("test::trash_dir");
+
+      dir_path r (wd.directory ());
+      r /= wd.leaf ().string () + ".trash";
+
+      // Remove the trash left from an interrupted run, if any.
+      //
+      if (exists (r))
+        rmdir_r (ctx, r, true, 2);
+
+      if (verb >= 2)
+        text << "mv " << wd << ' ' << r;
+
+      try
+      {
+        mvdir (wd, r);
+      }
+      catch (const system_error& e)
+      {
+        l4 ([&]{trace << "unable to move " << wd << ": " << e;});
+        r.clear ();
+      }
+
+      return r;
+    }
+
+    // Remove the trash directory. Note that we only warn if this fails since
+    // the next run will try again.
+    //
+    static void
+    trash_remove (const dir_path& d)
+    {
+      if (verb >= 2)
+        text << "rmdir -r " << d;
+
+      try
+      {
+        butl::rmdir_r (d);
+      }
+      catch (const system_error& e)
+      {
+        warn << "unable to remove directory " << d << ": " << e;
+      }
+    }
+
+    // Collect the paths of the test target's input files.
+    //
+    static paths
+    cache_inputs (const target& t, const common& c)
+    {
+      paths r;
+
+      auto add = [&r] (const target* t)
+      {
+        if (t == nullptr)
+          return;
+
+        if (const path_target* pt = t->is_a<path_target> ())
+        {
+          const path& p (pt->path ());
+
+          if (!p.empty () && find (r.begin (), r.end (), p) == r.end ())
+            r.push_back (p);
+        }
+      };
+
+      add (&t);
+
+      // The test executable override, if it is a target.
+      //
+      if (const name* n = cast_null<name> (t[c.var_test]))
+      {
+        if (!n->empty () && !n->simple () && !n->directory ())
+          add (search_existing (*n, t.base_scope ()));
+      }
+
+      // Note that we can only search for existing targets during execute.
+      //
+      for (const prerequisite& p: group_prerequisites (t))
+        add (search_existing (p));
+
+      return r;
+    }
+
+    // Calculate the checksum of everything (that we track) that affects the
+    // test other than the contents of the input files.
+    //
+    static void
+    cache_checksum (sha256& cs,
+                    const target& t,
+                    const common& c,
+                    const paths& ins)
+    {
+      cs.append (cache_id);
+
+      if (const name* n = cast_null<name> (t[c.var_test]))
+        cs.append (to_string (*n));
+
+      append_options (cs, t[c.test_options]);
+      append_options (cs, t[c.test_arguments]);
+      append_options (cs, t["test.redirects"]);
+      append_options (cs, t["test.cleanups"]);
+
+      cs.append (cast<target_triplet> (t[c.test_target]).string ());
+
+      if (c.test_ != nullptr)
+      {
+        for (const name& n: *c.test_)
+          cs.append (to_string (n));
+      }
+
+      if (c.shard_count != 0)
+      {
+        cs.append (to_string (c.shard_index));
+        cs.append (to_string (c.shard_count));
+      }
+
+      for (const path& p: ins)
+        cs.append (p.string ());
+
+      // The environment variables that affect the tests (unset variables
+      // are distinguished from empty).
+      //
+      if (const strings* vs = cast_null<strings> (t["test.environment"]))
+      {
+        for (const string& n: *vs)
+        {
+          optional<string> v (getenv (n));
+          cs.append (v ? n + '=' + *v : n);
+        }
+      }
+    }
+
+    // Return true if the record is present and valid.
+    //
+    static bool
+    cache_valid (const target& t, const path& rp, const string& cs)
+    {
+      tracer trace ("test::cache_valid");
+
+      if (!exists (rp))
+        return false;
+
+      depdb dd (path (rp));
+
+      if (dd.expect (cache_id) != nullptr)
+        l4 ([&]{trace << "format mismatch for " << t;});
+
+      if (dd.expect (cs) != nullptr)
+        l4 ([&]{trace << "checksum mismatch for " << t;});
+
+      while (dd.more ())
+      {
+        string* l (dd.read ());
+
+        if (l == nullptr)
+          break;
+
+        path p (move (*l));
+        timestamp mt (mtime (p));
+
+        if (mt == timestamp_nonexistent || mt > dd.mtime)
+        {
+          l4 ([&]{trace << "input " << p << " changed for " << t;});
+          return false;
+        }
+      }
+
+      // Note that the database is switched to writing if it is corrupt or
+      // there is a mismatch.
+      //
+      if (dd.writing ())
+        return false;
+
+      dd.close ();
+      return true;
+    }
+
+    // Save the record after a successful run that started at the specified
+    // time unless any of the input files have changed since.
+    //
+    static void
+    cache_save (const path& rp,
+                const string& cs,
+                const paths& ins,
+                timestamp start)
+    {
+      for (const path& p: ins)
+      {
+        timestamp mt (mtime (p));
+
+        if (mt == timestamp_nonexistent || mt > start)
+          return;
+      }
+
+      depdb dd (path (rp));
+
+      dd.write (cache_id);
+      dd.write (cs);
+
+      for (const path& p: ins)
+        dd.write (p);
+
+      dd.close ();
+    }
+
     static script::scope_state
     perform_script_impl (const target& t,
                          const testscript& ts,
                          const dir_path& wd,
-                         const common& c)
+                         const common& c,
+                         paths& fps)
     {
       using namespace script;
 
@@ -372,7 +682,13 @@ namespace build2
 
         {
           parser p (t.ctx);
-          p.pre_parse (s);
+
+          if (c.cache)
+            p.pre_parse (s, script_cache_path (t, wd, ts));
+          else
+            p.pre_parse (s);
+
+          fps = s.file_paths ();
 
           default_runner r (c);
           p.execute (s, r);
@@ -423,16 +739,40 @@ namespace build2
         one = *o;
       }
 
-      // Calculate root working directory. It is in the out_base of the target
-      // and is called just test for dir{} targets and test-<target-name> for
-      // other targets.
+      // Calculate root working directory.
       //
-      dir_path wd (t.out_dir ());
+      dir_path wd (work_dir (t));
 
-      if (t.is_a<dir> ())
-        wd /= "test";
-      else
-        wd /= "test-" + t.name;
+      // See if we can skip running the testscripts (see the test result
+      // cache above). Otherwise, remove the record so that it doesn't survive
+      // a failed or interrupted run.
+      //
+      path rp;
+      string cs;
+      paths ins;
+      timestamp start;
+
+      if (!ctx.dry_run && cache)
+      {
+        rp = cache_path (t, wd);
+        ins = cache_inputs (t, *this);
+
+        sha256 c;
+        cache_checksum (c, t, *this, ins);
+        cs = c.string ();
+
+        if (ctx.test_cache && cache_valid (t, rp, cs))
+        {
+          if (verb)
+            text << "test " << t << " (cached)";
+
+          return target_state::changed;
+        }
+
+        rmfile (ctx, rp, 3);
+        mkdir_p (rp.directory (), 3);
+        start = system_clock::now ();
+      }
 
       // Are we backlinking the test working directory to src? (See
       // backlink_*() in algorithm.cxx for details.)
@@ -467,6 +807,8 @@ namespace build2
       if (exists (static_cast<const path&> (wd), false))
         fail << "working directory " << wd << " is a file/symlink";
 
+      dir_path tr; // Trash directory to remove.
+
       if (exists (wd))
       {
         if (before != output_before::clean)
@@ -486,7 +828,13 @@ namespace build2
         // Remove the directory itself not to confuse the runner which tries
         // to detect when tests stomp on each others feet.
         //
-        rmdir_r (ctx, wd, true, 2);
+        // Since what's left from the previous run can be large (think kept
+        // output of thousands of tests), we move the directory out of the
+        // way and remove it asynchronously while running the tests (see
+        // below).
+        //
+        if (ctx.dry_run || (tr = trash_dir (ctx, wd)).empty ())
+          rmdir_r (ctx, wd, true, 2);
       }
 
       // Delay actually creating the directory in case all the tests are
@@ -501,6 +849,17 @@ namespace build2
       if (!ctx.dry_run)
         wg = wait_guard (ctx, ctx.count_busy (), t[a].task_count);
 
+      if (!tr.empty ())
+        ctx.sched.async (ctx.count_busy (),
+                         t[a].task_count,
+                         [] (const diag_frame* ds, const dir_path& d)
+                         {
+                           diag_frame::stack_guard dsg (ds);
+                           trash_remove (d);
+                         },
+                         diag_frame::stack (),
+                         cref (tr));
+
       // Result vector.
       //
       using script::scope_state;
@@ -508,6 +867,11 @@ namespace build2
       vector<scope_state> res;
       res.reserve (pts_n - pass_n); // Make sure there are no reallocations.
 
+      // Testscript file paths (for the test result cache).
+      //
+      vector<paths> fps;
+      fps.reserve (pts_n - pass_n);
+
       for (size_t i (pass_n); i != pts_n; ++i)
       {
         const testscript& ts (*pts[i]->is_a<testscript> ());
@@ -545,6 +909,8 @@ namespace build2
                          ? scope_state::passed
                          : scope_state::unknown);
 
+          fps.push_back (paths ());
+
           if (!ctx.dry_run)
           {
             scope_state& r (res.back ());
@@ -553,15 +919,18 @@ namespace build2
                                   t[a].task_count,
                                   [this] (const diag_frame* ds,
                                           scope_state& r,
+                                          paths& fps,
                                           const target& t,
                                           const testscript& ts,
                                           const dir_path& wd)
                                   {
                                     diag_frame::stack_guard dsg (ds);
-                                    r = perform_script_impl (t, ts, wd, *this);
+                                    r = perform_script_impl (
+                                      t, ts, wd, *this, fps);
                                   },
                                   diag_frame::stack (),
                                   ref (r),
+                                  ref (fps.back ()),
                                   cref (t),
                                   cref (ts),
                                   cref (wd)))
@@ -622,9 +991,59 @@ namespace build2
       if (bad)
         throw failed ();
 
+      // Record the successful run adding the included testscript files to
+      // the inputs.
+      //
+      if (!rp.empty ())
+      {
+        for (const paths& ps: fps)
+        {
+          for (const path& p: ps)
+          {
+            if (find (ins.begin (), ins.end (), p) == ins.end ())
+              ins.push_back (p);
+          }
+        }
+
+        cache_save (rp, cs, ins, start);
+      }
+
       return target_state::changed;
     }
 
+    // Compare the process stdout with the expected output file saving the
+    // differences, if any, in the unified diff format.
+    //
+    static bool
+    compare_output (const target& t,
+                    process& p,
+                    const path& eout,
+                    bool strip_cr,
+                    string& diff)
+    {
+      try
+      {
+        // Skip the rest of the output on mismatch not to block the process.
+        //
+        ifdstream ais (move (p.in_ofd),
+                       fdstream_mode::skip,
+                       ifdstream::badbit);
+        ifdstream eis (eout, ifdstream::badbit);
+
+        ostringstream os;
+        bool r (diff_text (eis, ais, strip_cr, &os, eout.string (), "stdout"));
+
+        ais.close ();
+        diff = os.str ();
+        return r;
+      }
+      catch (const io_error& e)
+      {
+        fail << "unable to compare " << t << " stdout with " << eout << ": "
+             << e << endf;
+      }
+    }
+
     // The format of args shall be:
     //
     // name1 arg arg ... nullptr
@@ -632,10 +1051,15 @@ namespace build2
     // ...
     // nameN arg arg ... nullptr nullptr
     //
+    // If eout is not NULL, then the last process stdout is compared to the
+    // contents of this file in-process.
+    //
     static bool
     run_test (const target& t,
               diag_record& dr,
               char const** args,
+              const path* eout,
+              bool strip_cr,
               process* prev = nullptr)
     {
       // Find the next process, if any.
@@ -644,20 +1068,42 @@ namespace build2
       for (next++; *next != nullptr; next++) ;
       next++;
 
-      // Redirect stdout to a pipe unless we are last.
+      // Redirect stdout to a pipe unless we are last and don't need to
+      // compare the output.
       //
-      int out (*next != nullptr ? -1 : 1);
+      bool last (*next == nullptr);
+      int out (!last || eout != nullptr ? -1 : 1);
       bool pr;
+      bool cr (true); // Output matches expected.
+      string diff;
       process_exit pe;
 
       try
       {
-        process p (prev == nullptr
-                   ? process (args, 0, out)       // First process.
-                   : process (args, *prev, out)); // Next process.
+        // The first process reads our stdin while the next process reads
+        // the previous process stdout (which we close on our side).
+        //
+        process p (process_spawn (process::path_search (args[0]),
+                                  args,
+                                  prev == nullptr ? 0 : prev->in_ofd.get (),
+                                  out));
+
+        if (prev != nullptr)
+          prev->in_ofd.reset ();
 
-        pr = *next == nullptr || run_test (t, dr, next, &p);
-        p.wait ();
+        trace_process_start (p, args);
+
+        if (!last)
+          pr = run_test (t, dr, next, eout, strip_cr, &p);
+        else
+        {
+          pr = true;
+
+          if (eout != nullptr)
+            cr = compare_output (t, p, *eout, strip_cr, diff);
+        }
+
+        process_wait (p);
 
         assert (p.exit);
         pe = *p.exit;
@@ -683,8 +1129,26 @@ namespace build2
         print_process (dr, args);
         dr << " " << pe;
       }
+      //
+      // Only report the output mismatch if the process itself succeeded.
+      //
+      else if (!cr)
+      {
+        if (pr) // First failure?
+          dr << fail << "test " << t << " failed";
+
+        dr << error << "stdout doesn't match expected " << *eout;
+
+        // Suppress the trailing newline since the diag record adds its own.
+        //
+        if (!diff.empty ())
+        {
+          diff.pop_back ();
+          dr << '\n' << diff;
+        }
+      }
 
-      return pr && wr;
+      return pr && wr && cr;
     }
 
     target_state rule::
@@ -840,7 +1304,13 @@ namespace build2
 
       // Do we have stdout?
       //
-      path dp ("diff");
+      // Unless the external diff utility is requested (config.test.diff), we
+      // compare the output in-process (see run_test()).
+      //
+      const path* eout (nullptr);
+      bool strip_cr (
+        cast<target_triplet> (tt[test_target]).class_ == "windows");
+
       process_path dpp;
       if (pass_n != pts_n && pts[pass_n + 1] != nullptr)
       {
@@ -848,46 +1318,94 @@ namespace build2
         const path& op (ot.path ());
         assert (!op.empty ()); // Should have been assigned by update.
 
-        dpp = run_search (dp, true);
+        if (diff_ == nullptr)
+          eout = &op;
+        else
+        {
+          dpp = run_search (*diff_, true);
 
-        args.push_back (dpp.recall_string ());
-        args.push_back ("-u");
+          args.push_back (dpp.recall_string ());
+          args.push_back ("-u");
 
-        // Note that MinGW-built diff utility (as of 3.3) fails trying to
-        // detect if stdin contains text or binary data. We will help it a bit
-        // to workaround the issue.
-        //
+          // Note that MinGW-built diff utility (as of 3.3) fails trying to
+          // detect if stdin contains text or binary data. We will help it a
+          // bit to workaround the issue.
+          //
 #ifdef _WIN32
-        args.push_back ("--text");
+          args.push_back ("--text");
 #endif
 
-        // Ignore Windows newline fluff if that's what we are running on.
-        //
-        if (cast<target_triplet> (tt[test_target]).class_ == "windows")
-          args.push_back ("--strip-trailing-cr");
+          // Ignore Windows newline fluff if that's what we are running on.
+          //
+          if (strip_cr)
+            args.push_back ("--strip-trailing-cr");
 
-        const char* f (op.string ().c_str ());
+          const char* f (op.string ().c_str ());
 
-        // Note that unmatched program stdout will be referred by diff as '-'
-        // by default. Let's name it as 'stdout' for clarity and consistency
-        // with the buildscript diagnostics.
-        //
-        // Also note that the -L option is not portable but is supported by all
-        // the major implementations (see script/run.cxx for details).
-        //
-        args.push_back ("-L");
-        args.push_back (f);
+          // Note that unmatched program stdout will be referred by diff as
+          // '-' by default. Let's name it as 'stdout' for clarity and
+          // consistency with the buildscript diagnostics.
+          //
+          // Also note that the -L option is not portable but is supported by
+          // all the major implementations (see script/run.cxx for details).
+          //
+          args.push_back ("-L");
+          args.push_back (f);
 
-        args.push_back ("-L");
-        args.push_back ("stdout");
+          args.push_back ("-L");
+          args.push_back ("stdout");
 
-        args.push_back (f);
-        args.push_back ("-");
-        args.push_back (nullptr);
+          args.push_back (f);
+          args.push_back ("-");
+          args.push_back (nullptr);
+        }
       }
 
       args.push_back (nullptr); // Second.
 
+      // See if we can skip running the test (see the test result cache
+      // above). Otherwise, remove the record so that it doesn't survive a
+      // failed or interrupted run.
+      //
+      path rp;
+      string cs;
+      paths ins;
+      timestamp start;
+
+      if (!ctx.dry_run && cache)
+      {
+        rp = cache_path (tt, work_dir (tt));
+        ins = cache_inputs (tt, *this);
+
+        if (!pp.empty ())
+        {
+          path ep (pp.effect_string ());
+
+          if (find (ins.begin (), ins.end (), ep) == ins.end ())
+            ins.push_back (move (ep));
+        }
+
+        sha256 c;
+        cache_checksum (c, tt, *this, ins);
+
+        for (const char* a: args)
+          c.append (a != nullptr ? a : "");
+
+        cs = c.string ();
+
+        if (ctx.test_cache && cache_valid (tt, rp, cs))
+        {
+          if (verb)
+            text << "test " << tt << " (cached)";
+
+          return target_state::changed;
+        }
+
+        rmfile (ctx, rp, 3);
+        mkdir_p (rp.directory (), 3);
+        start = system_clock::now ();
+      }
+
       if (verb >= 2)
         print_process (args);
       else if (verb)
@@ -899,12 +1417,17 @@ namespace build2
         if (!run_test (tt,
                        dr,
                        args.data () + (sin ? 3 : 0), // Skip cat.
+                       eout,
+                       strip_cr,
                        sin ? &cat : nullptr))
         {
           dr << info << "test command line: ";
           print_process (dr, args);
           dr << endf; // return
         }
+
+        if (!rp.empty ())
+          cache_save (rp, cs, ins, start);
       }
 
       return target_state::changed;
@@ -0,0 +1,568 @@
+// file      : libbuild2/test/script/cache.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/test/script/parser.hxx>
+
+#include <cstring> // memcmp()
+
+#include <libbuild2/filesystem.hxx>
+#include <libbuild2/diagnostics.hxx>
+
+#include <libbuild2/script/token.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  namespace test
+  {
+    namespace script
+    {
+      // The pre-parsed script cache file format is binary and starts with the
+      // signature, the format version, and the build system version followed
+      // by the paths and checksums of the testscript files (the script itself
+      // first, then the files it includes) and the script scope tree. All the
+      // integers are unsigned and are stored in the little-endian byte order.
+      // Strings are stored as their size (4 bytes) followed by the contents.
+      //
+      // The paths of the tokens and locations are stored as indexes in the
+      // file list. The token printers (which are functions) are stored as
+      // indexes in the printers array below.
+      //
+      static const char     cache_signature[4] = {'b', '2', 't', 's'};
+      static const uint32_t cache_version = 1;
+
+      static token::printer_type* const printers[] = {
+        &build2::token_printer,
+        &build2::script::token_printer,
+        &token_printer};
+
+      // Sanity limit for the string size so that we don't try to allocate
+      // something outrageous for a corrupted file.
+      //
+      static const uint32_t max_string_size (uint32_t (1) << 28);
+
+      template <typename T>
+      static void
+      write_uint (ofdstream& os, T v)
+      {
+        unsigned char b[sizeof (T)];
+        for (size_t i (0); i != sizeof (T); ++i, v >>= 8)
+          b[i] = static_cast<unsigned char> (v & 0xFF);
+
+        os.write (reinterpret_cast<const char*> (b), sizeof (T));
+      }
+
+      static void
+      write_string (ofdstream& os, const string& s)
+      {
+        write_uint (os, static_cast<uint32_t> (s.size ()));
+        os.write (s.c_str (), s.size ());
+      }
+
+      // Note that the reading functions rely on the stream to throw on
+      // failbit and throw invalid_argument if the data is inconsistent.
+      //
+      template <typename T>
+      static T
+      read_uint (ifdstream& is)
+      {
+        unsigned char b[sizeof (T)];
+        is.read (reinterpret_cast<char*> (b), sizeof (T));
+
+        T r (0);
+        for (size_t i (sizeof (T)); i != 0; --i)
+          r = static_cast<T> ((r << 8) | b[i - 1]);
+
+        return r;
+      }
+
+      static string
+      read_string (ifdstream& is)
+      {
+        uint32_t n (read_uint<uint32_t> (is));
+
+        if (n > max_string_size)
+          throw invalid_argument ("invalid string size");
+
+        string r (n, '\0');
+        if (n != 0)
+          is.read (&r[0], n);
+
+        return r;
+      }
+
+      // Map the token path names and location paths to their indexes in the
+      // file list. Note that the tokens refer to the path names themselves
+      // while the locations to their paths (see path_name_view for details).
+      //
+      using token_paths = std::map<const path_name*, uint32_t>;
+      using location_paths = std::map<const path*, uint32_t>;
+
+      static void
+      write_location (ofdstream& os,
+                      const location_paths& pis,
+                      const location& l)
+      {
+        auto i (pis.find (l.file.path));
+
+        if (l.file.path != nullptr && i == pis.end ())
+          throw invalid_argument ("unknown location path");
+
+        write_uint (os, (l.file.path != nullptr
+                         ? i->second + 1
+                         : uint32_t (0))); // 0 for no path.
+        write_uint (os, l.line);
+        write_uint (os, l.column);
+      }
+
+      static location
+      read_location (ifdstream& is, const vector<const path_name*>& fs)
+      {
+        uint32_t f (read_uint<uint32_t> (is));
+
+        if (f > fs.size ())
+          throw invalid_argument ("invalid location path index");
+
+        uint64_t ln (read_uint<uint64_t> (is));
+        uint64_t cn (read_uint<uint64_t> (is));
+
+        return f != 0 ? location (*fs[f - 1], ln, cn) : location ();
+      }
+
+      static void
+      write_lines (ofdstream& os, const token_paths& pis, const lines& ls)
+      {
+        write_uint (os, static_cast<uint32_t> (ls.size ()));
+
+        for (const line& l: ls)
+        {
+          write_uint (os, static_cast<uint8_t> (l.type));
+
+          if (l.type == line_type::var)
+            write_string (os, l.var->name);
+
+          write_uint (os, static_cast<uint32_t> (l.tokens.size ()));
+
+          for (const replay_token& rt: l.tokens)
+          {
+            const token& t (rt.token);
+
+            auto pi (pis.find (rt.file));
+            if (pi == pis.end ())
+              throw invalid_argument ("unknown token path");
+
+            auto ti (find (begin (printers), end (printers), t.printer));
+            if (ti == end (printers))
+              throw invalid_argument ("unknown token printer");
+
+            // The mode data is opaque (could be a pointer), so we don't
+            // expect it to be used by the testscript lexer.
+            //
+            if (rt.mode_data != 0)
+              throw invalid_argument ("unexpected lexer mode data");
+
+            write_uint (os, static_cast<uint16_t> (t.type));
+            write_uint (os, static_cast<uint8_t> ((t.separated ? 1 : 0) |
+                                                  (t.qcomp     ? 2 : 0)));
+            write_uint (os, static_cast<uint8_t> (t.qtype));
+            write_string (os, t.value);
+            write_uint (os, t.line);
+            write_uint (os, t.column);
+            write_uint (os, static_cast<uint8_t> (ti - begin (printers)));
+            write_uint (os, pi->second);
+            write_uint (os, static_cast<uint16_t> (rt.mode));
+          }
+        }
+      }
+
+      static void
+      read_lines (ifdstream& is,
+                  const vector<const path_name*>& fs,
+                  variable_pool& vp,
+                  lines& ls)
+      {
+        for (uint32_t n (read_uint<uint32_t> (is)); n != 0; --n)
+        {
+          uint8_t lt (read_uint<uint8_t> (is));
+
+          if (lt > static_cast<uint8_t> (line_type::cmd_end))
+            throw invalid_argument ("invalid line type");
+
+          line l;
+          l.type = static_cast<line_type> (lt);
+
+          if (l.type == line_type::var)
+            l.var = &vp.insert (read_string (is));
+
+          for (uint32_t tn (read_uint<uint32_t> (is)); tn != 0; --tn)
+          {
+            token_type::value_type tt (read_uint<uint16_t> (is));
+            uint8_t fl (read_uint<uint8_t> (is));
+            uint8_t qt (read_uint<uint8_t> (is));
+            string v (read_string (is));
+            uint64_t ln (read_uint<uint64_t> (is));
+            uint64_t cn (read_uint<uint64_t> (is));
+            uint8_t pi (read_uint<uint8_t> (is));
+            uint32_t fi (read_uint<uint32_t> (is));
+            lexer_mode_base::value_type m (read_uint<uint16_t> (is));
+
+            if (qt > static_cast<uint8_t> (quote_type::mixed) ||
+                pi >= sizeof (printers) / sizeof (printers[0]) ||
+                fi >= fs.size ())
+              throw invalid_argument ("invalid token");
+
+            l.tokens.push_back (
+              replay_token {
+                token (tt,
+                       move (v),
+                       (fl & 1) != 0,
+                       static_cast<quote_type> (qt),
+                       (fl & 2) != 0,
+                       ln, cn,
+                       printers[pi]),
+                fs[fi],
+                lexer_mode_base (m),
+                0 /* mode_data */});
+          }
+
+          ls.push_back (move (l));
+        }
+      }
+
+      void parser::
+      pre_parse (script& s, const path& cp)
+      {
+        if (load_cache (s, cp))
+          return;
+
+        // Pre-parse the script collecting the checksums of the testscript
+        // files as they are being read. This way we don't cache the result
+        // of parsing one version of a file with the checksum of another if
+        // it is modified in between.
+        //
+        std::map<path, string> cs;
+        checksums_ = &cs;
+        auto g (make_guard ([this] () {checksums_ = nullptr;}));
+
+        pre_parse (s);
+
+        if (cacheable_)
+          save_cache (s, cp);
+        else
+          try_rmfile (cp, true /* ignore_error */);
+      }
+
+      bool parser::
+      load_cache (script& s, const path& cp)
+      {
+        tracer trace ("test::script::parser::load_cache");
+
+        if (!exists (cp))
+          return false;
+
+        try
+        {
+          ifdstream is (cp,
+                        fdopen_mode::binary,
+                        ifdstream::badbit | ifdstream::failbit);
+
+          char sig[sizeof (cache_signature)];
+          is.read (sig, sizeof (sig));
+
+          if (memcmp (sig, cache_signature, sizeof (sig)) != 0 ||
+              read_uint<uint32_t> (is) != cache_version          ||
+              read_string (is) != build_version.string ())
+          {
+            l4 ([&]{trace << "ignoring " << cp << ": format mismatch";});
+            return false;
+          }
+
+          // Verify the testscript files, starting with the script itself, by
+          // comparing the checksums of their current contents.
+          //
+          paths ps;
+
+          for (uint32_t n (read_uint<uint32_t> (is)); n != 0; --n)
+          {
+            path p (read_string (is));
+            string c (read_string (is));
+
+            if (ps.empty () && p != s.script_target.path ())
+            {
+              l4 ([&]{trace << "ignoring " << cp << ": script mismatch";});
+              return false;
+            }
+
+            try
+            {
+              ifdstream ifs (p);
+
+              if (sha256 (ifs.read_text ()).string () != c)
+              {
+                l4 ([&]{trace << "ignoring " << cp << ": " << p
+                              << " changed";});
+                return false;
+              }
+
+              ifs.close ();
+            }
+            catch (const io_error&)
+            {
+              l4 ([&]{trace << "ignoring " << cp << ": unable to read "
+                            << p;});
+              return false;
+            }
+
+            ps.push_back (move (p));
+          }
+
+          if (ps.empty ())
+            throw invalid_argument ("no files");
+
+          // Load the scope tree. If anything goes wrong from now on, then we
+          // have to undo the partial load.
+          //
+          try
+          {
+            vector<const path_name*> fs;
+            fs.reserve (ps.size ());
+
+            for (path& p: ps)
+              fs.push_back (
+                &*s.paths_.insert (path_name_value (move (p))).first);
+
+            variable_pool& vp (s.var_pool);
+
+            auto read_scope_base = [&is, &fs] (scope& sc)
+            {
+              if (read_uint<uint8_t> (is) != 0)
+              {
+                description d;
+                d.id = read_string (is);
+                d.summary = read_string (is);
+                d.details = read_string (is);
+                sc.desc = move (d);
+              }
+
+              sc.start_loc_ = read_location (is, fs);
+              sc.end_loc_ = read_location (is, fs);
+            };
+
+            function<unique_ptr<scope> (group&)> read_scope;
+            function<void (group&)> read_group;
+
+            read_group = [&is, &fs, &vp, &read_scope] (group& g)
+            {
+              read_lines (is, fs, vp, g.setup_);
+              read_lines (is, fs, vp, g.tdown_);
+
+              for (uint32_t n (read_uint<uint32_t> (is)); n != 0; --n)
+                g.scopes.push_back (read_scope (g));
+            };
+
+            read_scope = [&is, &fs, &vp, &read_scope_base, &read_group,
+                          &read_scope] (group& p) -> unique_ptr<scope>
+            {
+              char k (static_cast<char> (read_uint<uint8_t> (is)));
+              string id (read_string (is));
+
+              if (id.empty () || (k != 'g' && k != 't'))
+                throw invalid_argument ("invalid scope");
+
+              unique_ptr<scope> r;
+
+              if (k == 'g')
+                r.reset (new group (id, p));
+              else
+                r.reset (new test (id, p));
+
+              read_scope_base (*r);
+
+              if (read_uint<uint8_t> (is) != 0)
+              {
+                lines ls;
+                read_lines (is, fs, vp, ls);
+
+                if (ls.size () != 1)
+                  throw invalid_argument ("invalid if-condition");
+
+                r->if_cond_ = move (ls.back ());
+              }
+
+              if (read_uint<uint8_t> (is) != 0)
+                r->if_chain = read_scope (p);
+
+              if (k == 'g')
+                read_group (static_cast<group&> (*r));
+              else
+                read_lines (is, fs, vp, static_cast<test&> (*r).tests_);
+
+              return r;
+            };
+
+            read_scope_base (s);
+            read_group (s);
+
+            if (is.peek () != ifdstream::traits_type::eof ())
+              throw invalid_argument ("trailing data");
+
+            is.close ();
+          }
+          catch (...)
+          {
+            s.desc = nullopt;
+            s.start_loc_ = location ();
+            s.end_loc_ = location ();
+            s.setup_.clear ();
+            s.tdown_.clear ();
+            s.scopes.clear ();
+            s.paths_.clear ();
+            throw;
+          }
+        }
+        catch (const invalid_argument& e)
+        {
+          l4 ([&]{trace << "ignoring " << cp << ": " << e;});
+          return false;
+        }
+        catch (const invalid_path& e)
+        {
+          l4 ([&]{trace << "ignoring " << cp << ": invalid path "
+                        << e.path;});
+          return false;
+        }
+        catch (const io_error& e)
+        {
+          l4 ([&]{trace << "ignoring " << cp << ": " << e;});
+          return false;
+        }
+
+        l5 ([&]{trace << "loaded " << cp;});
+        return true;
+      }
+
+      void parser::
+      save_cache (const script& s, const path& cp)
+      {
+        tracer trace ("test::script::parser::save_cache");
+
+        assert (checksums_ != nullptr);
+
+        const path& sp (s.script_target.path ());
+
+        try
+        {
+          // Number the files, starting with the script itself.
+          //
+
+          vector<const path_name_value*> fs;
+          for (const path_name_value& p: s.paths_)
+          {
+            if (checksums_->find (p.path) == checksums_->end ())
+              throw invalid_argument ("no checksum for " + p.path.string ());
+
+            if (p.path == sp)
+              fs.insert (fs.begin (), &p);
+            else
+              fs.push_back (&p);
+          }
+
+          if (fs.empty () || fs.front ()->path != sp)
+            throw invalid_argument ("no script path");
+
+          token_paths tps;
+          location_paths lps;
+          for (uint32_t i (0); i != fs.size (); ++i)
+          {
+            tps[fs[i]] = i;
+            lps[&fs[i]->path] = i;
+          }
+
+          ofdstream os (cp,
+                        fdopen_mode::out      | fdopen_mode::binary |
+                        fdopen_mode::truncate | fdopen_mode::create);
+
+          os.write (cache_signature, sizeof (cache_signature));
+          write_uint (os, cache_version);
+          write_string (os, build_version.string ());
+
+          write_uint (os, static_cast<uint32_t> (fs.size ()));
+          for (const path_name_value* p: fs)
+          {
+            write_string (os, p->path.string ());
+            write_string (os, (*checksums_)[p->path]);
+          }
+
+          auto write_scope_base = [&os, &lps] (const scope& sc)
+          {
+            write_uint (os, static_cast<uint8_t> (sc.desc ? 1 : 0));
+
+            if (sc.desc)
+            {
+              write_string (os, sc.desc->id);
+              write_string (os, sc.desc->summary);
+              write_string (os, sc.desc->details);
+            }
+
+            write_location (os, lps, sc.start_loc_);
+            write_location (os, lps, sc.end_loc_);
+          };
+
+          function<void (const scope&)> write_scope;
+          function<void (const group&)> write_group;
+
+          write_group = [&os, &tps, &write_scope] (const group& g)
+          {
+            write_lines (os, tps, g.setup_);
+            write_lines (os, tps, g.tdown_);
+
+            write_uint (os, static_cast<uint32_t> (g.scopes.size ()));
+            for (const unique_ptr<scope>& sc: g.scopes)
+              write_scope (*sc);
+          };
+
+          write_scope = [&os, &tps, &write_scope_base, &write_group,
+                         &write_scope] (const scope& sc)
+          {
+            const group* g (dynamic_cast<const group*> (&sc));
+
+            write_uint (os, static_cast<uint8_t> (g != nullptr ? 'g' : 't'));
+            write_string (os, sc.id_path.leaf ().string ());
+
+            write_scope_base (sc);
+
+            write_uint (os, static_cast<uint8_t> (sc.if_cond_ ? 1 : 0));
+            if (sc.if_cond_)
+              write_lines (os, tps, lines {*sc.if_cond_});
+
+            write_uint (os, static_cast<uint8_t> (sc.if_chain ? 1 : 0));
+            if (sc.if_chain)
+              write_scope (*sc.if_chain);
+
+            if (g != nullptr)
+              write_group (*g);
+            else
+              write_lines (os, tps, static_cast<const test&> (sc).tests_);
+          };
+
+          write_scope_base (s);
+          write_group (s);
+
+          os.close ();
+        }
+        catch (const invalid_argument& e)
+        {
+          l4 ([&]{trace << "unable to cache " << sp << ": " << e;});
+          try_rmfile (cp, true /* ignore_error */);
+        }
+        catch (const io_error& e)
+        {
+          warn << "unable to write testscript cache " << cp << ": " << e;
+          try_rmfile (cp, true /* ignore_error */);
+        }
+      }
+    }
+  }
+}
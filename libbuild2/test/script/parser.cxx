@@ -3,7 +3,9 @@
 
 #include <libbuild2/test/script/parser.hxx>
 
-#include <libbuild2/context.hxx> // sched, keep_going
+#include <sstream>
+
+#include <libbuild2/context.hxx> // sched, keep_going, history
 
 #include <libbuild2/test/script/lexer.hxx>
 #include <libbuild2/test/script/runner.hxx>
@@ -37,15 +39,31 @@ namespace build2
         const path& p (s.script_target.path ());
         assert (!p.empty ()); // Should have been assigned.
 
+        string c;
         try
         {
-          ifdstream ifs (p);
-          pre_parse (ifs, s);
+          c = read_file (p);
         }
         catch (const io_error& e)
         {
           fail << "unable to read testscript " << p << ": " << e << endf;
         }
+
+        istringstream is (move (c));
+        pre_parse (is, s);
+      }
+
+      string parser::
+      read_file (const path& p)
+      {
+        ifdstream ifs (p);
+        string r (ifs.read_text ());
+        ifs.close ();
+
+        if (checksums_ != nullptr)
+          (*checksums_)[p] = sha256 (r).string ();
+
+        return r;
       }
 
       void parser::
@@ -60,6 +78,7 @@ namespace build2
         set_lexer (&l);
 
         id_prefix_.clear ();
+        cacheable_ = true;
 
         id_map idm;
         include_set ins;
@@ -1010,8 +1029,8 @@ namespace build2
           {
             try
             {
-              ifdstream ifs (p);
-              lexer l (ifs, pn, lexer_mode::command_line);
+              istringstream is (read_file (p));
+              lexer l (is, pn, lexer_mode::command_line);
 
               const path_name* op (path_);
               path_ = &pn;
@@ -1333,15 +1352,28 @@ namespace build2
       static void
       execute_impl (scope& s, script& scr, runner& r)
       {
+        context& ctx (scr.test_target.ctx);
+
+        timestamp start (system_clock::now ());
+
         try
         {
-          parser p (scr.test_target.ctx);
+          parser p (ctx);
           p.execute (s, scr, r);
         }
         catch (const failed&)
         {
           s.state = scope_state::failed;
         }
+
+        // Record the duration of a successfully executed scope to be used to
+        // order the scopes on subsequent runs (see exec_scope_body()).
+        //
+        if (s.state == scope_state::passed)
+          ctx.history.record (perform_test_id,
+                              scr.test_target,
+                              s.id_path.posix_string (),
+                              system_clock::now () - start);
       }
 
       void parser::
@@ -1443,12 +1475,16 @@ namespace build2
 
           if (exec_scope)
           {
-            atomic_count task_count (0);
-            wait_guard wg (g->root.test_target.ctx, task_count);
-
-            // Start asynchronous execution of inner scopes keeping track of
-            // how many we have handled.
+            // First select the scopes to execute (evaluating the if-else
+            // chains in order) and then start their asynchronous execution
+            // slowest first according to the durations recorded during the
+            // previous runs. This way the few slow tests don't end up
+            // delaying the completion of the whole testscript. The scopes
+            // without a record (for example, new tests) are started first
+            // and the rest is started in the script order.
             //
+            vector<pair<scope*, optional<duration>>> ss;
+
             for (unique_ptr<scope>& chain: g->scopes)
             {
               // Check if this scope is ignored (e.g., via config.test).
@@ -1546,47 +1582,103 @@ namespace build2
                            : ps->release ());
 
               if (chain != nullptr)
+                ss.emplace_back (
+                  chain.get (),
+                  ctx.history.find (perform_test_id,
+                                    g->root.test_target,
+                                    chain->id_path.posix_string ()));
+            }
+
+            stable_sort (
+              ss.begin (), ss.end (),
+              [] (const pair<scope*, optional<duration>>& x,
+                  const pair<scope*, optional<duration>>& y)
               {
-                // Hand it off to a sub-parser potentially in another thread.
-                // But we could also have handled it serially in this parser:
-                //
-                // scope* os (scope_);
-                // scope_ = chain.get ();
-                // exec_scope_body ();
-                // scope_ = os;
+                return !x.second ? (bool) y.second
+                                 : y.second && *x.second > *y.second;
+              });
 
-                // Pass our diagnostics stack (this is safe since we are going
-                // to wait for completion before unwinding the diag stack).
-                //
-                // If the scope was executed synchronously, check the status
-                // and bail out if we weren't asked to keep going.
-                //
-                // UBSan workaround.
+            atomic_count task_count (0);
+            wait_guard wg (g->root.test_target.ctx, task_count);
+
+            // Note that the scheduler's queue is popped from the front by the
+            // helpers but from the back by the thread waiting on it (that is,
+            // by us in wg.wait() below). So we execute the slowest known scope
+            // ourselves after queuing the rest. This way it starts right away,
+            // the next slowest are picked up by the helpers first, and we help
+            // with the fastest ones once done. If we are running serially,
+            // then we keep the order.
+            //
+            scope* inl (nullptr);
+            if (ss.size () > 1 && !ctx.sched.serial ())
+            {
+              auto i (find_if (ss.begin (), ss.end (),
+                               [] (const pair<scope*, optional<duration>>& p)
+                               {
+                                 return (bool) p.second;
+                               }));
+
+              if (i != ss.end ())
+              {
+                inl = i->first;
+                ss.erase (i);
+              }
+            }
+
+            // Start asynchronous execution of inner scopes keeping track of
+            // how many we have handled.
+            //
+            for (const pair<scope*, optional<duration>>& p: ss)
+            {
+              scope& s (*p.first);
+
+              // Hand it off to a sub-parser potentially in another thread.
+              // But we could also have handled it serially in this parser:
+              //
+              // scope* os (scope_);
+              // scope_ = &s;
+              // exec_scope_body ();
+              // scope_ = os;
+
+              // Pass our diagnostics stack (this is safe since we are going
+              // to wait for completion before unwinding the diag stack).
+              //
+              // If the scope was executed synchronously, check the status
+              // and bail out if we weren't asked to keep going.
+              //
+              // UBSan workaround.
+              //
+              const diag_frame* df (diag_frame::stack ());
+              if (!ctx.sched.async (task_count,
+                                    [] (const diag_frame* ds,
+                                        scope& s,
+                                        script& scr,
+                                        runner& r)
+                                    {
+                                      diag_frame::stack_guard dsg (ds);
+                                      execute_impl (s, scr, r);
+                                    },
+                                    df,
+                                    ref (s),
+                                    ref (*script_),
+                                    ref (*runner_)))
+              {
+                // Bail out if the scope has failed and we weren't instructed
+                // to keep going.
                 //
-                const diag_frame* df (diag_frame::stack ());
-                if (!ctx.sched.async (task_count,
-                                      [] (const diag_frame* ds,
-                                          scope& s,
-                                          script& scr,
-                                          runner& r)
-                                      {
-                                        diag_frame::stack_guard dsg (ds);
-                                        execute_impl (s, scr, r);
-                                      },
-                                      df,
-                                      ref (*chain),
-                                      ref (*script_),
-                                      ref (*runner_)))
-                {
-                  // Bail out if the scope has failed and we weren't instructed
-                  // to keep going.
-                  //
-                  if (chain->state == scope_state::failed && !ctx.keep_going)
-                    throw failed ();
-                }
+                if (s.state == scope_state::failed && !ctx.keep_going)
+                  throw failed ();
               }
             }
 
+            if (inl != nullptr)
+            {
+              execute_impl (*inl, *script_, *runner_);
+
+              if (inl->state == scope_state::failed && !ctx.keep_going)
+                throw failed ();
+            }
+
             wg.wait ();
 
             // Re-examine the scopes we have executed collecting their state.
@@ -1637,6 +1729,12 @@ namespace build2
         if (pre_parse_)
           return lookup ();
 
+        // If we have no scope, then we are pre-parsing a directive and its
+        // result now depends on the buildfile variables.
+        //
+        if (scope_ == nullptr)
+          cacheable_ = false;
+
         if (!qual.empty ())
           fail (loc) << "qualified variable name";
 
@@ -4,6 +4,8 @@
 #ifndef LIBBUILD2_TEST_SCRIPT_PARSER_HXX
 #define LIBBUILD2_TEST_SCRIPT_PARSER_HXX
 
+#include <map>
+
 #include <libbuild2/types.hxx>
 #include <libbuild2/forward.hxx>
 #include <libbuild2/utility.hxx>
@@ -36,6 +38,14 @@ namespace build2
         void
         pre_parse (istream&, script&);
 
+        // As above but first try to load the pre-parsed script from the
+        // specified cache file. If the cache is not valid, then pre-parse
+        // the script and save the result to the cache (see cache.cxx for
+        // details).
+        //
+        void
+        pre_parse (script&, const path& cache);
+
         // Recursive descent parser.
         //
         // Usually (but not always) parse functions receive the token/type
@@ -89,6 +99,20 @@ namespace build2
         description
         parse_trailing_description (token&, token_type&);
 
+        // Read the testscript file contents, saving its checksum if
+        // requested (see checksums_ below). Throw io_error on failure.
+        //
+        string
+        read_file (const path&);
+
+        // Pre-parsed script cache.
+        //
+        bool
+        load_cache (script&, const path&);
+
+        void
+        save_cache (const script&, const path&);
+
         command_expr
         parse_command_line (token&, token_type&);
 
@@ -138,6 +162,14 @@ namespace build2
 
         string id_prefix_; // Auto-derived id prefix.
 
+        // If not NULL, then the checksums of the testscript files read during
+        // pre-parse are saved in this map. Also, cacheable_ is reset if the
+        // result of pre-parse depends on anything other than the contents of
+        // these files (for example, variables expanded in directives).
+        //
+        std::map<path, string>* checksums_ = nullptr;
+        bool cacheable_;
+
         // Execute state.
         //
         runner* runner_;
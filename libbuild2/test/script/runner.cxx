@@ -18,7 +18,12 @@ namespace build2
       bool default_runner::
       test (scope& s) const
       {
-        return common_.test (s.root.test_target, s.id_path);
+        const target& t (s.root.test_target);
+
+        // Partition the top-level scopes if sharding.
+        //
+        return common_.test (t, s.id_path) &&
+               (s.parent != &s.root || common_.shard (t, s.id_path));
       }
 
       void default_runner::
@@ -155,7 +160,21 @@ namespace build2
             dr << info << "test id: " << sp.id_path.posix_string ();
           });
 
-        build2::script::run (sp, expr, li, ll);
+        // If this is a heavy test, then allocate all the other active
+        // thread slots to it so that it doesn't share the CPU with other
+        // jobs.
+        //
+        if (ct == command_type::test &&
+            cast_false<bool> (sp.lookup (sp.root.heavy_var)))
+        {
+          scheduler& s (sp.context.sched);
+          scheduler::alloc_guard ag (s, s.max_active () - 1);
+
+          build2::script::run (sp, expr, li, ll);
+          ag.deallocate ();
+        }
+        else
+          build2::script::run (sp, expr, li, ll);
       }
 
       bool default_runner::
@@ -93,6 +93,11 @@ namespace build2
         if (p != nullptr)
           const_cast<dir_path&> (*work_dir.path) =
             dir_path (*p->work_dir.path) /= id;
+
+        // Inherit the external diff utility, if any (handled in an ad hoc
+        // way for the root scope as well).
+        //
+        diff_utility = r.diff_utility;
       }
 
       void scope::
@@ -169,6 +174,7 @@ namespace build2
             arguments_var (var_pool.insert<strings> ("test.arguments")),
             redirects_var (var_pool.insert<strings> ("test.redirects")),
             cleanups_var  (var_pool.insert<strings> ("test.cleanups")),
+            heavy_var     (var_pool.insert<bool> ("test.heavy")),
 
             wd_var (var_pool.insert<dir_path> ("~")),
             id_var (var_pool.insert<path> ("@")),
@@ -200,6 +206,11 @@ namespace build2
         const_cast<dir_path&> (*work_dir.path) =
           dir_path (rwd) /= id_path.string ();
 
+        // Use the external diff utility for output comparison if requested
+        // (see the test module for details).
+        //
+        diff_utility = cast_null<path> (target_scope["config.test.diff"]);
+
         // Set the test variable at the script level. We do it even if it's
         // set in the buildfile since they use different types.
         //
@@ -282,6 +293,18 @@ namespace build2
         reset_special ();
       }
 
+      paths script::
+      file_paths () const
+      {
+        paths r;
+        r.reserve (paths_.size ());
+
+        for (const path_name_value& p: paths_)
+          r.push_back (p.path);
+
+        return r;
+      }
+
       lookup scope::
       lookup (const variable& var) const
       {
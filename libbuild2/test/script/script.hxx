@@ -244,6 +244,7 @@ namespace build2
         const variable& arguments_var; // test.arguments
         const variable& redirects_var; // test.redirects
         const variable& cleanups_var;  // test.cleanups
+        const variable& heavy_var;     // test.heavy
 
         const variable& wd_var;       // $~
         const variable& id_var;       // $@
@@ -263,6 +264,12 @@ namespace build2
         script& operator= (script&&) = delete;
         script& operator= (const script&) = delete;
 
+        // Return the paths of the testscript files that have been pre-parsed
+        // (the script itself and all the files it includes).
+        //
+        paths
+        file_paths () const;
+
         // Pre-parse data.
         //
       private:
@@ -0,0 +1,240 @@
+// file      : libbuild2/trace-file.cxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#include <libbuild2/trace-file.hxx>
+
+using namespace std;
+using namespace butl;
+
+namespace build2
+{
+  trace_file* trace_sink = nullptr;
+
+  // TLS sequential thread number (0 means not yet assigned).
+  //
+  static
+#ifdef __cpp_thread_local
+  thread_local
+#else
+  __thread
+#endif
+  uint64_t trace_thread_id = 0;
+
+  static atomic<uint64_t> trace_thread_count (0);
+
+  static inline uint64_t
+  thread_id ()
+  {
+    if (trace_thread_id == 0)
+      trace_thread_id = ++trace_thread_count;
+
+    return trace_thread_id;
+  }
+
+  static void
+  json_string (string& r, const string& s)
+  {
+    r += '"';
+    for (char c: s)
+    {
+      switch (c)
+      {
+      case '"':  r += "\\\""; break;
+      case '\\': r += "\\\\"; break;
+      case '\n': r += "\\n";  break;
+      case '\r': r += "\\r";  break;
+      case '\t': r += "\\t";  break;
+      default:
+        {
+          if (static_cast<unsigned char> (c) < 0x20)
+          {
+            static const char hex[] = "0123456789abcdef";
+
+            r += "\\u00";
+            r += hex[(c >> 4) & 0x0F];
+            r += hex[c & 0x0F];
+          }
+          else
+            r += c;
+        }
+      }
+    }
+    r += '"';
+  }
+
+  trace_file::
+  trace_file (const path& p)
+      : ofs_ (p), start_ (clock::now ())
+  {
+  }
+
+  void trace_file::
+  close ()
+  {
+    mlock l (mutex_);
+
+    ofs_ << "{\"traceEvents\":[" << events_ << "\n],"
+         << "\"displayTimeUnit\":\"ms\"}" << endl;
+    ofs_.close ();
+
+    events_.clear ();
+  }
+
+  void trace_file::
+  arg (string& r, const char* n, const string& v)
+  {
+    if (!r.empty ())
+      r += ',';
+
+    r += '"';
+    r += n;
+    r += "\":";
+    json_string (r, v);
+  }
+
+  void trace_file::
+  event (char ph,
+         const char* cat,
+         const string& name,
+         clock::time_point ts,
+         const string* args,
+         const duration* dur,
+         const uint64_t* id)
+  {
+    using chrono::microseconds;
+    using chrono::duration_cast;
+
+    string e ("\n{\"ph\":\"");
+    e += ph;
+    e += "\",\"cat\":\"";
+    e += cat;
+    e += "\",\"name\":";
+    json_string (e, name);
+    e += ",\"pid\":1,\"tid\":";
+    e += to_string (thread_id ());
+    e += ",\"ts\":";
+    e += to_string (duration_cast<microseconds> (ts - start_).count ());
+
+    if (dur != nullptr)
+    {
+      e += ",\"dur\":";
+      e += to_string (duration_cast<microseconds> (*dur).count ());
+    }
+
+    if (id != nullptr)
+    {
+      e += ",\"id\":";
+      e += to_string (*id);
+    }
+
+    if (ph == 'i')
+      e += ",\"s\":\"t\""; // Thread scope.
+
+    if (args != nullptr && !args->empty ())
+    {
+      e += ",\"args\":{";
+      e += *args;
+      e += '}';
+    }
+
+    e += '}';
+
+    mlock l (mutex_);
+
+    if (!events_.empty ())
+      events_ += ',';
+
+    events_ += e;
+  }
+
+  void trace_file::
+  complete (const char* cat,
+            const string& name,
+            clock::time_point s,
+            const string& args)
+  {
+    duration d (chrono::duration_cast<duration> (clock::now () - s));
+    event ('X', cat, name, s, &args, &d);
+  }
+
+  void trace_file::
+  instant (const char* cat, const string& name, const string& args)
+  {
+    event ('i', cat, name, clock::now (), &args);
+  }
+
+  void trace_file::
+  async_begin (const char* cat,
+               const string& name,
+               uint64_t id,
+               const string& args)
+  {
+    {
+      mlock l (mutex_);
+      async_[id] = name;
+    }
+
+    event ('b', cat, name, clock::now (), &args, nullptr, &id);
+  }
+
+  void trace_file::
+  async_end (const char* cat, uint64_t id)
+  {
+    string name;
+    {
+      mlock l (mutex_);
+
+      auto i (async_.find (id));
+      if (i == async_.end ())
+        return;
+
+      name = move (i->second);
+      async_.erase (i);
+    }
+
+    event ('e', cat, name, clock::now (), nullptr, nullptr, &id);
+  }
+
+  // Use the process handle (pid on POSIX, HANDLE on Windows) as the event
+  // id. It is unique for the lifetime of the process which is all we need.
+  //
+  static inline uint64_t
+  process_id (const process& p)
+  {
+#ifndef _WIN32
+    return static_cast<uint64_t> (p.handle);
+#else
+    return static_cast<uint64_t> (reinterpret_cast<uintptr_t> (p.handle));
+#endif
+  }
+
+  void
+  trace_process_start (const process& p, const char* const* args)
+  {
+    if (trace_file* tf = trace_sink)
+    {
+      string cmd;
+      for (const char* const* a (args); *a != nullptr; ++a)
+      {
+        if (a != args)
+          cmd += ' ';
+        cmd += *a;
+      }
+
+      string as;
+      trace_file::arg (as, "command", cmd);
+
+      tf->async_begin ("process",
+                       path (args[0]).leaf ().string (),
+                       process_id (p),
+                       as);
+    }
+  }
+
+  void
+  trace_process_end (const process& p)
+  {
+    if (trace_file* tf = trace_sink)
+      tf->async_end ("process", process_id (p));
+  }
+}
@@ -0,0 +1,155 @@
+// file      : libbuild2/trace-file.hxx -*- C++ -*-
+// license   : MIT; see accompanying LICENSE file
+
+#ifndef LIBBUILD2_TRACE_FILE_HXX
+#define LIBBUILD2_TRACE_FILE_HXX
+
+#include <map>
+
+#include <libbuild2/types.hxx>
+#include <libbuild2/forward.hxx>
+#include <libbuild2/utility.hxx>
+
+#include <libbuild2/export.hxx>
+
+namespace build2
+{
+  // Build timeline in the Chrome Trace Event JSON format (--trace-file).
+  //
+  // The events are accumulated in memory and written out by close(). Each
+  // event is attributed to the calling thread (the tid field is a sequential
+  // thread number assigned on the first event) and carries a sequence of
+  // JSON object members as its arguments (see arg()).
+  //
+  // The recording functions are MT-safe.
+  //
+  class LIBBUILD2_SYMEXPORT trace_file
+  {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    // Start the timeline and open the file. Throw io_error.
+    //
+    explicit
+    trace_file (const path&);
+
+    // Write the timeline and close the file. Throw io_error.
+    //
+    void
+    close ();
+
+    // Record a complete event (a span from start until now).
+    //
+    void
+    complete (const char* category,
+              const string& name,
+              clock::time_point start,
+              const string& args);
+
+    // Record an instant event.
+    //
+    void
+    instant (const char* category, const string& name, const string& args);
+
+    // Record the beginning and the end of an asynchronous event (a span
+    // that may begin and end in different threads) with the specified id.
+    // Ending an event that has not begun is ignored.
+    //
+    void
+    async_begin (const char* category,
+                 const string& name,
+                 uint64_t id,
+                 const string& args);
+
+    void
+    async_end (const char* category, uint64_t id);
+
+    // Append a JSON object member with the string value to the arguments.
+    //
+    static void
+    arg (string& args, const char* name, const string& value);
+
+  private:
+    void
+    event (char phase,
+           const char* category,
+           const string& name,
+           clock::time_point ts,
+           const string* args,
+           const duration* dur = nullptr,
+           const uint64_t* id = nullptr);
+
+  private:
+    ofdstream ofs_;
+    clock::time_point start_;
+
+    mutex mutex_;
+    string events_;
+    std::map<uint64_t, string> async_; // Names of the begun async events.
+  };
+
+  // The timeline to record the events to or NULL if not enabled. Set by the
+  // driver before starting any building.
+  //
+  LIBBUILD2_SYMEXPORT extern trace_file* trace_sink;
+
+  // Record a span (complete event) for the lifetime of this object if the
+  // timeline is enabled. The name and arguments are calculated by calling
+  // the specified function with the (string& name, string& args) signature
+  // but only if that's the case.
+  //
+  class trace_span
+  {
+  public:
+    template <typename F>
+    trace_span (const char* category, const F& f)
+        : tf_ (trace_sink)
+    {
+      if (tf_ != nullptr)
+      {
+        category_ = category;
+        f (name_, args_);
+        start_ = trace_file::clock::now ();
+      }
+    }
+
+    ~trace_span ()
+    {
+      if (tf_ != nullptr)
+        tf_->complete (category_, name_, start_, args_);
+    }
+
+    bool
+    active () const {return tf_ != nullptr;}
+
+    // Add an argument that only becomes known during the span.
+    //
+    void
+    arg (const char* name, const string& value)
+    {
+      if (tf_ != nullptr)
+        trace_file::arg (args_, name, value);
+    }
+
+    trace_span (const trace_span&) = delete;
+    trace_span& operator= (const trace_span&) = delete;
+
+  private:
+    trace_file* tf_;
+    const char* category_;
+    string name_;
+    string args_;
+    trace_file::clock::time_point start_;
+  };
+
+  // Record the start and the end of a child process (normally called by
+  // run_start() and process_wait(), respectively).
+  //
+  LIBBUILD2_SYMEXPORT void
+  trace_process_start (const process&, const char* const* args);
+
+  LIBBUILD2_SYMEXPORT void
+  trace_process_end (const process&);
+}
+
+#endif // LIBBUILD2_TRACE_FILE_HXX
@@ -5,6 +5,26 @@
 
 #include <time.h>   // tzset() (POSIX), _tzset() (Windows)
 
+#ifndef _WIN32
+#  include <fcntl.h>        // O_*
+#  include <spawn.h>        // posix_spawn*()
+#  include <sys/wait.h>     // wait4()
+#  include <sys/resource.h> // rusage
+#else
+#  include <libbutl/win32-utility.hxx>
+#endif
+
+// Use posix_spawn() on Linux with glibc 2.29 or later. There it is
+// implemented with clone(CLONE_VM | CLONE_VFORK) and so doesn't copy the
+// page tables of our (potentially huge) address space, reports the exec()
+// failure to the caller, and supports changing the working directory.
+//
+#if defined(__linux__) && defined(__GLIBC__) && \
+  (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#  define LIBBUILD2_POSIX_SPAWN
+extern char** environ;
+#endif
+
 #include <cerrno>   // ENOENT
 #include <cstring>  // strlen(), str[n]cmp()
 #include <iostream> // cerr
@@ -12,6 +32,7 @@
 #include <libbuild2/target.hxx>
 #include <libbuild2/context.hxx>
 #include <libbuild2/variable.hxx>
+#include <libbuild2/trace-file.hxx>
 #include <libbuild2/diagnostics.hxx>
 
 #include <libbuild2/script/regex.hxx> // script::regex::init()
@@ -207,6 +228,277 @@ namespace build2
              << endf;
   }
 
+#ifdef LIBBUILD2_POSIX_SPAWN
+  // Start the process using posix_spawn() with the child's STDIN, STDOUT,
+  // and STDERR redirected as specified by the redirect() calls. Return false
+  // if some redirect cannot be handled, in which case the caller should
+  // fall back to the process class.
+  //
+  namespace
+  {
+    class spawner
+    {
+    public:
+      spawner () {posix_spawn_file_actions_init (&fa_);}
+      ~spawner () {posix_spawn_file_actions_destroy (&fa_);}
+
+      // Redirect the child's file descriptor fd as specified by v, which can
+      // be fd itself (inherit), -1 (pipe), -2 (null device), or another
+      // file descriptor. For a pipe, return the parent's end in pe.
+      //
+      bool
+      redirect (int fd, int v, auto_fd& pe);
+
+      // Redirect to the child's end of the pipe, closing the other end.
+      //
+      bool
+      redirect (int fd, const process::pipe&);
+
+      void
+      spawn (process&,
+             const process_path&,
+             const char* const* args,
+             const char* cwd,
+             const char* const* envvars);
+
+      spawner (const spawner&) = delete;
+      spawner& operator= (const spawner&) = delete;
+
+    private:
+      void
+      check (int r)
+      {
+        if (r != 0)
+          throw process_error (r);
+      }
+
+    private:
+      posix_spawn_file_actions_t fa_;
+      small_vector<auto_fd, 3> ends_; // Child's ends of the pipes.
+    };
+
+    bool spawner::
+    redirect (int fd, int v, auto_fd& pe)
+    {
+      if (v == fd)
+        return true;
+
+      if (v == -1)
+      {
+        fdpipe p;
+        try
+        {
+          p = fdopen_pipe ();
+        }
+        catch (const io_error& e)
+        {
+          throw process_error (e.code ().value ());
+        }
+
+        bool in (fd == STDIN_FILENO);
+        auto_fd& c (in ? p.in : p.out); // Child's end.
+        auto_fd& o (in ? p.out : p.in); // Our end.
+
+        // Besides duplicating the child's end, make sure that neither end
+        // stays open in the child (for example, our end of its STDIN would
+        // prevent it from ever seeing EOF).
+        //
+        check (posix_spawn_file_actions_adddup2 (&fa_, c.get (), fd));
+        check (posix_spawn_file_actions_addclose (&fa_, c.get ()));
+        check (posix_spawn_file_actions_addclose (&fa_, o.get ()));
+
+        pe = move (o);
+        ends_.push_back (move (c));
+      }
+      else if (v == -2)
+        check (posix_spawn_file_actions_addopen (
+                 &fa_,
+                 fd,
+                 "/dev/null",
+                 fd == STDIN_FILENO ? O_RDONLY : O_WRONLY,
+                 0));
+      else if (v >= 0)
+        check (posix_spawn_file_actions_adddup2 (&fa_, v, fd));
+      else
+        return false;
+
+      return true;
+    }
+
+    bool spawner::
+    redirect (int fd, const process::pipe& p)
+    {
+      int c (fd == STDIN_FILENO ? p.in  : p.out); // Child's end.
+      int o (fd == STDIN_FILENO ? p.out : p.in);  // Other end.
+
+      if (c < 0)
+        return false;
+
+      if (c != fd)
+        check (posix_spawn_file_actions_adddup2 (&fa_, c, fd));
+
+      if (o >= 0)
+        check (posix_spawn_file_actions_addclose (&fa_, o));
+
+      return true;
+    }
+
+    void spawner::
+    spawn (process& pr,
+           const process_path& pp,
+           const char* const* args,
+           const char* cwd,
+           const char* const* evars)
+    {
+      if (cwd != nullptr && *cwd != '\0')
+        check (posix_spawn_file_actions_addchdir_np (&fa_, cwd));
+
+      // Apply the environment variable overrides (NAME=VALUE to set, NAME to
+      // unset) to a copy of the current environment.
+      //
+      cstrings ev;
+      if (evars != nullptr)
+      {
+        for (char** e (environ); *e != nullptr; ++e)
+          ev.push_back (*e);
+
+        for (const char* const* v (evars); *v != nullptr; ++v)
+        {
+          const char* e (strchr (*v, '='));
+          size_t n (e != nullptr ? e - *v : strlen (*v));
+
+          ev.erase (remove_if (ev.begin (), ev.end (),
+                               [v, n] (const char* x)
+                               {
+                                 return strncmp (x, *v, n) == 0 &&
+                                   x[n] == '=';
+                               }),
+                    ev.end ());
+
+          if (e != nullptr)
+            ev.push_back (*v);
+        }
+
+        ev.push_back (nullptr);
+      }
+
+      pid_t pid;
+      check (posix_spawn (&pid,
+                          pp.effect_string (),
+                          &fa_,
+                          nullptr /* attributes */,
+                          const_cast<char* const*> (args),
+                          const_cast<char* const*> (
+                            evars != nullptr ? ev.data () : environ)));
+
+      pr.handle = pid;
+      pr.exit = nullopt; // Running.
+
+      ends_.clear (); // Close the child's ends of the pipes.
+    }
+  }
+#endif
+
+  static atomic<uint64_t> spawn_count (0);
+  static atomic<uint64_t> spawn_time (0); // In nanoseconds.
+  static atomic<uint64_t> spawn_max (0);
+
+  template <typename F>
+  static process
+  spawn_timed (F&& f)
+  {
+    using clock = chrono::steady_clock;
+
+    clock::time_point s (clock::now ());
+    process r (f ());
+
+    uint64_t d (static_cast<uint64_t> (
+                  chrono::duration_cast<chrono::nanoseconds> (
+                    clock::now () - s).count ()));
+
+    spawn_count.fetch_add (1, memory_order_relaxed);
+    spawn_time.fetch_add (d, memory_order_relaxed);
+
+    for (uint64_t m (spawn_max.load (memory_order_relaxed)); d > m; )
+    {
+      if (spawn_max.compare_exchange_weak (m, d, memory_order_relaxed))
+        break;
+    }
+
+    return r;
+  }
+
+  process
+  process_spawn (const process_path& pp,
+                 const char* const* args,
+                 int in, int out, int err,
+                 const char* cwd,
+                 const char* const* evars)
+  {
+    return spawn_timed (
+      [&] ()
+      {
+#ifdef LIBBUILD2_POSIX_SPAWN
+        // Note that the redirects are performed in order, same as by the
+        // process class. So, for example, if err is 1, then STDERR is
+        // redirected to the already redirected STDOUT.
+        //
+        process r (process_exit (0));
+        spawner s;
+
+        if (s.redirect (STDIN_FILENO,  in,  r.out_fd) &&
+            s.redirect (STDOUT_FILENO, out, r.in_ofd) &&
+            s.redirect (STDERR_FILENO, err, r.in_efd))
+        {
+          s.spawn (r, pp, args, cwd, evars);
+          return r;
+        }
+#endif
+        return process (pp, args, in, out, err, cwd, evars);
+      });
+  }
+
+  process
+  process_spawn (const process_path& pp,
+                 const char* const* args,
+                 process::pipe in, process::pipe out, process::pipe err,
+                 const char* cwd,
+                 const char* const* evars)
+  {
+    return spawn_timed (
+      [&] ()
+      {
+#ifdef LIBBUILD2_POSIX_SPAWN
+        process r (process_exit (0));
+        spawner s;
+
+        if (s.redirect (STDIN_FILENO,  in)  &&
+            s.redirect (STDOUT_FILENO, out) &&
+            s.redirect (STDERR_FILENO, err))
+        {
+          s.spawn (r, pp, args, cwd, evars);
+          return r;
+        }
+#endif
+        return process (pp, args, in, out, err, cwd, evars);
+      });
+  }
+
+  process_statistics
+  process_stat ()
+  {
+    using chrono::nanoseconds;
+    using chrono::duration_cast;
+
+    process_statistics r;
+    r.count = static_cast<size_t> (spawn_count.load (memory_order_relaxed));
+    r.time = duration_cast<duration> (
+      nanoseconds (spawn_time.load (memory_order_relaxed)));
+    r.max = duration_cast<duration> (
+      nanoseconds (spawn_max.load (memory_order_relaxed)));
+    return r;
+  }
+
   process
   run_start (uint16_t verbosity,
              const process_env& pe,
@@ -223,16 +515,20 @@ namespace build2
     if (verb >= verbosity)
       print_process (pe, args, 0);
 
-    return process (
-      *pe.path,
-      args,
-      in,
-      out,
-      (err ? 2 : 1),
-      (!cwd.empty ()
-       ? cwd.string ().c_str ()
-       : pe.cwd != nullptr ? pe.cwd->string ().c_str () : nullptr),
-      pe.vars);
+    process pr (
+      process_spawn (
+        *pe.path,
+        args,
+        in,
+        out,
+        (err ? 2 : 1),
+        (!cwd.empty ()
+         ? cwd.string ().c_str ()
+         : pe.cwd != nullptr ? pe.cwd->string ().c_str () : nullptr),
+        pe.vars));
+
+    trace_process_start (pr, args);
+    return pr;
   }
   catch (const process_error& e)
   {
@@ -252,11 +548,78 @@ namespace build2
       fail (l) << "unable to execute " << args[0] << ": " << e << endf;
   }
 
+  bool
+  process_wait (process& pr)
+  {
+    if (pr.handle == 0) // Already waited for.
+      return pr.wait ();
+
+#ifndef _WIN32
+    // Reap the process with wait4() which returns the resource usage of
+    // this specific child (including that of its own children it has
+    // waited for). Note that we cannot use the process-wide
+    // getrusage(RUSAGE_CHILDREN) since other threads may reap their
+    // children (with process::wait() or otherwise) at the same time.
+    //
+    int st;
+    rusage ru {};
+    while (wait4 (static_cast<pid_t> (pr.handle), &st, 0, &ru) == -1)
+    {
+      if (errno != EINTR)
+        return pr.wait (); // Let process::wait() deal with it.
+    }
+
+    trace_process_end (pr);
+
+    // Now that the process is reaped, record its exit status the same way
+    // as process::wait() would have.
+    //
+    pr.handle = 0;
+    pr.exit = process_exit (st, process_exit::as_status);
+
+    bool r (pr.wait ());
+
+    auto tv = [] (const timeval& t)
+    {
+      return chrono::seconds (t.tv_sec) + chrono::microseconds (t.tv_usec);
+    };
+
+    scheduler::task_timer::add_child_cpu (
+      chrono::duration_cast<duration> (tv (ru.ru_utime) + tv (ru.ru_stime)));
+
+    return r;
+#else
+    // Here the times are available from the process handle until it is
+    // closed by process::wait().
+    //
+    if (WaitForSingleObject (pr.handle, INFINITE) == WAIT_OBJECT_0)
+    {
+      trace_process_end (pr);
+
+      FILETIME c, x, k, u;
+      if (GetProcessTimes (pr.handle, &c, &x, &k, &u))
+      {
+        auto ft = [] (const FILETIME& t) // In 100ns units.
+        {
+          return (static_cast<uint64_t> (t.dwHighDateTime) << 32) |
+            t.dwLowDateTime;
+        };
+
+        scheduler::task_timer::add_child_cpu (
+          chrono::duration_cast<duration> (
+            chrono::nanoseconds ((ft (k) + ft (u)) * 100)));
+      }
+    }
+
+    return pr.wait ();
+#endif
+  }
+
   bool
   run_wait (const char* args[], process& pr, const location& loc)
   try
   {
-    return pr.wait ();
+    return process_wait (pr);
   }
   catch (const process_error& e)
   {
@@ -273,7 +636,7 @@ namespace build2
   {
     tracer trace ("run_finish");
 
-    if (pr.wait ())
+    if (process_wait (pr))
       return true;
 
     const process_exit& e (*pr.exit);
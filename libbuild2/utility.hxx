@@ -242,6 +242,55 @@ namespace build2
   [[noreturn]] LIBBUILD2_SYMEXPORT void
   run_search_fail (const path&, const location& = location ());
 
+  // Start a process similar to the corresponding process class constructors
+  // (including the STDIN/STDOUT/STDERR redirection semantics) but, where
+  // supported, use posix_spawn() instead of fork()/exec(). Also account for
+  // the time it takes to start the process in the process statistics (see
+  // below). Throw process_error.
+  //
+  // Note that this function should be used instead of the process class
+  // constructors to start processes that are executed as part of a recipe.
+  //
+  LIBBUILD2_SYMEXPORT process
+  process_spawn (const process_path&,
+                 const char* const* args,
+                 int in = 0, int out = 1, int err = 2,
+                 const char* cwd = nullptr,
+                 const char* const* envvars = nullptr);
+
+  LIBBUILD2_SYMEXPORT process
+  process_spawn (const process_path&,
+                 const char* const* args,
+                 process::pipe in, process::pipe out, process::pipe err,
+                 const char* cwd = nullptr,
+                 const char* const* envvars = nullptr);
+
+  // Statistics of the processes started with process_spawn() during this
+  // run (the number of processes as well as the total and the longest
+  // time it took to start one).
+  //
+  struct process_statistics
+  {
+    size_t   count = 0;
+    duration time = duration::zero ();
+    duration max = duration::zero ();
+  };
+
+  LIBBUILD2_SYMEXPORT process_statistics
+  process_stat ();
+
+  // Wait for process termination similar to process::wait() but also
+  // attribute the CPU time of the process (including that of the children
+  // it has waited for) to the calling thread (see scheduler::task_timer).
+  // Throw process_error.
+  //
+  // Note that this function should be used instead of process::wait() to
+  // wait for processes executed as part of a recipe for them to be counted
+  // in the target's execution history (see execution_history).
+  //
+  LIBBUILD2_SYMEXPORT bool
+  process_wait (process&);
+
   // Wait for process termination returning true if the process exited
   // normally with a zero code and false otherwise. The latter case is
   // normally followed up with a call to run_finish().